@@ -3,16 +3,43 @@ import cors from 'cors';
 import dotenv from 'dotenv';
 import multer from 'multer';
 import ffmpeg from 'fluent-ffmpeg';
-import { promises as fs } from 'fs';
+import { createWriteStream, promises as fs } from 'fs';
+import os from 'os';
 import path from 'path';
+import { finished } from 'stream/promises';
+import { AsyncLocalStorage, AsyncResource } from 'async_hooks';
 import { fileURLToPath } from 'url';
-import { randomBytes, randomUUID } from 'crypto';
+import { createHash, randomBytes } from 'crypto';
 import rateLimit from 'express-rate-limit';
 import Stripe from 'stripe';
 import passport from 'passport';
 import { Strategy as GoogleStrategy } from 'passport-google-oauth20';
 import session from 'express-session';
 import { initDatabase, findUserByGoogleId, findUserByEmail, createUser } from './src/db.js';
+import { AssetStore, describeAsset } from './src/assetStore.js';
+import { isFilterOperation, compileOperations, applyCompiledFilters, expectedOutputDuration, parseTimeToSeconds, canEncodeInSegments, audioChunkSettleSeconds, normalizesInputLoudness } from './src/videoOps.js';
+import { RenderCache, renderCacheKey } from './src/renderCache.js';
+import { JobScheduler, SchedulerBusyError } from './src/ffmpegScheduler.js';
+import { RenderJobs, createProgressParser, withEstimates } from './src/renderJobs.js';
+import { smartCut } from './src/smartCut.js';
+import { ENCODE_PROFILES, selectEncodeProfile, x264OutputOptions } from './src/encodeProfiles.js';
+import { isReplayableOperation, proxyDimensions, scaleOperationArgs, extendLineage, replaySteps } from './src/proxyLineage.js';
+import { ProbeCache, videoStreamOf, hasAudioStream, durationOf } from './src/probeCache.js';
+import { assetStoreStorage } from './src/uploadStorage.js';
+import { isTransitionType, prepareTransition } from './src/transitionEngine.js';
+import { segmentedEncode } from './src/segmentedEncode.js';
+import { chunkedAudioRender, chunkedAudioReverse } from './src/chunkedAudio.js';
+import { measureLoudness } from './src/loudness.js';
+import { parseSrt, formatSrt, srtToVtt } from './src/srt.js';
+import { detectSilences, planTranscriptionChunks, transcribeChunks } from './src/transcription.js';
+import { TranslationCache, translateSrt, parseTranslatedBatch } from './src/translation.js';
+import { subtitleTracksFromArgs, muxSoftSubtitles } from './src/softSubtitles.js';
+import { CostLimiter, CostBudgetError, budgetOwner, estimateEncodeSeconds, durationFromUploadSize } from './src/costLimiter.js';
+import { AUDIO_RENDITIONS, audioRenditionCommand, speechClipCommand } from './src/audioRenditions.js';
+import { SUBTITLE_STYLES, SUBTITLE_POSITIONS, buildAssDocument, assFilter, overlayFormat, subtitleOverlayCommand } from './src/assSubtitles.js';
+import { ScratchArena, ScratchFullError } from './src/scratch.js';
+import { MetricsRegistry, monitorEventLoopLag } from './src/metrics.js';
+import { ServerTiming, parseFfmpegSpeed, sendServerTiming } from './src/serverTiming.js';
 
 dotenv.config();
 
@@ -38,6 +65,32 @@ const SESSION_SECRET = process.env.SESSION_SECRET;
 const APP_BASE_URL = process.env.APP_BASE_URL;
 const ALLOW_UNAUTH_SAMPLE_MODE = process.env.ALLOW_UNAUTH_SAMPLE_MODE !== 'false';
 const SAMPLE_TOKEN_TTL_MS = Math.max(60_000, Number(process.env.SAMPLE_TOKEN_TTL_MS || 10 * 60 * 1000));
+const ASSET_STORE_DIR = process.env.ASSET_STORE_DIR || path.join(os.tmpdir(), 'finalcut-assets');
+const ASSET_STORE_MAX_BYTES = Number(process.env.ASSET_STORE_MAX_BYTES || 10 * 1024 * 1024 * 1024);
+const RENDER_CACHE_MAX_BYTES = Number(process.env.RENDER_CACHE_MAX_BYTES || 2 * 1024 * 1024 * 1024);
+const FFMPEG_JOBS_PER_CORE = Number(process.env.FFMPEG_JOBS_PER_CORE || 0.5);
+const FFMPEG_MAX_QUEUE = Number(process.env.FFMPEG_MAX_QUEUE || 16);
+const PROXY_SHORT_SIDE = Number(process.env.PROXY_SHORT_SIDE ?? 480);
+const MAX_UPLOAD_BYTES = Number(process.env.MAX_UPLOAD_BYTES || 4 * 1024 * 1024 * 1024);
+const SEGMENTED_ENCODE_MIN_SECONDS = Number(process.env.SEGMENTED_ENCODE_MIN_SECONDS ?? 120);
+const SEGMENT_SECONDS = Math.max(2, Number(process.env.SEGMENT_SECONDS || 30));
+const CHUNKED_AUDIO_MIN_SECONDS = Number(process.env.CHUNKED_AUDIO_MIN_SECONDS ?? 600);
+const AUDIO_CHUNK_SECONDS = Math.max(10, Number(process.env.AUDIO_CHUNK_SECONDS || 120));
+const CAPTION_CHUNK_SECONDS = Math.max(10, Number(process.env.CAPTION_CHUNK_SECONDS || 60));
+const CAPTION_PARALLELISM = Math.max(1, Number(process.env.CAPTION_PARALLELISM || 4));
+const TRANSLATION_BATCH_CUES = Math.max(1, Number(process.env.TRANSLATION_BATCH_CUES || 40));
+const TRANSLATION_PARALLELISM = Math.max(1, Number(process.env.TRANSLATION_PARALLELISM || 8));
+const MAX_TRANSLATION_LANGUAGES = 10;
+const COST_BUDGET_SECONDS = Math.max(1, Number(process.env.COST_BUDGET_SECONDS || 1800));
+const COST_WINDOW_MINUTES = Math.max(1, Number(process.env.COST_WINDOW_MINUTES || 15));
+const SCRATCH_DIR = process.env.SCRATCH_DIR || path.join(os.tmpdir(), 'finalcut-scratch');
+const SCRATCH_MAX_BYTES = Number(process.env.SCRATCH_MAX_BYTES || 20 * 1024 * 1024 * 1024);
+const SCRATCH_TMPFS_DIR = process.env.SCRATCH_TMPFS_DIR ?? (process.platform === 'linux' ? '/dev/shm/finalcut-scratch' : '');
+const SCRATCH_TMPFS_MAX_BYTES = Number(process.env.SCRATCH_TMPFS_MAX_BYTES || 256 * 1024 * 1024);
+const METRICS_TOKEN = process.env.METRICS_TOKEN;
+const SCRATCH_SWEEP_SECONDS = Math.max(10, Number(process.env.SCRATCH_SWEEP_SECONDS || 300));
+// Attached audio files up to this size are written to tmpfs
+const SMALL_SCRATCH_FILE_BYTES = 16 * 1024 * 1024;
 
 if (!XAI_API_TOKEN) {
   console.error('ERROR: XAI_API_TOKEN environment variable is not set');
@@ -119,6 +172,170 @@ try {
   console.warn('Error:', error.message);
 }
 
+// Content-addressed store for uploads and rendered outputs
+const assetStore = new AssetStore({ dir: ASSET_STORE_DIR, maxBytes: ASSET_STORE_MAX_BYTES });
+await assetStore.init();
+
+// Index of previous renders, so repeated edits are served from the store without FFmpeg
+const renderCache = new RenderCache({
+  store: assetStore,
+  indexPath: path.join(ASSET_STORE_DIR, 'render-cache.json'),
+  maxBytes: RENDER_CACHE_MAX_BYTES
+});
+await renderCache.init();
+
+// ffprobe results per asset content hash, shared by every route that needs stream info
+const probeCache = new ProbeCache({ dir: path.join(ASSET_STORE_DIR, 'probes'), store: assetStore });
+await probeCache.init();
+
+// Per-job directories for FFmpeg intermediates; orphans of earlier processes are swept now and periodically
+const scratchArena = new ScratchArena({
+  dir: SCRATCH_DIR,
+  tmpfsDir: SCRATCH_TMPFS_DIR || null,
+  tmpfsMaxBytes: SCRATCH_TMPFS_MAX_BYTES,
+  maxBytes: SCRATCH_MAX_BYTES
+});
+await scratchArena.init();
+scratchArena.startSweeper(SCRATCH_SWEEP_SECONDS * 1000);
+
+// Every FFmpeg process runs under this scheduler so concurrent encodes cannot oversubscribe the CPU
+const ffmpegScheduler = JobScheduler.fromEnv({ jobsPerCore: FFMPEG_JOBS_PER_CORE, maxQueue: FFMPEG_MAX_QUEUE });
+console.log(`FFmpeg scheduler: ${ffmpegScheduler.concurrency} concurrent jobs, queue of ${ffmpegScheduler.maxQueue}`);
+
+// Loudness stats per asset content hash, measured once for two-pass normalize_audio from
+// the source's PCM analysis rendition
+const loudnessCache = new ProbeCache({
+  dir: path.join(ASSET_STORE_DIR, 'loudness'),
+  store: assetStore,
+  suffix: '.loudness.json',
+  probe: async (inputPath, source) => {
+    const analysis = await acquireAudioRendition(source, 'analysis');
+    try {
+      return await measureLoudness(analysis.path, { runFfmpeg });
+    } finally {
+      assetStore.release(analysis);
+    }
+  }
+});
+await loudnessCache.init();
+
+// Translated captions per (SRT content hash, language)
+const translationCache = new TranslationCache();
+
+// Background renders submitted through /api/jobs
+const renderJobs = new RenderJobs();
+
+// Metrics scraped from /metrics. Queue, cache and scratch figures are read from their
+// modules at scrape time; request, FFmpeg and xAI timings are recorded as they happen.
+const metrics = new MetricsRegistry();
+const requestDuration = metrics.histogram({
+  name: 'finalcut_http_request_duration_seconds',
+  help: 'API request latency by route, media operation and status',
+  labelNames: ['route', 'operation', 'status']
+});
+const requestBytes = metrics.counter({
+  name: 'finalcut_http_request_bytes_total',
+  help: 'Bytes received on API requests (wire bytes, including headers)',
+  labelNames: ['route']
+});
+const responseBytes = metrics.counter({
+  name: 'finalcut_http_response_bytes_total',
+  help: 'Bytes sent on API responses (wire bytes, including headers)',
+  labelNames: ['route']
+});
+const ffmpegSlotDuration = metrics.histogram({
+  name: 'finalcut_ffmpeg_slot_duration_seconds',
+  help: 'Time FFmpeg processes held a scheduler slot'
+});
+metrics.gauge({
+  name: 'finalcut_ffmpeg_jobs',
+  help: 'FFmpeg jobs running and waiting for a slot',
+  labelNames: ['state'],
+  collect: () => {
+    const { running, queued } = ffmpegScheduler.stats();
+    return [{ labels: { state: 'running' }, value: running }, { labels: { state: 'queued' }, value: queued }];
+  }
+});
+metrics.gauge({
+  name: 'finalcut_ffmpeg_slots',
+  help: 'Concurrent FFmpeg jobs allowed',
+  collect: () => ffmpegScheduler.concurrency
+});
+const cacheStats = () => ({
+  render: renderCache.stats(),
+  probe: probeCache.stats(),
+  loudness: loudnessCache.stats(),
+  translation: translationCache.stats()
+});
+metrics.counter({
+  name: 'finalcut_cache_hits_total',
+  help: 'Cache lookups answered without recomputing (probe and loudness hits include disk hits)',
+  labelNames: ['cache'],
+  collect: () => Object.entries(cacheStats()).map(([cache, stats]) => ({ labels: { cache }, value: stats.hits + (stats.diskHits || 0) }))
+});
+metrics.counter({
+  name: 'finalcut_cache_misses_total',
+  help: 'Cache lookups that had to recompute',
+  labelNames: ['cache'],
+  collect: () => Object.entries(cacheStats()).map(([cache, stats]) => ({ labels: { cache }, value: stats.misses }))
+});
+metrics.gauge({
+  name: 'finalcut_storage_bytes',
+  help: 'Bytes held by the asset store, render cache and scratch arena',
+  labelNames: ['store'],
+  collect: () => [
+    { labels: { store: 'assets' }, value: assetStore.totalBytes },
+    { labels: { store: 'render_cache' }, value: renderCache.stats().bytes },
+    { labels: { store: 'scratch' }, value: scratchArena.usedBytes() }
+  ]
+});
+const upstreamDuration = metrics.histogram({
+  name: 'finalcut_upstream_request_duration_seconds',
+  help: 'xAI API latency until response headers, by endpoint and outcome',
+  labelNames: ['endpoint', 'outcome']
+});
+const upstreamErrors = metrics.counter({
+  name: 'finalcut_upstream_errors_total',
+  help: 'xAI API requests that failed, by endpoint and HTTP status (or "network")',
+  labelNames: ['endpoint', 'reason']
+});
+const requestPhaseDuration = metrics.histogram({
+  name: 'finalcut_request_phase_seconds',
+  help: 'Server-Timing phases of media requests (ingest, spool, probe, queue, encode, egress)',
+  labelNames: ['route', 'phase']
+});
+monitorEventLoopLag(metrics, { name: 'finalcut_event_loop_lag_seconds' });
+
+// Time every API request and count its bytes. Socket byte counters are read at both ends of
+// the request, which is exact for keep-alive connections since requests on one are sequential.
+app.use('/api', (req, res, next) => {
+  const endTimer = requestDuration.startTimer();
+  const { socket } = req;
+  const bytesRead = socket.bytesRead;
+  const bytesWritten = socket.bytesWritten;
+  res.once('close', () => {
+    const route = req.route?.path || 'unmatched';
+    const operation = req.headers['x-operation'] || req.body?.operation || '';
+    endTimer({
+      route,
+      operation: /^[a-z_]{0,40}$/.test(operation) ? operation : 'invalid',
+      status: res.writableFinished ? String(res.statusCode) : 'aborted'
+    });
+    requestBytes.inc({ route }, socket.bytesRead - bytesRead);
+    responseBytes.inc({ route }, socket.bytesWritten - bytesWritten);
+  });
+  next();
+});
+
+// Prometheus scrape endpoint; requires `Authorization: Bearer <METRICS_TOKEN>` when it is set
+app.get('/metrics', async (req, res) => {
+  if (METRICS_TOKEN && req.headers.authorization !== `Bearer ${METRICS_TOKEN}`) {
+    return res.status(401).json({ error: 'Invalid metrics token' });
+  }
+  res.set('Content-Type', 'text/plain; version=0.0.4; charset=utf-8');
+  res.send(await metrics.render());
+});
+
 // Configure session middleware
 app.use(session({
   secret: SESSION_SECRET,
@@ -227,11 +444,11 @@ const apiLimiter = rateLimit({
   message: 'Too many requests from this IP, please try again later.'
 });
 
-const videoProcessLimiter = rateLimit({
-  windowMs: 15 * 60 * 1000, // 15 minutes
-  max: 20, // Limit video processing to 20 requests per 15 minutes
-  message: 'Too many video processing requests, please try again later.'
-});
+// Media requests are limited per user by the FFmpeg time they cost (see costLimiter.js).
+// The meter of the request being served is kept in async context so every FFmpeg slot the
+// request holds, however deep in a multi-pass render, is measured against it.
+const costLimiter = new CostLimiter({ budgetSeconds: COST_BUDGET_SECONDS, windowSeconds: COST_WINDOW_MINUTES * 60 });
+const costMeters = new AsyncLocalStorage();
 
 function requireAuthenticatedUser(req, res, next) {
   if (isValidSampleModeRequest(req)) {
@@ -249,6 +466,11 @@ function requireAuthenticatedUser(req, res, next) {
   next();
 }
 
+// Stable identity of the requester, for resources that only they may access
+function requestOwner(req) {
+  return req.user?.id ? `user:${req.user.id}` : `sample:${req.headers['sample-access-token']}`;
+}
+
 function requireActiveSubscription(req, res, next) {
   if (isValidSampleModeRequest(req)) {
     return next();
@@ -303,32 +525,27 @@ function parseAudioInput(audioFile) {
   };
 }
 
-// Configure multer for file uploads (store in memory)
-const storage = multer.memoryStorage();
+// Configure multer for file uploads: parts stream straight into the asset store
 const upload = multer({
-  storage: storage,
-  limits: { fileSize: 100 * 1024 * 1024 } // 100MB limit
+  storage: assetStoreStorage({ store: assetStore, extForMimeType: getExtFromMimeType }),
+  limits: { fileSize: MAX_UPLOAD_BYTES }
 });
 
-// Map MIME type to ffmpeg input format string
-function getMimeTypeToFormat(mimeType) {
-  const map = {
-    'video/mp4': 'mp4',
-    'video/webm': 'webm',
-    'video/quicktime': 'mov',
-    'video/x-msvideo': 'avi',
-    'video/x-matroska': 'matroska',
-    'video/x-flv': 'flv',
-    'video/ogg': 'ogg',
-    'audio/mpeg': 'mp3',
-    'audio/wav': 'wav',
-    'audio/aac': 'aac',
-    'audio/ogg': 'ogg',
-    'audio/flac': 'flac',
-    'audio/mp4': 'm4a',
+function uploadErrorStatus(err) {
+  return err.code === 'LIMIT_FILE_SIZE' ? 413 : 400;
+}
+
+// Run a multer middleware, answering upload errors as JSON instead of passing them on
+function parseUpload(middleware) {
+  return (req, res, next) => {
+    const endIngest = startPhase('ingest');
+    // Bound to the request's async context, which multer's stream callbacks would otherwise drop
+    middleware(req, res, AsyncResource.bind((err) => {
+      endIngest();
+      if (!err) return next();
+      res.status(uploadErrorStatus(err)).json({ error: err.message, code: err.code });
+    }));
   };
-  const base = (mimeType || '').split(';')[0].trim().toLowerCase();
-  return map[base] || 'mp4';
 }
 
 // Map MIME type to file extension
@@ -352,6 +569,480 @@ function getExtFromMimeType(mimeType) {
   return map[base] || 'mp4';
 }
 
+// Resolve the primary input of a media request to a stored asset: an existing asset
+// referenced by id, an uploaded multipart file, or the raw request body.
+// The asset is protected from eviction until the response closes.
+// Returns null after sending an error response if the input is unusable.
+async function acquireInputAsset(req, res, { assetId, mimeType }) {
+  let asset;
+  if (assetId) {
+    asset = await assetStore.acquire(assetId);
+    if (!asset) {
+      res.status(404).json({ error: 'Unknown or expired asset id', code: 'asset_not_found' });
+      return null;
+    }
+  } else {
+    let ingested = req.file?.asset;
+    if (!ingested) {
+      try {
+        ingested = await timePhase('ingest', () => assetStore.ingestStream(req, { mimeType, ext: getExtFromMimeType(mimeType), maxBytes: MAX_UPLOAD_BYTES }));
+      } catch (error) {
+        if (error.code !== 'LIMIT_FILE_SIZE') throw error;
+        res.status(413).json({ error: error.message, code: 'upload_too_large' });
+        return null;
+      }
+    }
+    if (!ingested.size) {
+      res.status(400).json({ error: 'No video data received' });
+      return null;
+    }
+    asset = await assetStore.acquire(ingested.id);
+  }
+
+  res.set('x-input-asset-id', asset.id);
+  res.on('close', () => assetStore.release(asset));
+  return asset;
+}
+
+// 503 + Retry-After for requests the FFmpeg scheduler cannot queue
+function sendBusy(res, error) {
+  res.set('Retry-After', String(error.retryAfterSeconds));
+  res.status(503).json({ error: error.message, code: error.code });
+}
+
+// Estimated encode seconds of a media request: from the probe of the stored input it
+// references, else from the upload size at 1080p
+async function estimateRequestCost(req, operation, args) {
+  const asset = req.headers['x-asset-id'] ? await assetStore.get(req.headers['x-asset-id']) : null;
+  const metadata = asset ? await probeInput(asset).catch(() => null) : null;
+  if (metadata) {
+    const video = videoStreamOf(metadata);
+    return estimateEncodeSeconds({ duration: durationOf(metadata), width: video?.width, height: video?.height, operation, args });
+  }
+  const duration = durationFromUploadSize(Number(req.headers['content-length']));
+  return estimateEncodeSeconds({ duration, width: 1920, height: 1080, operation, args });
+}
+
+// Charge a media request its estimated encode seconds against the requester's budget,
+// answering 429 + Retry-After when the budget does not cover it. Once the response and any
+// work holding the meter are done, the estimate is settled against the measured FFmpeg time. requestOperation(req) names the
+// operation; by default it is read from the x-operation header (args from x-args).
+function limitEncodeCost(requestOperation = (req) => req.headers['x-operation']) {
+  return async (req, res, next) => {
+    let args = {};
+    try {
+      args = req.headers['x-args'] ? JSON.parse(req.headers['x-args']) : {};
+    } catch {
+      // The route answers 400 for malformed args
+    }
+    let meter;
+    try {
+      meter = costLimiter.admit(budgetOwner(req), await estimateRequestCost(req, requestOperation(req), args));
+    } catch (error) {
+      if (!(error instanceof CostBudgetError)) return next(error);
+      res.set('Retry-After', String(error.retryAfterSeconds));
+      return res.status(429).json({ error: error.message, code: error.code });
+    }
+    res.on('close', meter.hold());
+    costMeters.run(meter, next);
+  };
+}
+
+// Scheduler slot for one FFmpeg process, measured against the current request's cost meter
+// and Server-Timing (queue wait, encode time and the speed FFmpeg reports for command)
+async function acquireFfmpegSlot({ signal, command } = {}) {
+  const meter = costMeters.getStore();
+  const timing = requestTimings.getStore();
+  const release = timing ? await timing.time('queue', () => ffmpegScheduler.acquire({ signal })) : await ffmpegScheduler.acquire({ signal });
+  const endEncode = timing ? timing.phase('encode') : () => {};
+  let speed = null;
+  if (timing && command) {
+    command.on('stderr', (line) => { speed = parseFfmpegSpeed(line) ?? speed; });
+  }
+  const startedAt = Date.now();
+  let measured = false;
+  return () => {
+    if (!measured) {
+      measured = true;
+      const seconds = (Date.now() - startedAt) / 1000;
+      ffmpegSlotDuration.observe({}, seconds);
+      if (meter) meter.add(seconds);
+      endEncode();
+      if (timing) timing.recordSpeed(seconds, speed);
+    }
+    release();
+  };
+}
+
+// Server-Timing of the current media request, if any
+const requestTimings = new AsyncLocalStorage();
+
+// Start a phase of the current request's Server-Timing; returns its end()
+function startPhase(name) {
+  const timing = requestTimings.getStore();
+  return timing ? timing.phase(name) : () => {};
+}
+
+function timePhase(name, fn) {
+  const timing = requestTimings.getStore();
+  return timing ? timing.time(name, fn) : fn();
+}
+
+function probeInput(asset) {
+  return timePhase('probe', () => probeCache.get(asset));
+}
+
+// Server-Timing for media responses. Responses with a known length carry the breakdown in
+// their header. Streamed outputs are still encoding when their headers go out, so their full
+// breakdown is kept by output asset id for GET /api/outputs/:id/timing instead.
+// Every phase is also recorded in the request phase metrics.
+const MAX_OUTPUT_TIMINGS = 1000;
+const outputTimings = new Map(); // output asset id -> Server-Timing header value, oldest first
+
+function recordServerTiming(req, res, next) {
+  const timing = new ServerTiming();
+  const endEgress = sendServerTiming(req, res, timing, {
+    onComplete: (header) => {
+      const outputId = res.getHeader('x-output-asset-id');
+      if (!outputId) return;
+      outputTimings.delete(outputId);
+      outputTimings.set(outputId, header);
+      if (outputTimings.size > MAX_OUTPUT_TIMINGS) outputTimings.delete(outputTimings.keys().next().value);
+    }
+  });
+  res.once('close', () => {
+    endEgress();
+    const route = req.route?.path || 'unmatched';
+    for (const [phase, ms] of Object.entries(timing.durations())) {
+      requestPhaseDuration.observe({ route, phase }, ms / 1000);
+    }
+  });
+  requestTimings.run(timing, next);
+}
+
+// Reject media requests up front, before their upload is read, while the FFmpeg queue is full.
+// Requests that reference a stored asset skip this check since they may be served from the
+// render cache; they are admitted when their FFmpeg job is scheduled.
+// While live jobs hold the whole scratch quota, every media request is turned away until some finish.
+function rejectWhenSaturated(req, res, next) {
+  if (scratchArena.isFull()) {
+    return sendBusy(res, new ScratchFullError(ffmpegScheduler.retryAfterSeconds()));
+  }
+  if (!req.headers['x-asset-id'] && ffmpegScheduler.isSaturated()) {
+    return sendBusy(res, new SchedulerBusyError(ffmpegScheduler.retryAfterSeconds()));
+  }
+  next();
+}
+
+// Scratch directory for one media request, removed when its response closes, however the
+// request ends
+async function scratchDirFor(res, label, options) {
+  const scratchDir = await scratchArena.createDir(label, options);
+  if (res.destroyed) {
+    scratchDir.release();
+  } else {
+    res.on('close', () => scratchDir.release());
+  }
+  return scratchDir;
+}
+
+// Encode profile for a media request (encodeProfile arg, else x-encode-profile header, else draft).
+// Answers 400 and returns null for unknown profile names.
+function requestEncodeProfile(req, res, args) {
+  const profile = selectEncodeProfile({ args, header: req.headers['x-encode-profile'] });
+  if (!profile) {
+    res.status(400).json({ error: `encodeProfile must be one of: ${Object.keys(ENCODE_PROFILES).join(', ')}` });
+  }
+  return profile;
+}
+
+// Aborts when the client disconnects, so queued jobs for it are dropped
+function abortSignalFor(res) {
+  const controller = new AbortController();
+  res.on('close', () => controller.abort(new Error('Client disconnected')));
+  return controller.signal;
+}
+
+// Run a fluent-ffmpeg command with an output to completion once a scheduler slot is free
+async function runFfmpeg(command, { signal, onStart } = {}) {
+  const release = await acquireFfmpegSlot({ signal, command });
+  try {
+    if (onStart) onStart();
+    await new Promise((resolve, reject) => {
+      command.on('end', () => resolve()).on('error', reject).run();
+    });
+  } finally {
+    release();
+  }
+}
+
+// Answer from the render cache if this exact edit of this exact input was rendered before.
+// Returns true when the cached output has been sent.
+async function serveCachedRender(res, cacheKey) {
+  const cached = await renderCache.lookup(cacheKey);
+  const asset = cached ? await assetStore.acquire(cached.id) : null;
+  if (!asset) {
+    res.set('x-cache', 'MISS');
+    return false;
+  }
+  res.on('close', () => assetStore.release(asset));
+  res.set({ 'x-cache': 'HIT', 'x-output-asset-id': asset.id });
+  if (asset.meta?.lineage) res.set('x-proxy', '1');
+  res.sendFile(asset.path, { headers: { 'Content-Type': asset.mimeType } });
+  return true;
+}
+
+// Render a built process command (or multi-pass render) to a committed asset.
+// meta is stored with the output; with a cacheKey the output is recorded in the render cache.
+async function renderToAsset({ command, render, outputExt, mimeType }, { signal, cacheKey, meta, onStart } = {}) {
+  const reservation = assetStore.reserveOutput({ mimeType, ext: outputExt, meta });
+  try {
+    if (render) {
+      if (onStart) onStart();
+      await render(reservation.path, { signal });
+    } else {
+      await runFfmpeg(command.output(reservation.path), { signal, onStart });
+    }
+    const asset = await reservation.commit();
+    if (cacheKey) renderCache.record(cacheKey, asset);
+    return asset;
+  } catch (error) {
+    await reservation.abort();
+    throw error;
+  }
+}
+
+// Low-resolution proxy of a large source video, rendered once and kept in the render cache.
+// Resolves to the acquired proxy asset, or null when the source needs no proxy.
+const proxyRenders = new Map(); // source id -> in-flight Promise<asset | null>
+const sourcesWithoutProxy = new Set(); // source ids already small enough to edit directly
+const mayNeedProxy = (source) => PROXY_SHORT_SIDE > 0 && source.mimeType?.startsWith('video/') && !sourcesWithoutProxy.has(source.id);
+const proxyCacheKey = (source) => renderCacheKey(source.id, 'proxy', { shortSide: PROXY_SHORT_SIDE });
+
+async function acquireProxy(source) {
+  if (!mayNeedProxy(source)) return null;
+  const cacheKey = proxyCacheKey(source);
+  const cached = await renderCache.lookup(cacheKey, { internal: true });
+  if (cached) return assetStore.acquire(cached.id);
+
+  if (!proxyRenders.has(source.id)) {
+    const rendering = (async () => {
+      // The render holds its own reference to the source, since it may outlive the request
+      const held = await assetStore.acquire(source.id);
+      try {
+        const video = await probeVideoStream(source);
+        const dims = video && proxyDimensions(video.width, video.height, PROXY_SHORT_SIDE);
+        if (!dims) {
+          if (video) sourcesWithoutProxy.add(source.id);
+          return null;
+        }
+        const side = dims.shortSide;
+        // Scale the shorter side to the proxy size, whatever the display orientation
+        const command = ffmpeg(source.path)
+          .videoFilters(`scale=w='if(gt(iw,ih),-2,${side})':h='if(gt(iw,ih),${side},-2)'`)
+          .videoCodec('libx264')
+          .outputOptions(x264OutputOptions(selectEncodeProfile({ header: 'balanced' })))
+          .audioCodec('aac')
+          .toFormat('mp4');
+        return await renderToAsset({ command, outputExt: 'mp4', mimeType: 'video/mp4' }, {
+          cacheKey,
+          meta: { lineage: { sourceId: source.id, scale: dims.scale, operations: [] } }
+        });
+      } finally {
+        assetStore.release(held);
+      }
+    })().finally(() => proxyRenders.delete(source.id));
+    proxyRenders.set(source.id, rendering);
+  }
+  const proxy = await proxyRenders.get(source.id);
+  return proxy ? assetStore.acquire(proxy.id) : null;
+}
+
+// Derived audio rendition (see audioRenditions.js) of a source, extracted once and kept in
+// the render cache. Resolves to the acquired rendition asset; rejects when the source has
+// no audio.
+const audioRenditionRenders = new Map(); // `${source id}:${name}` -> in-flight Promise<asset>
+async function acquireAudioRendition(source, name) {
+  const cacheKey = renderCacheKey(source.id, 'audio_rendition', { name });
+  const cached = await renderCache.lookup(cacheKey, { internal: true });
+  const cachedAsset = cached ? await assetStore.acquire(cached.id) : null;
+  if (cachedAsset) return cachedAsset;
+
+  const key = `${source.id}:${name}`;
+  if (!audioRenditionRenders.has(key)) {
+    const rendering = (async () => {
+      // The extraction holds its own reference to the source, since it may outlive the request
+      const held = await assetStore.acquire(source.id);
+      try {
+        const { ext, mimeType } = AUDIO_RENDITIONS[name];
+        return await renderToAsset({ command: audioRenditionCommand(held.path, name), outputExt: ext, mimeType }, { cacheKey });
+      } finally {
+        assetStore.release(held);
+      }
+    })().finally(() => audioRenditionRenders.delete(key));
+    audioRenditionRenders.set(key, rendering);
+  }
+  const rendition = await assetStore.acquire((await audioRenditionRenders.get(key)).id);
+  if (!rendition) throw new Error(`The ${name} audio rendition was evicted before use`);
+  return rendition;
+}
+
+// Replay a proxy-derived asset's edit chain on its full-resolution source. Each step is
+// looked up in and recorded to the render cache. Resolves to the acquired full-resolution
+// asset (the asset itself when it has no lineage).
+async function acquireFullResolution(asset, { signal, encodeProfile = selectEncodeProfile({ header: 'final' }) } = {}) {
+  const lineage = asset.meta?.lineage;
+  if (!lineage) return assetStore.acquire(asset.id);
+
+  let current = await assetStore.acquire(lineage.sourceId);
+  if (!current) {
+    const error = new Error('The full-resolution source of this preview has expired; please upload it again');
+    error.code = 'source_expired';
+    throw error;
+  }
+  try {
+    for (const step of replaySteps(lineage.operations)) {
+      const args = { ...step.args, encodeProfile: encodeProfile.name };
+      const cacheKey = renderCacheKey(current.id, step.operation, args);
+      const render = async () => {
+        const built = buildProcessCommand(current, step.operation, args, encodeProfile, await processInputInfo(current, step.operation, args));
+        if (built.error) throw new Error(`Cannot replay ${step.operation}: ${built.error}`);
+        return renderToAsset(built, { signal, cacheKey });
+      };
+      const output = await renderCache.lookup(cacheKey, { internal: true }) || await render();
+      // The intermediate may be evicted before it is acquired; it is rendered again once
+      const next = await assetStore.acquire(output.id) || await assetStore.acquire((await render()).id);
+      if (!next) {
+        const error = new Error('The full-resolution render of this preview was evicted; please upload the video again');
+        error.code = 'source_expired';
+        throw error;
+      }
+      assetStore.release(current);
+      current = next;
+    }
+    return current;
+  } catch (error) {
+    assetStore.release(current);
+    throw error;
+  }
+}
+
+// The asset an interactive edit runs on, and its lineage (null when rendering at full
+// resolution). Large sources are swapped for their proxy for replayable operations unless
+// the client sent x-proxy: off; proxy-derived inputs to any other operation are first
+// rendered at full resolution. The caller must release `acquired` (null if nothing was).
+async function interactiveInput(req, asset, operation, { signal, encodeProfile } = {}) {
+  const lineage = asset.meta?.lineage || null;
+  const replayable = isReplayableOperation(operation);
+  if (lineage && replayable) return { asset, lineage, acquired: null };
+
+  const acquired = lineage
+    ? await acquireFullResolution(asset, { signal, encodeProfile })
+    : (replayable && req.headers['x-proxy'] !== 'off' ? await acquireProxy(asset) : null);
+  if (!acquired) return { asset, lineage: null, acquired: null };
+  return { asset: acquired, lineage: acquired.meta?.lineage || null, acquired };
+}
+
+// Id of the asset interactiveInput would pick, as far as it is known without rendering
+// anything; null while a proxy or full-resolution render is still needed
+async function knownInteractiveInputId(req, asset, operation) {
+  const replayable = isReplayableOperation(operation);
+  if (asset.meta?.lineage) return replayable ? asset.id : null;
+  if (!replayable || req.headers['x-proxy'] === 'off' || !mayNeedProxy(asset)) return asset.id;
+  const proxy = await renderCache.lookup(proxyCacheKey(asset), { internal: true });
+  return proxy?.id || null;
+}
+
+// Input for an operation that cannot be replayed from a proxy: proxy previews are first
+// rendered at full resolution in the request's encode profile. Returns null after sending
+// an error response.
+async function acquireFullResolutionInput(res, asset, encodeProfile) {
+  if (!asset?.meta?.lineage) return asset;
+  try {
+    const full = await acquireFullResolution(asset, { signal: abortSignalFor(res), encodeProfile });
+    res.on('close', () => assetStore.release(full));
+    return full;
+  } catch (error) {
+    sendRenderError(res, error, 'full-resolution render');
+    return null;
+  }
+}
+
+// Send the error of a failed proxy or full-resolution render
+function sendRenderError(res, error, label) {
+  if (error instanceof SchedulerBusyError) return sendBusy(res, error);
+  if (error.code === 'source_expired') return res.status(410).json({ error: error.message, code: error.code });
+  if (error.code === 'trim_out_of_range') return res.status(400).json({ error: error.message, code: error.code });
+  console.error(`FFmpeg error (${label}):`, error);
+  if (!res.headersSent) res.status(500).json({ error: error.message || 'Processing failed' });
+}
+
+// Pipe an FFmpeg command's output to the response while keeping a copy in the asset
+// store, so the client can reference the result by id in its next request.
+// With a cacheKey the committed output is also recorded in the render cache.
+// The process starts once the FFmpeg scheduler grants a slot.
+async function streamAndRetainOutput(command, res, { mimeType, ext, label, cacheKey, meta, onFinish }) {
+  let release;
+  try {
+    release = await acquireFfmpegSlot({ signal: abortSignalFor(res), command });
+  } catch (error) {
+    if (error instanceof SchedulerBusyError) sendBusy(res, error);
+    if (onFinish) onFinish();
+    return;
+  }
+
+  const reservation = assetStore.reserveOutput({ mimeType, ext, meta });
+  const retained = createWriteStream(reservation.path);
+  let output = null;
+  let settled = false;
+  let retainFailed = false;
+
+  // Retention is best-effort: a full or failing disk drops the copy, not the response
+  retained.on('error', (err) => {
+    if (retainFailed) return;
+    retainFailed = true;
+    if (output) output.unpipe(retained);
+    reservation.abort();
+    console.error(`Failed to retain output (${label}):`, err);
+  });
+
+  res.set('Content-Type', mimeType);
+  res.set('x-output-asset-id', reservation.id);
+  res.on('close', () => {
+    // Client went away before the output was delivered: stop encoding
+    if (!settled && !res.writableFinished) command.kill('SIGKILL');
+  });
+
+  command
+    .on('error', (err) => {
+      settled = true;
+      release();
+      retained.destroy();
+      reservation.abort();
+      console.error(`FFmpeg error (${label}):`, err);
+      if (!res.headersSent) res.status(500).end();
+      else res.destroy(err);
+      if (onFinish) onFinish();
+    })
+    .on('end', () => {
+      settled = true;
+      release();
+      if (retainFailed) {
+        if (onFinish) onFinish();
+        return;
+      }
+      finished(retained)
+        .then(() => reservation.commit())
+        .then((asset) => { if (cacheKey) renderCache.record(cacheKey, asset); })
+        .catch((err) => console.error(`Failed to retain output (${label}):`, err))
+        .finally(() => { if (onFinish) onFinish(); });
+    });
+
+  output = command.pipe();
+  output.pipe(res);
+  output.pipe(retained);
+}
+
 // Stripe webhook endpoint for handling payment events
 // Must be mounted before JSON body parsing so Stripe signature verification receives the raw body.
 app.post('/api/stripe-webhook', express.raw({ type: 'application/json' }), async (req, res) => {
@@ -540,6 +1231,30 @@ app.get('/api/auth/status', apiLimiter, (req, res) => {
   }
 });
 
+// POST a chat completion request to xAI, recording its latency until response headers and
+// its failures under endpoint in the upstream metrics
+async function fetchXai(endpoint, body) {
+  const endTimer = upstreamDuration.startTimer({ endpoint });
+  let response;
+  try {
+    response = await fetch('https://api.x.ai/v1/chat/completions', {
+      method: 'POST',
+      headers: {
+        'Content-Type': 'application/json',
+        'Authorization': `Bearer ${XAI_API_TOKEN}`
+      },
+      body: JSON.stringify(body)
+    });
+  } catch (error) {
+    endTimer({ outcome: 'error' });
+    upstreamErrors.inc({ endpoint, reason: 'network' });
+    throw error;
+  }
+  endTimer({ outcome: response.ok ? 'ok' : 'error' });
+  if (!response.ok) upstreamErrors.inc({ endpoint, reason: String(response.status) });
+  return response;
+}
+
 // Proxy endpoint for xAI API with streaming support
 app.post('/api/chat', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, async (req, res) => {
   try {
@@ -553,17 +1268,10 @@ app.post('/api/chat', apiLimiter, requireAuthenticatedUser, requireActiveSubscri
     }
 
     // Enable streaming for xAI API
-    const response = await fetch('https://api.x.ai/v1/chat/completions', {
-      method: 'POST',
-      headers: {
-        'Content-Type': 'application/json',
-        'Authorization': `Bearer ${XAI_API_TOKEN}`
-      },
-      body: JSON.stringify({
-        ...req.body,
-        model: 'grok-3', // Specify the new model here
-        stream: true // Enable streaming
-      })
+    const response = await fetchXai('chat', {
+      ...req.body,
+      model: 'grok-3', // Specify the new model here
+      stream: true // Enable streaming
     });
 
     if (!response.ok) {
@@ -617,19 +1325,100 @@ app.get('/api/supported-formats', apiLimiter, requireAuthenticatedUser, requireA
   });
 });
 
-// Helper: convert SRT subtitle content to WebVTT format
-function srtToVtt(srt) {
-  const vtt = 'WEBVTT\n\n' + srt
-    .replace(/\r\n/g, '\n')
-    .replace(/(\d{2}:\d{2}:\d{2}),(\d{3})/g, '$1.$2');
-  return vtt;
+// Asset upload endpoint: store a media file once so later operations can reference it by id
+app.post('/api/assets', requireAuthenticatedUser, requireActiveSubscription, limitEncodeCost(() => 'upload'), async (req, res) => {
+  const fileContentType = (req.headers['content-type'] || '').split(';')[0].trim().toLowerCase() || 'video/mp4';
+  try {
+    const asset = await acquireInputAsset(req, res, { mimeType: fileContentType });
+    if (!asset) return;
+    res.status(201).json(describeAsset(asset));
+    // Start the proxy render now so the first edit does not wait for it
+    if (req.headers['x-proxy'] !== 'off') {
+      acquireProxy(asset)
+        .then((proxy) => assetStore.release(proxy))
+        .catch((error) => console.warn('Proxy render failed:', error.message));
+    }
+  } catch (error) {
+    console.error('Error storing asset:', error);
+    if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to store asset' });
+  }
+});
+
+// Asset download endpoint: fetch a stored upload or rendered output by id
+app.get('/api/assets/:id', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, async (req, res) => {
+  const asset = await assetStore.acquire(req.params.id);
+  if (!asset) {
+    return res.status(404).json({ error: 'Unknown or expired asset id', code: 'asset_not_found' });
+  }
+  res.on('close', () => assetStore.release(asset));
+  res.set('x-asset-id', asset.id);
+  res.sendFile(asset.path, { headers: { 'Content-Type': asset.mimeType } });
+});
+
+// Server-Timing of the request that streamed an output, once it has ended
+app.get('/api/outputs/:id/timing', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, (req, res) => {
+  const serverTiming = outputTimings.get(req.params.id);
+  if (serverTiming === undefined) {
+    return res.status(404).json({ error: 'No timing recorded for this output', code: 'timing_not_found' });
+  }
+  res.json({ serverTiming });
+});
+
+// Render and probe cache statistics, for sizing RENDER_CACHE_MAX_BYTES
+app.get('/api/cache-stats', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, (req, res) => {
+  res.json({ ...renderCache.stats(), probes: probeCache.stats(), loudness: loudnessCache.stats(), translations: translationCache.stats(), costs: costLimiter.stats(), scratch: scratchArena.stats() });
+});
+
+// Transcribe one audio clip (MP3) via the xAI audio model. Resolves to SRT text timed from
+// the start of the clip.
+async function transcribeAudioClip(audioPath, language) {
+  const audioBase64 = (await fs.readFile(audioPath)).toString('base64');
+
+  // Build transcription prompt
+  const languageInstruction = language === 'auto'
+    ? 'automatically detect the spoken language'
+    : `transcribe in ${language}`;
+
+  // Call xAI audio model for transcription
+  const xaiResponse = await fetchXai('transcription', {
+    model: 'grok-2-audio-1212',
+    messages: [{
+      role: 'user',
+      content: [
+        {
+          type: 'text',
+          text: `Please transcribe this audio and ${languageInstruction}. Output ONLY valid SRT subtitle format with accurate timestamps. Use this exact format with no extra text:\n\n1\n00:00:00,000 --> 00:00:02,500\nSubtitle text here\n\n2\n00:00:02,500 --> 00:00:05,000\nMore text`
+        },
+        {
+          type: 'input_audio',
+          input_audio: {
+            data: audioBase64,
+            format: 'mp3'
+          }
+        }
+      ]
+    }]
+  });
+
+  if (!xaiResponse.ok) {
+    const errBody = await xaiResponse.json().catch(() => ({}));
+    throw new Error(`xAI API error: ${errBody.error?.message || xaiResponse.statusText}`);
+  }
+
+  const xaiData = await xaiResponse.json();
+  return xaiData.choices?.[0]?.message?.content?.trim() || '';
 }
 
-// Caption generation endpoint: extract audio from video and transcribe via xAI
-app.post('/api/generate-captions', videoProcessLimiter, requireAuthenticatedUser, requireActiveSubscription, async (req, res) => {
+// Caption generation endpoint: extract audio from video and transcribe via xAI.
+// Long audio is cut at silences into chunks that are transcribed concurrently. With
+// "Accept: text/event-stream" each chunk's cues are sent as a 'cues' event as soon as it is
+// transcribed, followed by 'done' with the full { srt, vtt } (or 'failed'); otherwise the
+// response is the { srt, vtt } JSON.
+app.post('/api/generate-captions', recordServerTiming, requireAuthenticatedUser, requireActiveSubscription, rejectWhenSaturated, limitEncodeCost(() => 'generate_captions'), async (req, res) => {
   const contentType = (req.headers['content-type'] || '').toLowerCase();
   const fileContentType = contentType.split(';')[0].trim() || 'video/mp4';
   const argsStr = req.headers['x-args'];
+  const streamEvents = (req.headers.accept || '').includes('text/event-stream');
 
   let parsedArgs = {};
   try {
@@ -639,302 +1428,560 @@ app.post('/api/generate-captions', videoProcessLimiter, requireAuthenticatedUser
   }
 
   const language = parsedArgs.language || 'auto';
-  let tmpInputPath = null;
-  let tmpAudioPath = null;
+  const sendEvent = (event, data) => res.write(`event: ${event}\ndata: ${JSON.stringify(data)}\n\n`);
+  let heartbeat = null;
 
   try {
-    // Read video from request body
-    const chunks = [];
-    for await (const chunk of req) { chunks.push(chunk); }
-    const inputBuffer = Buffer.concat(chunks);
-
-    if (!inputBuffer.length) {
-      return res.status(400).json({ error: 'No video data received' });
-    }
-
-    const ext = getExtFromMimeType(fileContentType);
-    tmpInputPath = path.join('/tmp', `input-${randomUUID()}.${ext}`);
-    await fs.writeFile(tmpInputPath, inputBuffer);
-
-    // Extract audio as mono MP3 at 16kHz (compact format suitable for speech-to-text)
-    tmpAudioPath = path.join('/tmp', `audio-${randomUUID()}.mp3`);
-    await new Promise((resolve, reject) => {
-      ffmpeg(tmpInputPath)
-        .audioFrequency(16000)
-        .audioChannels(1)
-        .audioBitrate('64k')
-        .noVideo()
-        .toFormat('mp3')
-        .on('end', resolve)
-        .on('error', reject)
-        .save(tmpAudioPath);
+    const inputAsset = await acquireInputAsset(req, res, {
+      assetId: req.headers['x-asset-id'],
+      mimeType: fileContentType
     });
+    if (!inputAsset) return;
+    const signal = abortSignalFor(res);
+    const runCaptionFfmpeg = (command) => runFfmpeg(command, { signal });
+
+    // Silences and chunks are read from the source's cached speech rendition, so captioning
+    // the same source again does not decode it again
+    const speech = await acquireAudioRendition(inputAsset, 'speech');
+    res.on('close', () => assetStore.release(speech));
+    const duration = await probeDuration(inputAsset);
+    const silences = duration > 2 * CAPTION_CHUNK_SECONDS
+      ? await detectSilences(speech.path, { runFfmpeg: runCaptionFfmpeg })
+      : [];
+    const chunks = duration
+      ? planTranscriptionChunks(silences, duration, { targetSeconds: CAPTION_CHUNK_SECONDS })
+      : [{ start: 0, end: Infinity }];
+
+    if (streamEvents) {
+      res.setHeader('Content-Type', 'text/event-stream');
+      res.setHeader('Cache-Control', 'no-cache');
+      res.setHeader('Connection', 'keep-alive');
+      res.setHeader('X-Accel-Buffering', 'no');
+      res.flushHeaders();
+      heartbeat = setInterval(() => res.write(': keep-alive\n\n'), 15_000);
+      sendEvent('status', { chunks: chunks.length });
+    }
 
-    // Convert audio to base64 for xAI API
-    const audioBuffer = await fs.readFile(tmpAudioPath);
-    const audioBase64 = audioBuffer.toString('base64');
-
-    // Build transcription prompt
-    const languageInstruction = language === 'auto'
-      ? 'automatically detect the spoken language'
-      : `transcribe in ${language}`;
-
-    // Call xAI audio model for transcription
-    const xaiResponse = await fetch('https://api.x.ai/v1/chat/completions', {
-      method: 'POST',
-      headers: {
-        'Content-Type': 'application/json',
-        'Authorization': `Bearer ${XAI_API_TOKEN}`
+    const clipDir = chunks.length > 1 ? await scratchDirFor(res, 'captions', { small: true }) : null;
+    const cues = await transcribeChunks(chunks, {
+      parallelism: CAPTION_PARALLELISM,
+      // Chunks are cut out of the speech rendition by stream copy; a single chunk is the whole of it
+      transcribe: async (chunk, index) => {
+        if (!clipDir) return transcribeAudioClip(speech.path, language);
+        const audioPath = clipDir.file(`chunk-${index}.mp3`);
+        try {
+          await runCaptionFfmpeg(speechClipCommand(speech.path, chunk).output(audioPath));
+          return await transcribeAudioClip(audioPath, language);
+        } finally {
+          await fs.unlink(audioPath).catch(() => {});
+        }
       },
-      body: JSON.stringify({
-        model: 'grok-2-audio-1212',
-        messages: [{
-          role: 'user',
-          content: [
-            {
-              type: 'text',
-              text: `Please transcribe this audio and ${languageInstruction}. Output ONLY valid SRT subtitle format with accurate timestamps. Use this exact format with no extra text:\n\n1\n00:00:00,000 --> 00:00:02,500\nSubtitle text here\n\n2\n00:00:02,500 --> 00:00:05,000\nMore text`
-            },
-            {
-              type: 'input_audio',
-              input_audio: {
-                data: audioBase64,
-                format: 'mp3'
-              }
-            }
-          ]
-        }]
-      })
+      onChunk: (index, chunkCues) => {
+        if (streamEvents) sendEvent('cues', { index, start: chunks[index].start, srt: formatSrt(chunkCues), cues: chunkCues });
+      }
     });
 
-    if (!xaiResponse.ok) {
-      const errBody = await xaiResponse.json().catch(() => ({}));
-      throw new Error(`xAI API error: ${errBody.error?.message || xaiResponse.statusText}`);
-    }
-
-    const xaiData = await xaiResponse.json();
-    const srtContent = xaiData.choices?.[0]?.message?.content?.trim() || '';
-
-    if (!srtContent) {
+    if (cues.length === 0) {
       throw new Error('No transcription received from xAI API');
     }
 
+    const srtContent = formatSrt(cues);
     const vttContent = srtToVtt(srtContent);
-    res.json({ srt: srtContent, vtt: vttContent });
+    if (streamEvents) {
+      // An event stream's header went out before the work, so its breakdown travels in the final event
+      sendEvent('done', { srt: srtContent, vtt: vttContent, serverTiming: requestTimings.getStore()?.header() });
+      res.end();
+    } else {
+      res.json({ srt: srtContent, vtt: vttContent });
+    }
   } catch (error) {
+    if (res.headersSent && streamEvents) {
+      if (!res.destroyed) {
+        sendEvent('failed', { error: error.message || 'Failed to generate captions' });
+        res.end();
+      }
+      return;
+    }
+    if (error instanceof SchedulerBusyError) return sendBusy(res, error);
     console.error('Error generating captions:', error);
     if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to generate captions' });
   } finally {
-    if (tmpInputPath) await fs.unlink(tmpInputPath).catch(() => {});
-    if (tmpAudioPath) await fs.unlink(tmpAudioPath).catch(() => {});
+    if (heartbeat) clearInterval(heartbeat);
   }
 });
 
-// Caption translation endpoint: translate SRT content to another language via Grok chat
-app.post('/api/translate-captions', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, async (req, res) => {
-  let body = '';
-  for await (const chunk of req) { body += chunk; }
+// Translate one batch of cue texts via Grok chat. Only the texts are sent, as a JSON array,
+// so the cue timings never pass through the model.
+async function translateCueTexts(texts, targetLanguage) {
+  const xaiResponse = await fetchXai('translation', {
+    model: 'grok-3',
+    messages: [
+      {
+        role: 'system',
+        content: 'You are a professional subtitle translator. You will be given a JSON array of subtitle lines and must translate each line to the specified language, keeping line breaks within a line. Output ONLY a JSON array of strings with exactly one translation per input line, in the same order, with no extra commentary.'
+      },
+      {
+        role: 'user',
+        content: `Translate these ${texts.length} subtitle lines to ${targetLanguage}:\n\n${JSON.stringify(texts)}`
+      }
+    ]
+  });
 
-  let parsed;
+  if (!xaiResponse.ok) {
+    const errBody = await xaiResponse.json().catch(() => ({}));
+    throw new Error(`xAI API error: ${errBody.error?.message || xaiResponse.statusText}`);
+  }
+
+  const xaiData = await xaiResponse.json();
+  const content = xaiData.choices?.[0]?.message?.content?.trim() || '';
+  if (!content) {
+    throw new Error('No translation received from xAI API');
+  }
+  return parseTranslatedBatch(content, texts.length);
+}
+
+// Caption translation endpoint: translate SRT content to one language (targetLanguage,
+// answered as { srt, vtt }) or several (targetLanguages, answered as
+// { translations: { [language]: { srt, vtt } } }). Cue batches of every language are
+// translated concurrently and results are cached per (SRT, language).
+app.post('/api/translate-captions', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, async (req, res) => {
+  let body = '';
+  for await (const chunk of req) { body += chunk; }
+
+  let parsed;
   try {
     parsed = JSON.parse(body);
   } catch (e) {
     return res.status(400).json({ error: 'Request body must be valid JSON' });
   }
 
-  const { srtContent, targetLanguage } = parsed;
+  const { srtContent, targetLanguage, targetLanguages } = parsed;
 
   if (!srtContent || typeof srtContent !== 'string' || !srtContent.trim()) {
     return res.status(400).json({ error: 'srtContent is required' });
   }
-  if (!targetLanguage || typeof targetLanguage !== 'string' || !targetLanguage.trim()) {
+  if (parseSrt(srtContent).length === 0) {
+    return res.status(400).json({ error: 'srtContent has no subtitle cues' });
+  }
+  const multiple = targetLanguages !== undefined;
+  if (multiple) {
+    if (!Array.isArray(targetLanguages) || targetLanguages.length === 0 || !targetLanguages.every((language) => typeof language === 'string' && language.trim())) {
+      return res.status(400).json({ error: 'targetLanguages must be a non-empty array of language codes' });
+    }
+    if (targetLanguages.length > MAX_TRANSLATION_LANGUAGES) {
+      return res.status(400).json({ error: `At most ${MAX_TRANSLATION_LANGUAGES} target languages per request` });
+    }
+  } else if (!targetLanguage || typeof targetLanguage !== 'string' || !targetLanguage.trim()) {
     return res.status(400).json({ error: 'targetLanguage is required' });
   }
+  const languages = [...new Set((multiple ? targetLanguages : [targetLanguage]).map((language) => language.trim()))];
 
-  // Validate target language is a simple BCP-47-like code (2-8 alphanumeric chars)
-  if (!/^[a-zA-Z]{2,8}(-[a-zA-Z0-9]{2,8})*$/.test(targetLanguage.trim())) {
+  // Validate target languages are simple BCP-47-like codes (2-8 alphanumeric chars)
+  if (!languages.every((language) => /^[a-zA-Z]{2,8}(-[a-zA-Z0-9]{2,8})*$/.test(language))) {
     return res.status(400).json({ error: 'targetLanguage must be a valid language code (e.g., "es", "fr", "zh")' });
   }
 
   try {
-    const xaiResponse = await fetch('https://api.x.ai/v1/chat/completions', {
-      method: 'POST',
-      headers: {
-        'Content-Type': 'application/json',
-        'Authorization': `Bearer ${XAI_API_TOKEN}`
-      },
-      body: JSON.stringify({
-        model: 'grok-3',
-        messages: [
-          {
-            role: 'system',
-            content: 'You are a professional subtitle translator. You will be given SRT subtitle content and must translate only the dialogue text lines to the specified language. Preserve all sequence numbers and timestamps exactly as-is. Output ONLY the complete translated SRT content with no extra commentary.'
-          },
-          {
-            role: 'user',
-            content: `Translate the following SRT subtitles to ${targetLanguage}. Keep all sequence numbers and timestamps unchanged. Only translate the text lines:\n\n${srtContent}`
-          }
-        ]
-      })
+    const translations = await translationCache.get(srtContent, languages, (srt, missing) => translateSrt(srt, missing, {
+      translateBatch: translateCueTexts,
+      batchSize: TRANSLATION_BATCH_CUES,
+      parallelism: TRANSLATION_PARALLELISM
+    }));
+
+    if (!multiple) {
+      const translatedSrt = translations[languages[0]];
+      return res.json({ srt: translatedSrt, vtt: srtToVtt(translatedSrt) });
+    }
+    res.json({
+      translations: Object.fromEntries(languages.map((language) => [
+        language, { srt: translations[language], vtt: srtToVtt(translations[language]) }
+      ]))
     });
+  } catch (error) {
+    console.error('Error translating captions:', error);
+    if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to translate captions' });
+  }
+});
+
+const AUDIO_CONTENT_TYPES = {
+  mp3: 'audio/mpeg', wav: 'audio/wav', aac: 'audio/aac',
+  ogg: 'audio/ogg', flac: 'audio/flac', m4a: 'audio/mp4', wma: 'audio/x-ms-wma'
+};
+const VIDEO_CONTENT_TYPES = {
+  mp4: 'video/mp4', webm: 'video/webm', mov: 'video/quicktime',
+  avi: 'video/x-msvideo', mkv: 'video/x-matroska', flv: 'video/x-flv', ogv: 'video/ogg'
+};
+
+// Build the FFmpeg command for a single-input operation (or an apply_operations batch)
+// reading the stored, seekable input asset. Returns { command, outputExt, mimeType }, or
+// { error } when the operation or its args are invalid. Operations that need several
+// FFmpeg passes return { render(outputPath, { signal }), outputExt, mimeType } instead.
+// Video re-encodes use libx264 with the given encode profile. inputInfo is what
+// processInputInfo measured: long inputs are encoded in parallel segments or audio chunks,
+// and audio is normalized in linear mode from measured loudness stats.
+function buildProcessCommand(input, operation, parsedArgs, encodeProfile, { duration, loudness } = {}) {
+  const inputPath = input.path;
+  // Frame-accurate trim: re-encode only the partial GOPs at each edge, copy the rest.
+  // mode 'fast' keeps the old keyframe-snapped stream copy.
+  const trimStart = parseTimeToSeconds(parsedArgs.start);
+  const trimEnd = parseTimeToSeconds(parsedArgs.end);
+  if (operation === 'trim_video' && !(trimStart >= 0 && trimEnd > trimStart)) {
+    return { error: 'start and end must be times with 0 <= start < end' };
+  }
+  if (operation === 'trim_video' && duration > 0 && trimStart >= duration) {
+    return { error: `start must be before the end of the video (${duration.toFixed(3)}s)` };
+  }
+  if (operation === 'trim_video' && parsedArgs.mode !== 'fast') {
+    return {
+      render: async (outputPath, { signal } = {}) => smartCut({
+        inputPath, start: trimStart, end: trimEnd, outputPath,
+        metadata: await probeInput(input),
+        runFfmpeg: (command) => runFfmpeg(command, { signal }),
+        scratch: scratchArena,
+        // Edges are spliced next to copied source frames, so they never drop below CRF 18
+        videoEncodeOptions: x264OutputOptions({ ...encodeProfile, crf: Math.min(encodeProfile.crf, 18) })
+      }),
+      outputExt: 'mp4',
+      mimeType: 'video/mp4'
+    };
+  }
 
-    if (!xaiResponse.ok) {
-      const errBody = await xaiResponse.json().catch(() => ({}));
-      throw new Error(`xAI API error: ${errBody.error?.message || xaiResponse.statusText}`);
+  // Soft subtitles are a remux: video and audio are copied, captions become mov_text tracks
+  if (operation === 'mux_subtitles') {
+    const { tracks, error } = subtitleTracksFromArgs(parsedArgs);
+    if (error) return { error };
+    return {
+      render: (outputPath, { signal } = {}) => muxSoftSubtitles({
+        inputPath, outputPath, tracks,
+        runFfmpeg: (command) => runFfmpeg(command, { signal }),
+        scratch: scratchArena
+      }),
+      outputExt: 'mp4',
+      mimeType: 'video/mp4'
+    };
+  }
+
+  let outputExt = 'mp4';
+  if (operation === 'extract_audio') {
+    outputExt = parsedArgs.format || 'mp3';
+  } else if (operation === 'convert_video_format' || operation === 'convert_audio_format') {
+    outputExt = parsedArgs.format || 'mp4';
+  }
+
+  // Determine response Content-Type based on operation and output format
+  const audioOnlyOps = ['convert_audio_format', 'extract_audio'];
+  let mimeType = 'video/mp4';
+  if (audioOnlyOps.includes(operation)) {
+    mimeType = AUDIO_CONTENT_TYPES[outputExt] || 'application/octet-stream';
+  } else if (operation === 'convert_video_format') {
+    mimeType = VIDEO_CONTENT_TYPES[outputExt] || 'video/mp4';
+  }
+
+  let command = ffmpeg(inputPath);
+
+  switch (operation) {
+    case 'trim_video':
+      command = command.setStartTime(trimStart).setDuration(trimEnd - trimStart).outputOptions('-c copy');
+      break;
+
+    case 'convert_video_format': {
+      const supportedVideoFormats = ['mp4', 'webm', 'mov', 'avi', 'mkv', 'flv', 'ogv'];
+      if (!parsedArgs.format || !supportedVideoFormats.includes(parsedArgs.format)) {
+        return { error: `format must be one of: ${supportedVideoFormats.join(', ')}` };
+      }
+      const supportedVideoCodecs = ['libx264', 'libx265', 'libvpx-vp9', 'auto'];
+      if (parsedArgs.codec && !supportedVideoCodecs.includes(parsedArgs.codec)) {
+        return { error: `codec must be one of: ${supportedVideoCodecs.join(', ')}` };
+      }
+      const codec = parsedArgs.codec && parsedArgs.codec !== 'auto' ? parsedArgs.codec : null;
+      if (codec === 'libx264') {
+        command = command.videoCodec(codec).outputOptions(x264OutputOptions(encodeProfile)).audioCodec('copy');
+      } else if (codec) {
+        command = command.videoCodec(codec).audioCodec('copy');
+      } else {
+        command = command.outputOptions('-c copy');
+      }
+      break;
     }
 
-    const xaiData = await xaiResponse.json();
-    const translatedSrt = xaiData.choices?.[0]?.message?.content?.trim() || '';
+    case 'convert_audio_format': {
+      const supportedAudioFormats = ['mp3', 'wav', 'aac', 'ogg', 'flac', 'm4a', 'wma'];
+      if (!parsedArgs.format || !supportedAudioFormats.includes(parsedArgs.format)) {
+        return { error: `format must be one of: ${supportedAudioFormats.join(', ')}` };
+      }
+      command = command.noVideo().audioBitrate(parsedArgs.bitrate || '192k');
+      break;
+    }
 
-    if (!translatedSrt) {
-      throw new Error('No translation received from xAI API');
+    case 'extract_audio': {
+      const supportedExtractFormats = ['mp3', 'wav', 'aac', 'ogg', 'flac', 'm4a'];
+      if (!supportedExtractFormats.includes(outputExt)) {
+        return { error: `format must be one of: ${supportedExtractFormats.join(', ')}` };
+      }
+      command = command.noVideo().audioBitrate(parsedArgs.bitrate || '192k');
+      break;
     }
 
-    const translatedVtt = srtToVtt(translatedSrt);
-    res.json({ srt: translatedSrt, vtt: translatedVtt });
-  } catch (error) {
-    console.error('Error translating captions:', error);
-    if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to translate captions' });
+    case 'crossfade_transition':
+      return { error: 'crossfade_transition requires special multi-video handling' };
+
+    default: {
+      // Filter operations, and batches of them (apply_operations), compile into one -vf/-af chain
+      if (operation !== 'apply_operations' && !isFilterOperation(operation)) {
+        return { error: `Unknown operation: ${operation}` };
+      }
+      try {
+        const operations = operation === 'apply_operations' ? parsedArgs.operations : [{ operation, args: parsedArgs }];
+        const compiled = compileOperations(operations, { loudness });
+
+        // Long videos are split at keyframes and their segments encoded concurrently
+        if (compiled.videoFilters.length > 0 && SEGMENTED_ENCODE_MIN_SECONDS > 0 &&
+            duration >= SEGMENTED_ENCODE_MIN_SECONDS && canEncodeInSegments(operations)) {
+          return {
+            render: async (outputPath, { signal } = {}) => segmentedEncode({
+              inputPath, outputPath, ...compiled,
+              metadata: await probeInput(input),
+              // Segments share the cores between them, like scheduler jobs do
+              videoEncodeOptions: x264OutputOptions({
+                ...encodeProfile,
+                threads: Math.max(1, Math.round(1 / FFMPEG_JOBS_PER_CORE))
+              }),
+              runFfmpeg: (segmentCommand) => runFfmpeg(segmentCommand, { signal }),
+              parallelism: ffmpegScheduler.concurrency,
+              segmentSeconds: SEGMENT_SECONDS,
+              scratch: scratchArena
+            }),
+            outputExt: 'mp4',
+            mimeType: 'video/mp4'
+          };
+        }
+
+        // areverse buffers the whole decoded track; longer audio is reversed chunk by chunk
+        const reverseOnly = compiled.videoFilters.length === 0 &&
+          compiled.audioFilters.length === 1 && compiled.audioFilters[0] === 'areverse';
+        if (reverseOnly && duration > AUDIO_CHUNK_SECONDS) {
+          return {
+            render: async (outputPath, { signal } = {}) => chunkedAudioReverse({
+              inputPath, outputPath,
+              metadata: await probeInput(input),
+              runFfmpeg: (chunkCommand) => runFfmpeg(chunkCommand, { signal }),
+              parallelism: ffmpegScheduler.concurrency,
+              chunkSeconds: AUDIO_CHUNK_SECONDS,
+              scratch: scratchArena
+            }),
+            outputExt: 'mp4',
+            mimeType: 'video/mp4'
+          };
+        }
+
+        // Long audio through single-threaded filters is processed in overlapping chunks
+        const settleSeconds = compiled.videoFilters.length === 0 ? audioChunkSettleSeconds(operations) : null;
+        if (settleSeconds !== null && CHUNKED_AUDIO_MIN_SECONDS > 0 && duration >= CHUNKED_AUDIO_MIN_SECONDS) {
+          return {
+            render: async (outputPath, { signal } = {}) => chunkedAudioRender({
+              inputPath, outputPath,
+              audioFilters: compiled.audioFilters,
+              metadata: await probeInput(input),
+              runFfmpeg: (chunkCommand) => runFfmpeg(chunkCommand, { signal }),
+              parallelism: ffmpegScheduler.concurrency,
+              chunkSeconds: AUDIO_CHUNK_SECONDS,
+              preRoll: Math.max(1, settleSeconds),
+              scratch: scratchArena
+            }),
+            outputExt: 'mp4',
+            mimeType: 'video/mp4'
+          };
+        }
+
+        command = applyCompiledFilters(command, compiled);
+        if (compiled.videoFilters.length > 0) {
+          command = command.videoCodec('libx264').outputOptions(x264OutputOptions(encodeProfile));
+        }
+      } catch (error) {
+        return { error: error.message };
+      }
+      break;
+    }
   }
-});
+
+  if (outputExt === 'mp4') {
+    command.outputOptions(['-movflags', 'frag_keyframe+empty_moov+default_base_moof']);
+  }
+  return { command: command.toFormat(outputExt), outputExt, mimeType };
+}
 
 // Video processing endpoint
 // Client posts video as a raw body stream; operation, args, and file type are in request headers.
-// For add_audio_track and burn_subtitles (which require secondary inputs), FormData/multipart is used.
-app.post('/api/process-video', videoProcessLimiter, requireAuthenticatedUser, requireActiveSubscription, async (req, res) => {
+// For add_audio_track, burn_subtitles and mux_subtitles (which require secondary inputs or
+// large args), FormData/multipart is used.
+app.post('/api/process-video', recordServerTiming, requireAuthenticatedUser, requireActiveSubscription, rejectWhenSaturated, limitEncodeCost(), async (req, res) => {
   const contentType = (req.headers['content-type'] || '').toLowerCase();
 
-  // FormData path: for add_audio_track and burn_subtitles
+  // FormData path: for add_audio_track, burn_subtitles and mux_subtitles
   if (contentType.includes('multipart/form-data')) {
     let multerError = null;
-    await new Promise((resolve) => {
+    await timePhase('ingest', () => new Promise((resolve) => {
       upload.single('video')(req, res, (err) => { multerError = err || null; resolve(); });
-    });
-    if (multerError) return res.status(400).json({ error: multerError.message });
-    if (!req.file) return res.status(400).json({ error: 'No video file provided' });
+    }));
+    if (multerError) return res.status(uploadErrorStatus(multerError)).json({ error: multerError.message, code: multerError.code });
+    if (!req.file && !req.body.assetId) return res.status(400).json({ error: 'No video file provided' });
 
     const { operation, args } = req.body;
     if (!operation) return res.status(400).json({ error: 'No operation specified' });
-    if (operation !== 'add_audio_track' && operation !== 'burn_subtitles') {
+    if (operation !== 'add_audio_track' && operation !== 'burn_subtitles' && operation !== 'mux_subtitles') {
       return res.status(400).json({ error: 'Use streaming request (video body + x-operation header) for this operation' });
     }
 
-    const parsedArgs = typeof args === 'string' ? JSON.parse(args) : args;
+    const requestArgs = typeof args === 'string' ? JSON.parse(args) : args;
+    const encodeProfile = requestEncodeProfile(req, res, requestArgs);
+    if (!encodeProfile) return;
+    // The profile is part of the args so renders in different profiles are cached separately
+    const parsedArgs = { ...requestArgs, encodeProfile: encodeProfile.name };
+
+    // Muxing is cheap enough to run on whatever the client has, so proxy previews stay proxies
+    // and the tracks are replayed onto the full-resolution source at export
+    if (operation === 'mux_subtitles') {
+      const { error: argsError } = subtitleTracksFromArgs(parsedArgs);
+      if (argsError) return res.status(400).json({ error: argsError });
+      try {
+        const inputAsset = await acquireInputAsset(req, res, {
+          assetId: req.body.assetId,
+          mimeType: req.file?.mimetype || 'video/mp4'
+        });
+        if (!inputAsset) return;
+        const lineage = inputAsset.meta?.lineage || null;
+        if (lineage) res.set('x-proxy', '1');
+        const cacheKey = renderCacheKey(inputAsset.id, operation, parsedArgs);
+        if (await serveCachedRender(res, cacheKey)) return;
+
+        await sendRenderedFile(res, buildProcessCommand(inputAsset, operation, parsedArgs, encodeProfile), {
+          label: operation,
+          cacheKey,
+          meta: lineage ? { lineage: extendLineage(lineage, operation, parsedArgs) } : undefined
+        });
+      } catch (error) {
+        if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to add subtitle tracks' });
+      }
+      return;
+    }
 
     if (operation === 'burn_subtitles') {
       const { srtContent, translatedSrtContent, style = 'default', position = 'bottom' } = parsedArgs;
       if (!srtContent || typeof srtContent !== 'string' || !srtContent.trim()) {
         return res.status(400).json({ error: 'srtContent is required for burn_subtitles' });
       }
-      const validStyles = ['default', 'white_on_black', 'yellow'];
-      const validPositions = ['bottom', 'top'];
-      if (!validStyles.includes(style)) {
-        return res.status(400).json({ error: `style must be one of: ${validStyles.join(', ')}` });
+      if (!SUBTITLE_STYLES.includes(style)) {
+        return res.status(400).json({ error: `style must be one of: ${SUBTITLE_STYLES.join(', ')}` });
       }
-      if (!validPositions.includes(position)) {
-        return res.status(400).json({ error: `position must be one of: ${validPositions.join(', ')}` });
+      if (!SUBTITLE_POSITIONS.includes(position)) {
+        return res.status(400).json({ error: `position must be one of: ${SUBTITLE_POSITIONS.join(', ')}` });
+      }
+      const cues = parseSrt(srtContent);
+      if (cues.length === 0) {
+        return res.status(400).json({ error: 'srtContent has no subtitle cues' });
       }
 
+      // Both tracks go into one ASS document; the translated track is placed at the opposite end of the video
       const hasTranslation = typeof translatedSrtContent === 'string' && translatedSrtContent.trim().length > 0;
+      const assDocument = buildAssDocument({
+        cues,
+        translatedCues: hasTranslation ? parseSrt(translatedSrtContent) : [],
+        style,
+        position
+      });
 
-      let inputPath = null;
-      let srtPath = null;
-      let translatedSrtPath = null;
+      const writeAssDocument = async () => {
+        const assPath = (await scratchDirFor(res, 'subtitles', { small: true })).file('subtitles.ass');
+        await timePhase('spool', () => fs.writeFile(assPath, assDocument, 'utf8'));
+        return assPath;
+      };
       try {
-        const tmpDir = '/tmp';
-        inputPath = path.join(tmpDir, `input-${randomUUID()}.mp4`);
-        await fs.writeFile(inputPath, req.file.buffer);
-
-        srtPath = path.join(tmpDir, `subtitles-${randomUUID()}.srt`);
-        await fs.writeFile(srtPath, srtContent, 'utf8');
-
-        // Build ASS/SSA style override string.
-        // ASS colour format: &HAABBGGRR (AA=alpha 00=opaque 80=semi-transparent, BB=blue, GG=green, RR=red)
-        // ASS Alignment values: 2=bottom-center, 8=top-center (numpad layout)
-        const ASS_ALIGN_BOTTOM = 2;
-        const ASS_ALIGN_TOP = 8;
-        const alignment = position === 'top' ? ASS_ALIGN_TOP : ASS_ALIGN_BOTTOM;
-        let forceStyle = `FontSize=20,Alignment=${alignment}`;
-        if (style === 'white_on_black') {
-          // White text (&H00FFFFFF) on semi-transparent black background (&H80000000, alpha=0x80)
-          forceStyle += ',PrimaryColour=&H00FFFFFF,OutlineColour=&H00000000,BackColour=&H80000000,BorderStyle=4,Outline=0,Shadow=0';
-        } else if (style === 'yellow') {
-          // Yellow text (&H0000FFFF = BGR yellow) with black outline
-          forceStyle += ',PrimaryColour=&H0000FFFF,OutlineColour=&H00000000,Bold=1';
-        } else {
-          // Default: white text with black outline
-          forceStyle += ',PrimaryColour=&H00FFFFFF,OutlineColour=&H00000000,Bold=0';
-        }
-
-        // Forward-slash path for FFmpeg's subtitles filter (runs on Linux; UUID has no special chars).
-        // Escape backslashes first, then single quotes for safe embedding in the filter string.
-        const escapedSrtPath = srtPath.replace(/\\/g, '\\\\').replace(/'/g, "\\'");
-
-        // Build the video filter chain: if a translated track is provided, chain two subtitle filters
-        let videoFilter;
-        if (hasTranslation) {
-          translatedSrtPath = path.join(tmpDir, `translated-${randomUUID()}.srt`);
-          await fs.writeFile(translatedSrtPath, translatedSrtContent, 'utf8');
-
-          // Translated track is placed at the opposite end of the video
-          const translatedAlignment = position === 'top' ? ASS_ALIGN_BOTTOM : ASS_ALIGN_TOP;
-          let translatedForceStyle = `FontSize=18,Alignment=${translatedAlignment}`;
-          if (style === 'white_on_black') {
-            translatedForceStyle += ',PrimaryColour=&H00FFFFFF,OutlineColour=&H00000000,BackColour=&H80000000,BorderStyle=4,Outline=0,Shadow=0';
-          } else if (style === 'yellow') {
-            translatedForceStyle += ',PrimaryColour=&H0000FFFF,OutlineColour=&H00000000,Bold=1';
-          } else {
-            translatedForceStyle += ',PrimaryColour=&H00FFFFFF,OutlineColour=&H00000000,Bold=0';
+        const inputAsset = await acquireFullResolutionInput(res, await acquireInputAsset(req, res, {
+          assetId: req.body.assetId,
+          mimeType: req.file?.mimetype || 'video/mp4'
+        }), encodeProfile);
+        if (!inputAsset) return;
+        const cacheKey = renderCacheKey(inputAsset.id, operation, parsedArgs);
+        if (await serveCachedRender(res, cacheKey)) return;
+
+        // The subtitles are rendered once per (document, frame format) into a transparent
+        // overlay kept in the render cache, then composited onto the video
+        const format = overlayFormat(await probeInput(inputAsset).catch(() => null));
+        let command;
+        if (format) {
+          const overlayKey = renderCacheKey(createHash('sha256').update(assDocument).digest('hex'), 'subtitle_overlay', format);
+          let overlay = await renderCache.lookup(overlayKey, { internal: true });
+          if (!overlay) {
+            overlay = await renderToAsset(
+              { command: subtitleOverlayCommand(await writeAssDocument(), format), outputExt: 'mov', mimeType: 'video/quicktime' },
+              { signal: abortSignalFor(res), cacheKey: overlayKey }
+            );
           }
-
-          const escapedTranslatedSrtPath = translatedSrtPath.replace(/\\/g, '\\\\').replace(/'/g, "\\'");
-          // Chain both subtitle filters: first burn primary, then burn translation on top
-          videoFilter = `subtitles='${escapedSrtPath}':force_style='${forceStyle}',subtitles='${escapedTranslatedSrtPath}':force_style='${translatedForceStyle}'`;
+          const heldOverlay = await assetStore.acquire(overlay.id);
+          if (!heldOverlay) throw new Error('Subtitle overlay was evicted before use');
+          res.on('close', () => assetStore.release(heldOverlay));
+          command = ffmpeg(inputAsset.path)
+            .input(heldOverlay.path)
+            .complexFilter('[0:v][1:v]overlay=eof_action=pass:repeatlast=0[v]')
+            .outputOptions(['-map', '[v]', '-map', '0:a?']);
         } else {
-          videoFilter = `subtitles='${escapedSrtPath}':force_style='${forceStyle}'`;
+          command = ffmpeg(inputAsset.path).videoFilters(assFilter(await writeAssDocument()));
         }
 
-        res.set('Content-Type', 'video/mp4');
-        ffmpeg(inputPath)
-          .videoFilters(videoFilter)
+        command
+          .videoCodec('libx264')
+          .outputOptions(x264OutputOptions(encodeProfile))
           .audioCodec('copy')
           .outputOptions(['-movflags', 'frag_keyframe+empty_moov+default_base_moof'])
-          .toFormat('mp4')
-          .on('error', (err) => {
-            [inputPath, srtPath, translatedSrtPath].forEach(p => p && fs.unlink(p).catch(() => {}));
-            console.error('FFmpeg error (burn_subtitles):', err);
-            if (!res.headersSent) res.status(500).end();
-          })
-          .on('end', () => { [inputPath, srtPath, translatedSrtPath].forEach(p => p && fs.unlink(p).catch(() => {})); })
-          .pipe(res);
+          .toFormat('mp4');
+        await streamAndRetainOutput(command, res, {
+          mimeType: 'video/mp4',
+          ext: 'mp4',
+          label: 'burn_subtitles',
+          cacheKey
+        });
       } catch (error) {
-        [inputPath, srtPath, translatedSrtPath].forEach(p => p && fs.unlink(p).catch(() => {}));
+        if (error instanceof SchedulerBusyError) return sendBusy(res, error);
         if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to burn subtitles' });
       }
       return;
     }
 
-    // add_audio_track path
-    let inputPath = null;
-    let audioInputPath = null;
+    // add_audio_track path. The arguments are checked before a proxy input is rendered at
+    // full resolution for them.
+    const mode = parsedArgs.mode || 'replace';
+    const volume = parsedArgs.volume ?? 1.0;
+    if (mode !== 'replace' && mode !== 'mix') {
+      return res.status(400).json({ error: 'Mode must be either "replace" or "mix"' });
+    }
+    if (typeof volume !== 'number' || Number.isNaN(volume) || volume < 0 || volume > 2) {
+      return res.status(400).json({ error: 'Volume must be between 0.0 and 2.0' });
+    }
+    let parsedAudio;
     try {
-      const tmpDir = '/tmp';
-      inputPath = path.join(tmpDir, `input-${randomUUID()}.mp4`);
-      await fs.writeFile(inputPath, req.file.buffer);
-
-      const parsedAudio = parseAudioInput(parsedArgs.audioFile);
-      audioInputPath = path.join(tmpDir, `audio-${randomUUID()}.${parsedAudio.extension}`);
-      await fs.writeFile(audioInputPath, parsedAudio.buffer);
-
-      const sourceHasAudio = await checkHasAudioStream(inputPath);
-      const mode = parsedArgs.mode || 'replace';
-      const volume = parsedArgs.volume ?? 1.0;
-      if (mode !== 'replace' && mode !== 'mix') {
-        return res.status(400).json({ error: 'Mode must be either "replace" or "mix"' });
-      }
-      if (typeof volume !== 'number' || Number.isNaN(volume) || volume < 0 || volume > 2) {
-        return res.status(400).json({ error: 'Volume must be between 0.0 and 2.0' });
-      }
+      parsedAudio = parseAudioInput(parsedArgs.audioFile);
+    } catch (error) {
+      return res.status(400).json({ error: error.message });
+    }
+
+    try {
+      const inputAsset = await acquireFullResolutionInput(res, await acquireInputAsset(req, res, {
+        assetId: req.body.assetId,
+        mimeType: req.file?.mimetype || 'video/mp4'
+      }), encodeProfile);
+      if (!inputAsset) return;
+      const inputPath = inputAsset.path;
+      const cacheKey = renderCacheKey(inputAsset.id, operation, parsedArgs);
+      if (await serveCachedRender(res, cacheKey)) return;
+
+      const audioDir = await scratchDirFor(res, 'add-audio', {
+        small: parsedAudio.buffer.length <= SMALL_SCRATCH_FILE_BYTES,
+        reserveBytes: parsedAudio.buffer.length
+      });
+      const audioInputPath = audioDir.file(`audio.${parsedAudio.extension}`);
+      await timePhase('spool', () => fs.writeFile(audioInputPath, parsedAudio.buffer));
+
+      const sourceHasAudio = await checkHasAudioStream(inputAsset);
 
       let command = ffmpeg(inputPath).input(audioInputPath);
       if (mode === 'mix' && sourceHasAudio) {
@@ -949,19 +1996,16 @@ app.post('/api/process-video', videoProcessLimiter, requireAuthenticatedUser, re
           .complexFilter([`[1:a]volume=${volume}[newaudio]`], ['newaudio'])
           .outputOptions(['-map 0:v:0', '-map [newaudio]', '-c:v copy', '-c:a aac', '-shortest']);
       }
-      res.set('Content-Type', 'video/mp4');
       command
         .outputOptions(['-movflags', 'frag_keyframe+empty_moov+default_base_moof'])
-        .toFormat('mp4')
-        .on('error', (err) => {
-          [inputPath, audioInputPath].forEach(p => p && fs.unlink(p).catch(() => {}));
-          console.error('FFmpeg error:', err);
-          if (!res.headersSent) res.status(500).end();
-        })
-        .on('end', () => { [inputPath, audioInputPath].forEach(p => p && fs.unlink(p).catch(() => {})); })
-        .pipe(res);
+        .toFormat('mp4');
+      await streamAndRetainOutput(command, res, {
+        mimeType: 'video/mp4',
+        ext: 'mp4',
+        label: 'add_audio_track',
+        cacheKey
+      });
     } catch (error) {
-      [inputPath, audioInputPath].forEach(p => p && fs.unlink(p).catch(() => {}));
       if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to process video' });
     }
     return;
@@ -982,720 +2026,414 @@ app.post('/api/process-video', videoProcessLimiter, requireAuthenticatedUser, re
   } catch (e) {
     return res.status(400).json({ error: 'Invalid x-args header: must be valid JSON' });
   }
-
-  const conversionOps = ['convert_video_format', 'convert_audio_format', 'extract_audio'];
-  let outputExt = 'mp4';
-  if (conversionOps.includes(operation)) {
-    outputExt = parsedArgs.format || 'mp4';
+  const encodeProfile = requestEncodeProfile(req, res, parsedArgs);
+  if (!encodeProfile) return;
+  // The profile is part of the args so renders in different profiles are cached separately
+  parsedArgs = { ...parsedArgs, encodeProfile: encodeProfile.name };
+
+  // The input is either an asset the server already holds (x-asset-id) or the raw body,
+  // which is stored once so later operations can reference it.
+  let inputAsset;
+  try {
+    inputAsset = await acquireInputAsset(req, res, {
+      assetId: req.headers['x-asset-id'],
+      mimeType: fileContentType
+    });
+  } catch (error) {
+    console.error('Error receiving video:', error);
+    if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to receive video' });
+    return;
   }
+  if (!inputAsset) return;
 
-  const inputFormat = getMimeTypeToFormat(fileContentType);
-
-  // Special case: get_video_info uses ffprobe which requires a seekable (on-disk) input
   if (operation === 'get_video_info') {
-    let tmpInputPath = null;
     try {
-      const chunks = [];
-      for await (const chunk of req) { chunks.push(chunk); }
-      const inputBuffer = Buffer.concat(chunks);
-      tmpInputPath = path.join('/tmp', `input-${randomUUID()}.${getExtFromMimeType(fileContentType)}`);
-      await fs.writeFile(tmpInputPath, inputBuffer);
-      await new Promise((resolve, reject) => {
-        ffmpeg.ffprobe(tmpInputPath, (err, metadata) => {
-          if (err) reject(err);
-          else { res.json(metadata); resolve(); }
-        });
-      });
+      let metadata = await probeInput(inputAsset);
+      // Proxy previews report the dimensions of the full-resolution edit, since operation
+      // args are always given in source pixels
+      const scale = inputAsset.meta?.lineage?.scale;
+      if (scale) {
+        metadata = structuredClone(metadata);
+        for (const stream of metadata.streams || []) {
+          if (stream.codec_type !== 'video') continue;
+          stream.width = Math.round((stream.width * scale) / 2) * 2;
+          stream.height = Math.round((stream.height * scale) / 2) * 2;
+        }
+      }
+      res.json(metadata);
     } catch (error) {
       console.error('Error getting video info:', error);
       if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to get video info' });
-    } finally {
-      if (tmpInputPath) await fs.unlink(tmpInputPath).catch(() => {});
     }
     return;
   }
 
-  // Determine response Content-Type based on operation and output format
-  const AUDIO_CONTENT_TYPES = {
-    mp3: 'audio/mpeg', wav: 'audio/wav', aac: 'audio/aac',
-    ogg: 'audio/ogg', flac: 'audio/flac', m4a: 'audio/mp4', wma: 'audio/x-ms-wma'
-  };
-  const VIDEO_CONTENT_TYPES = {
-    mp4: 'video/mp4', webm: 'video/webm', mov: 'video/quicktime',
-    avi: 'video/x-msvideo', mkv: 'video/x-matroska', flv: 'video/x-flv', ogv: 'video/ogg'
-  };
-  const audioOnlyOps = ['convert_audio_format', 'extract_audio'];
-  let responseContentType = 'video/mp4';
-  if (audioOnlyOps.includes(operation)) {
-    responseContentType = AUDIO_CONTENT_TYPES[outputExt] || 'application/octet-stream';
-  } else if (operation === 'convert_video_format') {
-    responseContentType = VIDEO_CONTENT_TYPES[outputExt] || 'video/mp4';
+  // Large videos are edited through their low-resolution proxy
+  let working;
+  try {
+    working = await interactiveInput(req, inputAsset, operation, { signal: abortSignalFor(res), encodeProfile });
+  } catch (error) {
+    return sendRenderError(res, error, operation);
   }
+  res.on('close', () => assetStore.release(working.acquired));
+  const { lineage } = working;
+  const meta = lineage ? { lineage: extendLineage(lineage, operation, parsedArgs) } : undefined;
+  if (lineage) res.set('x-proxy', '1');
 
-  // Build ffmpeg command: pipe request body to ffmpeg stdin
-  let command = ffmpeg(req).inputFormat(inputFormat);
-
-  switch (operation) {
-    case 'resize_video':
-      command = command.videoFilters(`scale=${parsedArgs.width}:${parsedArgs.height}`).audioCodec('copy');
-      break;
-
-    case 'crop_video':
-      command = command.videoFilters(`crop=${parsedArgs.width}:${parsedArgs.height}:${parsedArgs.x}:${parsedArgs.y}`).audioCodec('copy');
-      break;
-
-    case 'rotate_video':
-      command = command.videoFilters(`rotate=${parsedArgs.angle}*PI/180`).audioCodec('copy');
-      break;
-
-    case 'flip_video_horizontal':
-      command = command.videoFilters('hflip').audioCodec('copy');
-      break;
-
-    case 'add_text': {
-      const escapedText = parsedArgs.text
-        .replace(/\\/g, '\\\\')
-        .replace(/'/g, "\\'")
-        .replace(/:/g, '\\:')
-        .replace(/\n/g, '\\n')
-        .replace(/\r/g, '')
-        .replace(/\t/g, '\\t');
-      command = command.videoFilters(
-        `drawtext=text='${escapedText}':x=${parsedArgs.x || 10}:y=${parsedArgs.y || 10}:fontsize=${parsedArgs.fontsize || 24}:fontcolor=${parsedArgs.color || 'white'}`
-      ).audioCodec('copy');
-      break;
-    }
-
-    case 'trim_video':
-      command = command.setStartTime(parsedArgs.start).setDuration(parsedArgs.end - parsedArgs.start).outputOptions('-c copy');
-      break;
-
-    case 'speed_video': {
-      let audioFilter = '';
-      const speed = parsedArgs.speed;
-      if (speed >= 0.5 && speed <= 2.0) {
-        audioFilter = `atempo=${speed}`;
-      } else if (speed < 0.5) {
-        let remainingSpeed = speed;
-        const filters = [];
-        while (remainingSpeed < 0.5) { filters.push('atempo=0.5'); remainingSpeed *= 2; }
-        if (remainingSpeed !== 1.0) filters.push(`atempo=${remainingSpeed}`);
-        audioFilter = filters.join(',');
-      } else {
-        let remainingSpeed = speed;
-        const filters = [];
-        while (remainingSpeed > 2.0) { filters.push('atempo=2.0'); remainingSpeed /= 2; }
-        if (remainingSpeed !== 1.0) filters.push(`atempo=${remainingSpeed}`);
-        audioFilter = filters.join(',');
-      }
-      command = command.videoFilters(`setpts=PTS/${parsedArgs.speed}`).audioFilters(audioFilter);
-      break;
-    }
-
-    case 'adjust_volume':
-      command = command.audioFilters(`volume=${parsedArgs.volume}`).videoCodec('copy');
-      break;
-
-    case 'audio_fade': {
-      const fadeFilter = parsedArgs.type === 'in'
-        ? `afade=t=in:st=${parsedArgs.start}:d=${parsedArgs.duration}`
-        : `afade=t=out:st=${parsedArgs.start}:d=${parsedArgs.duration}`;
-      command = command.audioFilters(fadeFilter).videoCodec('copy');
-      break;
-    }
-
-    case 'highpass_filter':
-      command = command.audioFilters(`highpass=f=${parsedArgs.frequency}`).videoCodec('copy');
-      break;
-
-    case 'lowpass_filter':
-      command = command.audioFilters(`lowpass=f=${parsedArgs.frequency}`).videoCodec('copy');
-      break;
-
-    case 'echo_effect':
-      command = command.audioFilters(`aecho=1.0:0.7:${parsedArgs.delay}:${parsedArgs.decay}`).videoCodec('copy');
-      break;
-
-    case 'bass_adjustment':
-      command = command.audioFilters(`bass=g=${parsedArgs.gain}`).videoCodec('copy');
-      break;
-
-    case 'treble_adjustment':
-      command = command.audioFilters(`treble=g=${parsedArgs.gain}`).videoCodec('copy');
-      break;
-
-    case 'equalizer': {
-      const eqWidth = parsedArgs.width || 200;
-      command = command.audioFilters(`equalizer=f=${parsedArgs.frequency}:width_type=h:width=${eqWidth}:g=${parsedArgs.gain}`).videoCodec('copy');
-      break;
-    }
-
-    case 'normalize_audio': {
-      const normTarget = parsedArgs.target || -16;
-      command = command.audioFilters(`loudnorm=I=${normTarget}:TP=-1.5:LRA=11`).videoCodec('copy');
-      break;
-    }
-
-    case 'delay_audio':
-      command = command.audioFilters(`adelay=${parsedArgs.delay}|${parsedArgs.delay}`).videoCodec('copy');
-      break;
-
-    case 'audio_chorus': {
-      const chorusInGain = parsedArgs.in_gain ?? 0.5;
-      const chorusOutGain = parsedArgs.out_gain ?? 0.9;
-      const chorusDelays = parsedArgs.delays ?? '40|60|80';
-      const chorusDecays = parsedArgs.decays ?? '0.4|0.5|0.6';
-      const chorusSpeeds = parsedArgs.speeds ?? '0.5|0.6|0.7';
-      const chorusDepths = parsedArgs.depths ?? '0.25|0.4|0.35';
-      command = command.audioFilters(`chorus=${chorusInGain}:${chorusOutGain}:${chorusDelays}:${chorusDecays}:${chorusSpeeds}:${chorusDepths}:t`).videoCodec('copy');
-      break;
-    }
-
-    case 'audio_flanger': {
-      const flangerDelay = parsedArgs.delay ?? 0;
-      const flangerDepth = parsedArgs.depth ?? 2;
-      const flangerRegen = parsedArgs.regen ?? 0;
-      const flangerWidth = parsedArgs.width ?? 71;
-      const flangerSpeed = parsedArgs.speed ?? 0.5;
-      command = command.audioFilters(`flanger=delay=${flangerDelay}:depth=${flangerDepth}:regen=${flangerRegen}:width=${flangerWidth}:speed=${flangerSpeed}`).videoCodec('copy');
-      break;
-    }
-
-    case 'audio_phaser': {
-      const phaserInGain = parsedArgs.in_gain ?? 0.4;
-      const phaserOutGain = parsedArgs.out_gain ?? 0.74;
-      const phaserDelay = parsedArgs.delay ?? 3;
-      const phaserDecay = parsedArgs.decay ?? 0.4;
-      const phaserSpeed = parsedArgs.speed ?? 0.5;
-      command = command.audioFilters(`aphaser=in_gain=${phaserInGain}:out_gain=${phaserOutGain}:delay=${phaserDelay}:decay=${phaserDecay}:speed=${phaserSpeed}`).videoCodec('copy');
-      break;
-    }
-
-    case 'audio_vibrato': {
-      const vibratoFreq = parsedArgs.frequency ?? 5;
-      const vibratoDepth = parsedArgs.depth ?? 0.5;
-      command = command.audioFilters(`vibrato=f=${vibratoFreq}:d=${vibratoDepth}`).videoCodec('copy');
-      break;
-    }
-
-    case 'audio_tremolo': {
-      const tremoloFreq = parsedArgs.frequency ?? 5;
-      const tremoloDepth = parsedArgs.depth ?? 0.5;
-      command = command.audioFilters(`tremolo=f=${tremoloFreq}:d=${tremoloDepth}`).videoCodec('copy');
-      break;
-    }
-
-    case 'audio_compressor': {
-      const compThreshold = parsedArgs.threshold ?? 0;
-      const compRatio = parsedArgs.ratio ?? 4;
-      const compAttack = parsedArgs.attack ?? 20;
-      const compRelease = parsedArgs.release ?? 250;
-      command = command.audioFilters(`acompressor=threshold=${compThreshold}dB:ratio=${compRatio}:attack=${compAttack}:release=${compRelease}`).videoCodec('copy');
-      break;
-    }
-
-    case 'audio_gate': {
-      const gateThreshold = parsedArgs.threshold ?? -50;
-      const gateRatio = parsedArgs.ratio ?? 2;
-      const gateAttack = parsedArgs.attack ?? 20;
-      const gateRelease = parsedArgs.release ?? 250;
-      command = command.audioFilters(`agate=threshold=${gateThreshold}dB:ratio=${gateRatio}:attack=${gateAttack}:release=${gateRelease}`).videoCodec('copy');
-      break;
-    }
+  // Identical edits of identical input are served from the render cache
+  const cacheKey = renderCacheKey(working.asset.id, operation, parsedArgs);
+  try {
+    if (await serveCachedRender(res, cacheKey)) return;
+  } catch (error) {
+    console.error('Render cache lookup failed:', error);
+  }
 
-    case 'audio_stereo_widen': {
-      const stereoDelay = parsedArgs.delay ?? 20;
-      const stereoFeedback = parsedArgs.feedback ?? 0.3;
-      const stereoCrossfeed = parsedArgs.crossfeed ?? 0.3;
-      command = command.audioFilters(`stereowiden=delay=${stereoDelay}:feedback=${stereoFeedback}:crossfeed=${stereoCrossfeed}`).videoCodec('copy');
-      break;
-    }
+  const renderArgs = lineage ? scaleOperationArgs(operation, parsedArgs, 1 / lineage.scale) : parsedArgs;
+  let inputInfo;
+  try {
+    inputInfo = await processInputInfo(working.asset, operation, renderArgs);
+  } catch (error) {
+    return sendRenderError(res, error, operation);
+  }
+  const built = buildProcessCommand(working.asset, operation, renderArgs, encodeProfile, inputInfo);
+  if (built.error) return res.status(400).json({ error: built.error });
 
-    case 'audio_reverse':
-      command = command.audioFilters('areverse').videoCodec('copy');
-      break;
+  if (built.render) {
+    await sendRenderedFile(res, built, { label: operation, cacheKey, meta });
+    return;
+  }
 
-    case 'audio_limiter': {
-      const limiterLevel = parsedArgs.level ?? 1.0;
-      const limiterAttack = parsedArgs.attack ?? 5;
-      const limiterRelease = parsedArgs.release ?? 50;
-      command = command.audioFilters(`alimiter=level_in=1:level_out=1:limit=${limiterLevel}:attack=${limiterAttack}:release=${limiterRelease}`).videoCodec('copy');
-      break;
-    }
+  // Pipe ffmpeg stdout directly to the response, retaining the output for chained edits
+  await streamAndRetainOutput(built.command, res, {
+    mimeType: built.mimeType,
+    ext: built.outputExt,
+    label: operation,
+    cacheKey,
+    meta
+  });
+});
 
-    case 'audio_silence_remove': {
-      const startThreshold = parsedArgs.start_threshold ?? -50;
-      const startDuration = parsedArgs.start_duration ?? 0.5;
-      const stopThreshold = parsedArgs.stop_threshold ?? -50;
-      const stopDuration = parsedArgs.stop_duration ?? 0.5;
-      command = command.audioFilters(`silenceremove=start_periods=1:start_threshold=${startThreshold}dB:start_duration=${startDuration}:stop_periods=-1:stop_threshold=${stopThreshold}dB:stop_duration=${stopDuration}`).videoCodec('copy');
-      break;
-    }
+// Multi-pass renders (see buildProcessCommand) write a seekable file rather than a pipe,
+// so the output is committed to the asset store first and then sent from disk.
+async function sendRenderedFile(res, built, { label, cacheKey, meta }) {
+  try {
+    const output = await renderToAsset(built, { signal: abortSignalFor(res), cacheKey, meta });
+    const asset = await assetStore.acquire(output.id);
+    if (!asset || res.destroyed) return assetStore.release(asset);
+    res.on('close', () => assetStore.release(asset));
+    res.set('x-output-asset-id', asset.id);
+    res.sendFile(asset.path, { headers: { 'Content-Type': built.mimeType } });
+  } catch (error) {
+    sendRenderError(res, error, label);
+  }
+}
 
-    case 'audio_pan': {
-      const panValue = parsedArgs.pan;
-      let leftGain, rightGain;
-      if (panValue < 0) {
-        leftGain = 1.0;
-        rightGain = 1.0 + panValue;
-      } else if (panValue > 0) {
-        leftGain = 1.0 - panValue;
-        rightGain = 1.0;
-      } else {
-        leftGain = 1.0;
-        rightGain = 1.0;
-      }
-      command = command.audioFilters(`pan=stereo|c0=${leftGain}*c0|c1=${rightGain}*c1`).videoCodec('copy');
-      break;
+// Render an operation into the asset store in the background, reporting FFmpeg progress
+// on the job. Runs on the proxy like /api/process-video does. The input asset must stay
+// acquired until this settles. submitChecked: the submit already counted a cache lookup.
+async function runRenderJob(job, req, { inputAsset, parsedArgs, encodeProfile, submitChecked }) {
+  const { operation } = job;
+  let working = null;
+  try {
+    working = await interactiveInput(req, inputAsset, operation, { encodeProfile });
+    const { lineage } = working;
+    const cacheKey = renderCacheKey(working.asset.id, operation, parsedArgs);
+    const cached = await renderCache.lookup(cacheKey, { internal: submitChecked });
+    if (cached) return renderJobs.complete(job, describeAsset(cached));
+
+    const renderArgs = lineage ? scaleOperationArgs(operation, parsedArgs, 1 / lineage.scale) : parsedArgs;
+    const built = buildProcessCommand(working.asset, operation, renderArgs, encodeProfile, await processInputInfo(working.asset, operation, renderArgs));
+    if (built.error) throw new Error(built.error);
+
+    // Multi-pass renders report status only, not per-frame progress
+    if (built.command) {
+      const expectedDuration = expectedOutputDuration(await probeDuration(working.asset), operation, parsedArgs);
+      built.command
+        .outputOptions(['-progress', 'pipe:2', '-nostats'])
+        .on('stderr', createProgressParser((progress) => {
+          renderJobs.progress(job, withEstimates(progress, expectedDuration));
+        }));
     }
+    const asset = await renderToAsset(built, {
+      cacheKey,
+      meta: lineage ? { lineage: extendLineage(lineage, operation, parsedArgs) } : undefined,
+      onStart: () => renderJobs.start(job)
+    });
+    renderJobs.complete(job, { ...describeAsset(asset), serverTiming: requestTimings.getStore()?.header() });
+  } catch (error) {
+    console.error(`Render job ${job.id} (${operation}) failed:`, error);
+    renderJobs.fail(job, error);
+  } finally {
+    assetStore.release(working?.acquired);
+  }
+}
 
-    case 'adjust_brightness':
-      command = command.videoFilters(`eq=brightness=${parsedArgs.brightness}`).audioCodec('copy');
-      break;
+// Asynchronous render endpoint. Same request contract as the streaming /api/process-video path,
+// but answers 202 with a job id right away; progress and the resulting asset are reported on
+// GET /api/jobs/:id/events and the output is downloaded from /api/assets/:id.
+app.post('/api/jobs', recordServerTiming, requireAuthenticatedUser, requireActiveSubscription, rejectWhenSaturated, limitEncodeCost(), async (req, res) => {
+  const contentType = (req.headers['content-type'] || '').toLowerCase();
+  const fileContentType = contentType.split(';')[0].trim() || 'video/mp4';
+  const operation = req.headers['x-operation'];
+  const argsStr = req.headers['x-args'];
 
-    case 'adjust_hue':
-      command = command.videoFilters(`hue=h=${parsedArgs.degrees}`).audioCodec('copy');
-      break;
+  if (!operation) {
+    return res.status(400).json({ error: 'No operation specified in x-operation header' });
+  }
+  if (operation === 'get_video_info') {
+    return res.status(400).json({ error: 'get_video_info is not a render operation' });
+  }
 
-    case 'adjust_saturation':
-      command = command.videoFilters(`eq=saturation=${parsedArgs.saturation}`).audioCodec('copy');
-      break;
+  let parsedArgs;
+  try {
+    parsedArgs = argsStr ? JSON.parse(argsStr) : {};
+  } catch (e) {
+    return res.status(400).json({ error: 'Invalid x-args header: must be valid JSON' });
+  }
+  const encodeProfile = requestEncodeProfile(req, res, parsedArgs);
+  if (!encodeProfile) return;
+  // The profile is part of the args so renders in different profiles are cached separately
+  parsedArgs = { ...parsedArgs, encodeProfile: encodeProfile.name };
 
-    case 'convert_video_format': {
-      const supportedVideoFormats = ['mp4', 'webm', 'mov', 'avi', 'mkv', 'flv', 'ogv'];
-      const targetFormat = parsedArgs.format;
-      if (!targetFormat || !supportedVideoFormats.includes(targetFormat)) {
-      if (!targetFormat || !supportedVideoFormats.includes(targetFormat)) {
-        if (!res.headersSent) return res.status(400).end();
-        return;
-      }
-      }
-      const supportedVideoCodecs = ['libx264', 'libx265', 'libvpx-vp9', 'auto'];
-      if (parsedArgs.codec && !supportedVideoCodecs.includes(parsedArgs.codec)) {
-      if (parsedArgs.codec && !supportedVideoCodecs.includes(parsedArgs.codec)) {
-        if (!res.headersSent) return res.status(400).end();
-        return;
-      }
-      }
-      const codec = parsedArgs.codec && parsedArgs.codec !== 'auto' ? parsedArgs.codec : null;
-      if (codec) {
-        command = command.videoCodec(codec).audioCodec('copy');
-      } else {
-        command = command.outputOptions('-c copy');
-      }
-      command = command.toFormat(targetFormat);
-      break;
+  try {
+    const inputAsset = await acquireInputAsset(req, res, {
+      assetId: req.headers['x-asset-id'],
+      mimeType: fileContentType
+    });
+    if (!inputAsset) return;
+
+    const built = buildProcessCommand(inputAsset, operation, parsedArgs, encodeProfile);
+    if (built.error) return res.status(400).json({ error: built.error });
+
+    // Keyed like the job's own lookup, on the proxy for inputs that are edited on one
+    const workingId = await knownInteractiveInputId(req, inputAsset, operation);
+    const cached = workingId && await renderCache.lookup(renderCacheKey(workingId, operation, parsedArgs));
+    if (cached) {
+      const job = renderJobs.create({ owner: requestOwner(req), operation });
+      renderJobs.complete(job, describeAsset(cached));
+      res.set('x-cache', 'HIT');
+      return res.status(202).json({ jobId: job.id });
     }
 
-    case 'convert_audio_format': {
-      const supportedAudioFormats = ['mp3', 'wav', 'aac', 'ogg', 'flac', 'm4a', 'wma'];
-      if (!parsedArgs.format || !supportedAudioFormats.includes(parsedArgs.format)) {
-      if (!parsedArgs.format || !supportedAudioFormats.includes(parsedArgs.format)) {
-        if (!res.headersSent) return res.status(400).end();
-        return;
-      }
-      }
-      const audioBitrate = parsedArgs.bitrate || '192k';
-      command = command.noVideo().toFormat(parsedArgs.format).audioBitrate(audioBitrate);
-      break;
+    // Checked before the job exists, so a rejected submission leaves no job behind pending forever
+    if (ffmpegScheduler.isSaturated()) {
+      return sendBusy(res, new SchedulerBusyError(ffmpegScheduler.retryAfterSeconds()));
     }
 
-    case 'extract_audio': {
-      const supportedExtractFormats = ['mp3', 'wav', 'aac', 'ogg', 'flac', 'm4a'];
-      const format = parsedArgs.format || 'mp3';
-      if (!supportedExtractFormats.includes(format)) {
-      if (!supportedExtractFormats.includes(format)) {
-        if (!res.headersSent) return res.status(400).end();
-        return;
-      }
-      }
-      const extractBitrate = parsedArgs.bitrate || '192k';
-      command = command.noVideo().toFormat(format).audioBitrate(extractBitrate);
-      break;
-    }
+    // The job outlives this request, so it holds its own reference to the input, and its
+    // estimate stays charged until it is done rather than being settled with the 202
+    const jobInput = await assetStore.acquire(inputAsset.id);
+    const releaseCost = costMeters.getStore()?.hold() || (() => {});
+    const job = renderJobs.create({ owner: requestOwner(req), operation });
+    res.set('x-cache', 'MISS');
+    res.status(202).json({ jobId: job.id });
+    runRenderJob(job, req, { inputAsset: jobInput, parsedArgs, encodeProfile, submitChecked: Boolean(workingId) })
+      .finally(() => {
+        assetStore.release(jobInput);
+        releaseCost();
+      });
+  } catch (error) {
+    console.error('Error submitting render job:', error);
+    if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to submit render job' });
+  }
+});
 
-    case 'fade_transition': {
-      const fadeDuration = parsedArgs.duration || 1;
-      command = command.videoFilters(`fade=t=in:st=0:d=${fadeDuration},fade=t=out:st=${parsedArgs.totalDuration - fadeDuration}:d=${fadeDuration}`).audioCodec('copy');
-      break;
-    }
+// Render job status snapshot
+app.get('/api/jobs/:id', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, (req, res) => {
+  const job = renderJobs.get(req.params.id, requestOwner(req));
+  if (!job) return res.status(404).json({ error: 'Unknown or expired job id', code: 'job_not_found' });
+  res.json(renderJobs.describe(job));
+});
 
-    case 'crossfade_transition':
-      return res.status(400).json({ error: 'crossfade_transition requires special multi-video handling' });
+// Render job progress as Server-Sent Events: status, progress, then done or failed
+app.get('/api/jobs/:id/events', apiLimiter, requireAuthenticatedUser, requireActiveSubscription, (req, res) => {
+  const job = renderJobs.get(req.params.id, requestOwner(req));
+  if (!job) return res.status(404).json({ error: 'Unknown or expired job id', code: 'job_not_found' });
+
+  res.setHeader('Content-Type', 'text/event-stream');
+  res.setHeader('Cache-Control', 'no-cache');
+  res.setHeader('Connection', 'keep-alive');
+  res.setHeader('X-Accel-Buffering', 'no'); // let nginx forward events as they are written
+  res.flushHeaders();
+
+  // Comment lines keep idle proxies from closing the stream during long renders
+  const heartbeat = setInterval(() => res.write(': keep-alive\n\n'), 15_000);
+  const unsubscribe = renderJobs.subscribe(job, (event, data) => {
+    res.write(`event: ${event}\ndata: ${JSON.stringify(data)}\n\n`);
+    if (event === 'done' || event === 'failed') res.end();
+  });
+  res.on('close', () => {
+    clearInterval(heartbeat);
+    unsubscribe();
+  });
+});
 
-    default:
-      return res.status(400).json({ error: `Unknown operation: ${operation}` });
+// Export endpoint: replays a proxy preview's edit chain on the full-resolution source,
+// in the final encode profile unless x-encode-profile says otherwise. Assets that are
+// already full resolution are returned unchanged.
+app.post('/api/export', requireAuthenticatedUser, requireActiveSubscription, rejectWhenSaturated, limitEncodeCost(() => 'export'), async (req, res) => {
+  const encodeProfile = selectEncodeProfile({ header: req.headers['x-encode-profile'] ?? 'final' });
+  if (!encodeProfile) {
+    return res.status(400).json({ error: `x-encode-profile must be one of: ${Object.keys(ENCODE_PROFILES).join(', ')}` });
   }
 
-  // Set response headers and pipe ffmpeg stdout directly to the response
-  res.set('Content-Type', responseContentType);
-  if (outputExt === 'mp4') {
-    command.outputOptions(['-movflags', 'frag_keyframe+empty_moov+default_base_moof']);
+  try {
+    const inputAsset = await acquireInputAsset(req, res, {
+      assetId: req.headers['x-asset-id'],
+      mimeType: (req.headers['content-type'] || '').split(';')[0].trim().toLowerCase() || 'video/mp4'
+    });
+    const output = await acquireFullResolutionInput(res, inputAsset, encodeProfile);
+    if (!output || res.destroyed) return;
+    res.set('x-output-asset-id', output.id);
+    res.sendFile(output.path, { headers: { 'Content-Type': output.mimeType } });
+  } catch (error) {
+    console.error('Error exporting video:', error);
+    if (!res.headersSent) res.status(500).json({ error: error.message || 'Failed to export video' });
   }
-  command
-    .toFormat(outputExt)
-    .on('error', (err) => {
-      console.error('Error processing video:', err);
-      if (!res.headersSent) res.status(500).end();
-    })
-    .pipe(res);
 });
 
 // Multi-video transition endpoint
-app.post('/api/transition-videos', videoProcessLimiter, requireAuthenticatedUser, requireActiveSubscription, upload.array('videos', 10), async (req, res) => {
-  const tempFiles = [];
-  let outputPath = null;
+app.post('/api/transition-videos', recordServerTiming, requireAuthenticatedUser, requireActiveSubscription, rejectWhenSaturated, limitEncodeCost(() => 'transition'), parseUpload(upload.array('videos', 10)), async (req, res) => {
+  const inputAssets = [];
+  let streaming = false;
 
   try {
     const { transition, duration } = req.body;
+    const files = req.files || [];
 
-    if (!req.files || req.files.length < 2) {
+    // Each clip is either an uploaded file ('file') or a stored asset ('asset:<id>'), in order.
+    // Without clipSources every clip is an uploaded file.
+    let clipSources;
+    try {
+      clipSources = req.body.clipSources ? JSON.parse(req.body.clipSources) : files.map(() => 'file');
+    } catch (e) {
+      return res.status(400).json({ error: 'clipSources must be valid JSON' });
+    }
+    if (!Array.isArray(clipSources) || clipSources.length < 2) {
       return res.status(400).json({ error: 'At least two video files are required for transitions' });
     }
 
     if (!transition) {
       return res.status(400).json({ error: 'No transition type specified' });
     }
+    if (!isTransitionType(transition)) {
+      return res.status(400).json({ error: `Unknown transition type: ${transition}` });
+    }
+    const encodeProfile = requestEncodeProfile(req, res, req.body);
+    if (!encodeProfile) return;
 
     // Parse duration if it's a string
     const transitionDuration = duration ? parseFloat(duration) : 1;
-
-    // Create temporary files
-    const tmpDir = '/tmp';
-    
-    // Write uploaded files to disk
-    const inputPaths = [];
-    for (let i = 0; i < req.files.length; i++) {
-      const inputPath = path.join(tmpDir, `input-${randomUUID()}-${i}.mp4`);
-      await fs.writeFile(inputPath, req.files[i].buffer);
-      inputPaths.push(inputPath);
-      tempFiles.push(inputPath);
+    if (!(transitionDuration > 0)) {
+      return res.status(400).json({ error: 'Transition duration must be a positive number of seconds' });
     }
-
-    outputPath = path.join(tmpDir, `output-${randomUUID()}.mp4`);
-
-    // Check which videos have audio streams
-    const hasAudio = await Promise.all(
-      inputPaths.map(inputPath => checkHasAudioStream(inputPath))
-    );
-
-    // Process videos with transition
-    await new Promise((resolve, reject) => {
-      let command = ffmpeg();
-      
-      // Add all inputs
-      inputPaths.forEach(inputPath => {
-        command = command.input(inputPath);
-      });
-
-      let filterComplex = '';
-      let outputLabels = [];
-
-      switch (transition) {
-        case 'crossfade':
-          // Build crossfade filter chain for all videos
-          // For 2 videos: [0:v][1:v]xfade=transition=fade:duration=1:offset=<video0_duration-1>[v]
-          // For 3+ videos: chain multiple xfades
-          filterComplex = buildCrossfadeFilter(inputPaths.length, transitionDuration, hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'wipe_left':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'wipeleft', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'wipe_right':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'wiperight', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'wipe_up':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'wipeup', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'wipe_down':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'wipedown', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'slide_left':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'slideleft', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'slide_right':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'slideright', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'slide_up':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'slideup', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'slide_down':
-          filterComplex = buildWipeFilter(inputPaths.length, transitionDuration, 'slidedown', hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'dissolve':
-          // Dissolve is similar to crossfade with fade transition
-          filterComplex = buildCrossfadeFilter(inputPaths.length, transitionDuration, hasAudio, 'dissolve');
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        case 'fade':
-          // Fade to black between clips
-          filterComplex = buildFadeFilter(inputPaths.length, transitionDuration, hasAudio);
-          outputLabels = hasAudio.some(h => h) ? ['v', 'a'] : ['v'];
-          command = command.complexFilter(filterComplex, outputLabels);
-          break;
-
-        default:
-          reject(new Error(`Unknown transition type: ${transition}`));
-          return;
+    const signal = abortSignalFor(res);
+
+    let nextFile = 0;
+    for (const source of clipSources) {
+      let asset = null;
+      if (source === 'file' && nextFile < files.length) {
+        asset = await assetStore.acquire(files[nextFile++].asset.id);
+      } else if (typeof source === 'string' && source.startsWith('asset:')) {
+        asset = await assetStore.acquire(source.slice('asset:'.length));
+        if (!asset) {
+          return res.status(404).json({ error: 'Unknown or expired asset id', code: 'asset_not_found' });
+        }
       }
-
-      command
-        .output(outputPath)
-        .outputOptions('-map', '[v]');
-      
-      // Only map audio if at least one video has audio
-      if (hasAudio.some(h => h)) {
-        command.outputOptions('-map', '[a]').audioCodec('aac');
+      if (!asset) {
+        return res.status(400).json({ error: 'Each clip must be an uploaded file or a known asset id' });
       }
-      
-      command
-        .videoCodec('libx264')
-        .on('end', () => resolve())
-        .on('error', (err) => reject(err))
-        .run();
-    });
-
-    // Read the processed video
-    const processedVideo = await fs.readFile(outputPath);
-
-    // Clean up temporary files
-    for (const tempFile of tempFiles) {
-      await fs.unlink(tempFile);
+      if (asset.meta?.lineage) {
+        // Transitions cannot be replayed from proxies, so proxy previews join at full resolution
+        const preview = asset;
+        try {
+          asset = await acquireFullResolution(preview, { signal, encodeProfile });
+        } finally {
+          assetStore.release(preview);
+        }
+      }
+      inputAssets.push(asset);
     }
-    await fs.unlink(outputPath);
 
-    // Send the processed video
-    res.set('Content-Type', 'video/mp4');
-    res.send(processedVideo);
+    // Probe every clip, normalize mismatched ones and re-encode only the transition windows
+    const clips = await Promise.all(inputAssets.map(async (asset) => ({
+      path: asset.path,
+      metadata: await probeInput(asset)
+    })));
+    const prepared = await prepareTransition({
+      clips,
+      transition,
+      transitionDuration,
+      runFfmpeg: (command) => runFfmpeg(command, { signal }),
+      videoEncodeOptions: x264OutputOptions(encodeProfile),
+      scratch: scratchArena
+    });
+    prepared.command
+      .outputOptions(['-movflags', 'frag_keyframe+empty_moov+default_base_moof'])
+      .toFormat('mp4');
+
+    // Stream fragmented MP4 to the client as it is muxed; the inputs stay acquired until
+    // FFmpeg is done with them
+    streaming = true;
+    await streamAndRetainOutput(prepared.command, res, {
+      mimeType: 'video/mp4',
+      ext: 'mp4',
+      label: 'transition',
+      onFinish: () => {
+        inputAssets.forEach(asset => assetStore.release(asset));
+        prepared.cleanup();
+      }
+    });
 
   } catch (error) {
+    if (res.headersSent || res.destroyed) return;
+    if (error instanceof SchedulerBusyError) return sendBusy(res, error);
+    if (error.code === 'source_expired') return res.status(410).json({ error: error.message, code: error.code });
+    if (error.code === 'clip_too_short') return res.status(400).json({ error: error.message, code: error.code });
     console.error('Error processing video transition:', error);
-
-    // Clean up on error
-    for (const tempFile of tempFiles) {
-      try { await fs.unlink(tempFile); } catch (e) { /* ignore */ }
-    }
-    if (outputPath) {
-      try { await fs.unlink(outputPath); } catch (e) { /* ignore */ }
-    }
-
     res.status(500).json({ error: error.message || 'Failed to process video transition' });
+  } finally {
+    if (!streaming) inputAssets.forEach(asset => assetStore.release(asset));
   }
 });
 
-// Helper function to check if a video has audio stream
-async function checkHasAudioStream(inputPath) {
-  return new Promise((resolve) => {
-    ffmpeg.ffprobe(inputPath, (err, metadata) => {
-      if (err) {
-        // If ffprobe fails, assume no audio
-        resolve(false);
-        return;
-      }
-      
-      // Check if there's any audio stream
-      const hasAudio = metadata.streams && metadata.streams.some(stream => stream.codec_type === 'audio');
-      resolve(hasAudio);
-    });
-  });
+// Helper function to check if a stored video has an audio stream
+async function checkHasAudioStream(asset) {
+  try {
+    return hasAudioStream(await probeInput(asset));
+  } catch {
+    // If ffprobe fails, assume no audio
+    return false;
+  }
 }
 
-// Helper function to build crossfade filter
-function buildCrossfadeFilter(numVideos, duration, hasAudio, transition = 'fade') {
-  if (numVideos < 2) {
-    throw new Error('At least 2 videos required for crossfade');
-  }
-
-  let filters = [];
-  let audioFilters = [];
-  
-  // Simple concatenation approach
-  // For proper crossfade with xfade filter, we would need video durations
-  // This implementation uses basic concat which is simpler and more reliable
-  
-  // Check if any video has audio
-  const anyHasAudio = hasAudio.some(h => h);
-  
-  if (anyHasAudio) {
-    // If some videos have audio and some don't, add silent audio to those without
-    const allHasAudio = hasAudio.every(h => h);
-    
-    if (!allHasAudio) {
-      // Generate silent audio for videos without audio
-      for (let i = 0; i < numVideos; i++) {
-        if (!hasAudio[i]) {
-          // Add silent audio track
-          filters.push(`anullsrc=channel_layout=stereo:sample_rate=44100[silent${i}]`);
-        }
-      }
-    }
-    
-    // Build video concat
-    let videoInputs = Array.from({length: numVideos}, (_, i) => `[${i}:v]`).join('');
-    filters.push(`${videoInputs}concat=n=${numVideos}:v=1:a=0[v]`);
-    
-    // Build audio concat with proper audio sources
-    let audioInputs = Array.from({length: numVideos}, (_, i) => {
-      return hasAudio[i] ? `[${i}:a]` : `[silent${i}]`;
-    }).join('');
-    audioFilters.push(`${audioInputs}concat=n=${numVideos}:v=0:a=1[a]`);
-  } else {
-    // No videos have audio - only concat video streams
-    let videoInputs = Array.from({length: numVideos}, (_, i) => `[${i}:v]`).join('');
-    filters.push(`${videoInputs}concat=n=${numVideos}:v=1:a=0[v]`);
-  }
-  
-  return [...filters, ...audioFilters].join(';');
+// Helper function to read a stored file's first video stream (null if none or unreadable)
+async function probeVideoStream(asset) {
+  return probeInput(asset).then(videoStreamOf, () => null);
 }
 
-// Helper function to build wipe/slide filter
-function buildWipeFilter(numVideos, duration, transition, hasAudio) {
-  if (numVideos < 2) {
-    throw new Error('At least 2 videos required for wipe transition');
-  }
-
-  // Simple concatenation - for actual wipe effects, we would need xfade filter with offsets
-  let filters = [];
-  let audioFilters = [];
-  
-  // Check if any video has audio
-  const anyHasAudio = hasAudio.some(h => h);
-  
-  if (anyHasAudio) {
-    // If some videos have audio and some don't, add silent audio to those without
-    const allHasAudio = hasAudio.every(h => h);
-    
-    if (!allHasAudio) {
-      // Generate silent audio for videos without audio
-      for (let i = 0; i < numVideos; i++) {
-        if (!hasAudio[i]) {
-          // Add silent audio track
-          filters.push(`anullsrc=channel_layout=stereo:sample_rate=44100[silent${i}]`);
-        }
-      }
-    }
-    
-    // Build video concat
-    let videoInputs = Array.from({length: numVideos}, (_, i) => `[${i}:v]`).join('');
-    filters.push(`${videoInputs}concat=n=${numVideos}:v=1:a=0[v]`);
-    
-    // Build audio concat with proper audio sources
-    let audioInputs = Array.from({length: numVideos}, (_, i) => {
-      return hasAudio[i] ? `[${i}:a]` : `[silent${i}]`;
-    }).join('');
-    audioFilters.push(`${audioInputs}concat=n=${numVideos}:v=0:a=1[a]`);
-  } else {
-    // No videos have audio - only concat video streams
-    let videoInputs = Array.from({length: numVideos}, (_, i) => `[${i}:v]`).join('');
-    filters.push(`${videoInputs}concat=n=${numVideos}:v=1:a=0[v]`);
-  }
-  
-  return [...filters, ...audioFilters].join(';');
+// Helper function to read a stored media file's duration in seconds (null if unknown)
+async function probeDuration(asset) {
+  return probeInput(asset).then(durationOf, () => null);
 }
 
-// Helper function to build fade to black filter
-function buildFadeFilter(numVideos, duration, hasAudio) {
-  if (numVideos < 2) {
-    throw new Error('At least 2 videos required for fade transition');
-  }
-
-  let filters = [];
-  let audioFilters = [];
-  
-  // Apply fade in to first video and fade out to last video
-  // For middle videos, we'll just concatenate normally
-  // Note: For proper timing, we would need to get video durations via ffprobe first
-  let videoLabels = [];
-  let audioLabels = [];
-  
-  // Check if any video has audio
-  const anyHasAudio = hasAudio.some(h => h);
-  
-  // If some videos have audio and some don't, add silent audio to those without
-  if (anyHasAudio && !hasAudio.every(h => h)) {
-    for (let i = 0; i < numVideos; i++) {
-      if (!hasAudio[i]) {
-        filters.push(`anullsrc=channel_layout=stereo:sample_rate=44100[silent${i}]`);
-      }
-    }
-  }
-  
-  for (let i = 0; i < numVideos; i++) {
-    const vLabel = `v${i}fade`;
-    const aLabel = `a${i}fade`;
-    
-    if (i === 0 && numVideos === 2) {
-      // First video in a 2-video sequence: only fade out
-      // We'll skip the fade for simplicity since we don't know duration
-      filters.push(`[${i}:v]copy[${vLabel}]`);
-      if (anyHasAudio) {
-        const audioSource = hasAudio[i] ? `[${i}:a]` : `[silent${i}]`;
-        audioFilters.push(`${audioSource}acopy[${aLabel}]`);
-      }
-    } else if (i === 0) {
-      // First video: no fade needed at start, just copy
-      filters.push(`[${i}:v]copy[${vLabel}]`);
-      if (anyHasAudio) {
-        const audioSource = hasAudio[i] ? `[${i}:a]` : `[silent${i}]`;
-        audioFilters.push(`${audioSource}acopy[${aLabel}]`);
-      }
-    } else if (i === numVideos - 1) {
-      // Last video: fade in at start
-      filters.push(`[${i}:v]fade=t=in:st=0:d=${duration}[${vLabel}]`);
-      if (anyHasAudio) {
-        const audioSource = hasAudio[i] ? `[${i}:a]` : `[silent${i}]`;
-        audioFilters.push(`${audioSource}afade=t=in:st=0:d=${duration}[${aLabel}]`);
-      }
-    } else {
-      // Middle videos: fade in at start
-      filters.push(`[${i}:v]fade=t=in:st=0:d=${duration}[${vLabel}]`);
-      if (anyHasAudio) {
-        const audioSource = hasAudio[i] ? `[${i}:a]` : `[silent${i}]`;
-        audioFilters.push(`${audioSource}afade=t=in:st=0:d=${duration}[${aLabel}]`);
-      }
-    }
-    
-    videoLabels.push(`[${vLabel}]`);
-    if (anyHasAudio) {
-      audioLabels.push(`[${aLabel}]`);
-    }
-  }
-  
-  filters.push(`${videoLabels.join('')}concat=n=${numVideos}:v=1:a=0[v]`);
-  if (anyHasAudio) {
-    audioFilters.push(`${audioLabels.join('')}concat=n=${numVideos}:v=0:a=1[a]`);
-  }
-  
-  return [...filters, ...audioFilters].join(';');
+// Input measurements buildProcessCommand uses for an operation: the duration, and loudness
+// stats when the edit normalizes the input's own audio (null if they cannot be measured, which
+// falls back to single-pass normalization)
+async function processInputInfo(asset, operation, args = {}) {
+  const operations = operation === 'apply_operations' ? (args.operations || []) : [{ operation }];
+  const normalizes = Array.isArray(operations) && normalizesInputLoudness(operations);
+  const [duration, loudness] = await Promise.all([
+    probeDuration(asset),
+    normalizes
+      ? loudnessCache.get(asset).catch((error) => {
+        if (error instanceof SchedulerBusyError) throw error;
+        console.warn('Loudness measurement failed:', error.message);
+        return null;
+      })
+      : null
+  ]);
+  return { duration, loudness };
 }
 
 // Stripe checkout session creation endpoint
@@ -1,6 +1,7 @@
 import React, { useState, useRef, useEffect } from 'react';
 import { tools, systemPrompt } from './tools.js';
-import { toolFunctions, setSampleModeAccessToken, setSampleModeEnabled, setCurrentFileMimeType } from './toolFunctions.js';
+import { toolFunctions, setSampleModeAccessToken, setSampleModeEnabled, setCurrentFileMimeType, setRenderProgressListener, setServerTimingListener, isFusableToolCall, runFusedToolCalls, isProxyRender, registerServerAsset } from './toolFunctions.js';
+import { formatServerTiming } from './serverTiming.js';
 import VideoPreview from './VideoPreview.jsx';
 
 // Sample button style constant
@@ -39,6 +40,7 @@ export default function App() {
   const [showLanding, setShowLanding] = useState(true); // Show landing page initially
   const [loaded, setLoaded] = useState(true); // Server-side processing doesn't require loading
   const [processing, setProcessing] = useState(false); // Track ffmpeg processing state
+  const [renderProgress, setRenderProgress] = useState(null); // Progress of the current server render job
   const [authError, setAuthError] = useState(null); // Track authentication errors
   const [isCallingAPI, setIsCallingAPI] = useState(false); // Track API call state
   const videoRef = useRef(null);
@@ -53,6 +55,7 @@ export default function App() {
   const [isSampleMode, setIsSampleMode] = useState(false);
   const [sampleAccessToken, setSampleAccessTokenState] = useState(null);
   const messageIdCounterRef = useRef(1); // Counter for unique message IDs
+  const pendingServerTimingRef = useRef(null); // Timing of the last media response, shown on the next reply
   const chatWindowRef = useRef(null);
 
   useEffect(() => {
@@ -65,6 +68,22 @@ export default function App() {
     setSampleModeEnabled(isSampleMode);
   }, [isSampleMode]);
 
+  // Renders run as server jobs so progress and ETA can be shown while ffmpeg works
+  useEffect(() => {
+    setRenderProgressListener(setRenderProgress);
+    return () => setRenderProgressListener(null);
+  }, []);
+
+  // Server-Timing of media responses is logged and shown under the message reporting the result
+  useEffect(() => {
+    setServerTimingListener(({ operation, metrics }) => {
+      const summary = formatServerTiming(metrics);
+      console.info(`Server timing (${operation}): ${summary}`);
+      pendingServerTimingRef.current = summary;
+    });
+    return () => setServerTimingListener(null);
+  }, []);
+
   useEffect(() => {
     setSampleModeAccessToken(sampleAccessToken);
   }, [sampleAccessToken]);
@@ -185,13 +204,26 @@ export default function App() {
     verifyPayment();
   }, []);
 
-  const addMessage = (text, isUser = false, videoUrl = null, videoType = 'processed', mimeType = null, showSampleLinks = false) => {
+  // proxyData: the video data of a low-resolution preview, kept so it can be exported later
+  const addMessage = (text, isUser = false, videoUrl = null, videoType = 'processed', mimeType = null, showSampleLinks = false, proxyData = null, textTracks = null) => {
     const id = messageIdCounterRef.current++;
-    setMessages(prev => [...prev, { role: isUser ? 'user' : 'assistant', content: text, videoUrl, videoType, mimeType, id, showSampleLinks }]);
+    const serverTiming = isUser ? null : pendingServerTimingRef.current;
+    if (!isUser) pendingServerTimingRef.current = null;
+    setMessages(prev => [...prev, { role: isUser ? 'user' : 'assistant', content: text, videoUrl, videoType, mimeType, id, showSampleLinks, proxyData, textTracks, serverTiming }]);
   };
 
   const getVideoTitle = (videoType) => {
-    return videoType === 'original' ? 'Original Video' : 'Processed Video';
+    if (videoType === 'original') return 'Original Video';
+    return videoType === 'exported' ? 'Exported Video' : 'Processed Video';
+  };
+
+  const handleExport = async (proxyData) => {
+    setProcessing(true);
+    try {
+      await toolFunctions.export_video({}, proxyData, () => {}, addMessage);
+    } finally {
+      setProcessing(false);
+    }
   };
 
   const callAPI = async (currentMessages, options = {}) => {
@@ -338,25 +370,60 @@ export default function App() {
         setProcessing(true);
         
         try {
-          for (const call of toolCallsArray) {
-            const funcName = call.function.name;
-            const args = JSON.parse(call.function.arguments);
-            
-            // Pass uploadedVideos only to functions that need it
-            let result;
-            if (funcName === 'add_video_transition') {
-              result = await toolFunctions[funcName](args, videoFileData, setVideoFileData, addMessage, uploadedVideos);
-            } else {
-              result = await toolFunctions[funcName](args, videoFileData, setVideoFileData, addMessage);
-            }
-            
+          // Each call edits the output of the previous one
+          let currentVideoData = videoFileData;
+          const updateVideoData = (data) => {
+            currentVideoData = data;
+            setVideoFileData(data);
+          };
+          // Tools post their result video right after updating the video data, so a video
+          // message belongs to currentVideoData; proxy previews keep it for export
+          const addToolMessage = (text, isUser, videoUrl, videoType, mimeType) => {
+            const proxyData = videoUrl && videoType !== 'exported' && isProxyRender(currentVideoData) ? currentVideoData : null;
+            addMessage(text, isUser, videoUrl, videoType, mimeType, false, proxyData);
+          };
+          const pushToolResult = (call, result) => {
             currentMessages.push({
               role: 'tool',
               tool_call_id: call.id,
-              name: funcName,
+              name: call.function.name,
               content: result,
               id: messageIdCounterRef.current++
             });
+          };
+
+          const parsedCalls = toolCallsArray.map(call => ({
+            call,
+            name: call.function.name,
+            args: JSON.parse(call.function.arguments)
+          }));
+
+          // Calls before this index run one by one (a fused attempt over them failed)
+          let fuseFrom = 0;
+          for (let i = 0; i < parsedCalls.length;) {
+            // Consecutive filter edits (e.g. brightness + saturation + bass) are applied in one encode
+            let end = i;
+            while (end < parsedCalls.length && isFusableToolCall(parsedCalls[end].name, parsedCalls[end].args)) end++;
+            if (i >= fuseFrom && end - i > 1) {
+              const group = parsedCalls.slice(i, end);
+              const results = await runFusedToolCalls(group, currentVideoData, updateVideoData, addToolMessage);
+              if (results) {
+                group.forEach(({ call }, j) => pushToolResult(call, results[j]));
+                i = end;
+                continue;
+              }
+              fuseFrom = end;
+            }
+
+            const { call, name: funcName, args } = parsedCalls[i++];
+            // Pass uploadedVideos only to functions that need it
+            let result;
+            if (funcName === 'add_video_transition') {
+              result = await toolFunctions[funcName](args, currentVideoData, updateVideoData, addToolMessage, uploadedVideos);
+            } else {
+              result = await toolFunctions[funcName](args, currentVideoData, updateVideoData, addToolMessage);
+            }
+            pushToolResult(call, result);
           }
           await callAPI(currentMessages);
         } finally {
@@ -420,6 +487,7 @@ export default function App() {
           setFileType(isAudio ? 'audio' : 'video');
           setFileMimeType(file.type);
           setCurrentFileMimeType(file.type);
+          registerServerAsset(data, file.type);
         }
       }
 
@@ -677,12 +745,28 @@ export default function App() {
               animation: 'spin 1s linear infinite'
             }}></div>
             <p style={{ color: '#c9d1d9', marginTop: '20px', fontSize: '16px' }}>Processing video with ffmpeg...</p>
+            {renderProgress && typeof renderProgress.percent === 'number' && (
+              <p style={{ color: '#8b949e', marginTop: '8px', fontSize: '14px' }}>
+                {renderProgress.percent}% done
+                {typeof renderProgress.etaSeconds === 'number' ? ` · about ${renderProgress.etaSeconds}s left` : ''}
+              </p>
+            )}
+            {renderProgress?.preview && (
+              <p style={{ color: '#8b949e', marginTop: '4px', fontSize: '13px', fontStyle: 'italic', maxWidth: '80%', textAlign: 'center' }}>
+                “{renderProgress.preview}”
+              </p>
+            )}
           </div>
         )}
         <div ref={chatWindowRef} style={{ flex: 1, overflowY: 'auto', overflowX: 'hidden', padding: '16px', paddingTop: '50px', WebkitOverflowScrolling: 'touch' }}>
           {messages.slice(1).map((msg) => (
             <div key={msg.id} style={{ marginBottom: '12px', padding: '8px 12px', borderRadius: '8px', maxWidth: '80%', alignSelf: msg.role === 'user' ? 'flex-end' : 'flex-start', marginLeft: msg.role === 'user' ? 'auto' : 0, marginRight: msg.role === 'user' ? 0 : 'auto', backgroundColor: msg.role === 'user' ? '#d0d0d0' : '#21262d', color: msg.role === 'user' ? '#000000' : '#c9d1d9', wordWrap: 'break-word' }}>
               <p style={{ margin: 0 }}>{msg.content}</p>
+              {msg.serverTiming && (
+                <p style={{ margin: '4px 0 0', fontSize: '12px', color: '#8b949e' }} title="Server-Timing: where the server spent the time for this edit">
+                  {msg.serverTiming}
+                </p>
+              )}
               {msg.showSampleLinks && (
                 <div style={{ marginTop: '12px', display: 'flex', flexDirection: 'column', gap: '6px' }}>
                   {sampleCommands.map((cmd, idx) => (
@@ -705,6 +789,9 @@ export default function App() {
                     videoUrl={msg.videoUrl}
                     title={getVideoTitle(msg.videoType)}
                     mimeType={msg.mimeType}
+                    isProxy={Boolean(msg.proxyData)}
+                    onExport={msg.proxyData ? () => handleExport(msg.proxyData) : null}
+                    textTracks={msg.textTracks}
                   />
                 </div>
               )}
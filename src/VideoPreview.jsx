@@ -1,6 +1,8 @@
 import React, { useState, useRef, useEffect } from 'react';
 
-export default function VideoPreview({ videoUrl, title = 'Video Preview', defaultCollapsed = false, mimeType = null }) {
+// isProxy marks a reduced-resolution preview; onExport renders it at full quality.
+// textTracks are WebVTT subtitles [{ src, srcLang, label, default }] shown over the video.
+export default function VideoPreview({ videoUrl, title = 'Video Preview', defaultCollapsed = false, mimeType = null, isProxy = false, onExport = null, textTracks = null }) {
   const [isPlaying, setIsPlaying] = useState(false);
   const [currentTime, setCurrentTime] = useState(0);
   const [duration, setDuration] = useState(0);
@@ -140,7 +142,25 @@ export default function VideoPreview({ videoUrl, title = 'Video Preview', defaul
         alignItems: 'center',
         marginBottom: isCollapsed ? '0' : '8px'
       }}>
-        <p style={{ margin: '0', fontSize: '14px', fontWeight: 'bold', color: '#c9d1d9' }}>{title}</p>
+        <p style={{ margin: '0', fontSize: '14px', fontWeight: 'bold', color: '#c9d1d9' }}>
+          {title}
+          {isProxy && (
+            <span
+              title="Edited on a low-resolution copy for speed. Export to get the full-quality video."
+              style={{
+                marginLeft: '8px',
+                padding: '2px 6px',
+                fontSize: '11px',
+                fontWeight: 'normal',
+                color: '#d29922',
+                border: '1px solid #d29922',
+                borderRadius: '10px'
+              }}
+            >
+              Preview quality
+            </span>
+          )}
+        </p>
         <button 
           onClick={() => setIsCollapsed(!isCollapsed)}
           style={{
@@ -183,7 +203,18 @@ export default function VideoPreview({ videoUrl, title = 'Video Preview', defaul
             display: 'block',
             marginBottom: '12px'
           }} 
-        />
+        >
+          {(textTracks || []).map((track) => (
+            <track
+              key={track.src}
+              kind="subtitles"
+              src={track.src}
+              srcLang={track.srcLang}
+              label={track.label}
+              default={Boolean(track.default)}
+            />
+          ))}
+        </video>
       )}
       
       {/* Meter/Slider control */}
@@ -296,6 +327,24 @@ export default function VideoPreview({ videoUrl, title = 'Video Preview', defaul
         >
           ⬇ Download
         </button>
+
+        {isProxy && onExport && (
+          <button
+            onClick={onExport}
+            style={{
+              padding: '8px 16px',
+              fontSize: '14px',
+              backgroundColor: '#238636',
+              color: '#ffffff',
+              border: '1px solid #2ea043',
+              borderRadius: '4px',
+              cursor: 'pointer',
+              WebkitTapHighlightColor: 'transparent'
+            }}
+          >
+            ⇪ Export full quality
+          </button>
+        )}
         
         {!isAudio && (
           <button 
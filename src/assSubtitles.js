@@ -0,0 +1,114 @@
+// Subtitle burn-in from one ASS document. The primary and translated tracks are two styles
+// of the same document, so a single libass renderer draws both. The rendered subtitles are
+// a transparent overlay video of their own, which is kept in the render cache per (document,
+// frame format): burning the same captions again, onto this or another edit of the same
+// size, skips libass, and a restyle re-renders only the overlay.
+import ffmpeg from 'fluent-ffmpeg';
+import { parseFrameRate } from './transitionEngine.js';
+import { videoStreamOf, durationOf } from './probeCache.js';
+
+export const SUBTITLE_STYLES = ['default', 'white_on_black', 'yellow'];
+export const SUBTITLE_POSITIONS = ['bottom', 'top'];
+
+// Script resolution FFmpeg uses for SRT input, so font sizes match the old subtitles= burn-in
+const PLAY_RES_X = 384;
+const PLAY_RES_Y = 288;
+
+// ASS Alignment values: 2=bottom-center, 8=top-center (numpad layout)
+const ASS_ALIGN_BOTTOM = 2;
+const ASS_ALIGN_TOP = 8;
+
+// ASS colour format: &HAABBGGRR (AA=alpha 00=opaque 80=semi-transparent, BB=blue, GG=green, RR=red)
+const STYLE_COLOURS = {
+  // White text on semi-transparent black background boxes
+  white_on_black: { primary: '&H00FFFFFF', outline: '&H00000000', back: '&H80000000', bold: 0, borderStyle: 4, outlineWidth: 0 },
+  // Yellow text (&H0000FFFF = BGR yellow) with black outline
+  yellow: { primary: '&H0000FFFF', outline: '&H00000000', back: '&H00000000', bold: -1, borderStyle: 1, outlineWidth: 1 },
+  // White text with black outline
+  default: { primary: '&H00FFFFFF', outline: '&H00000000', back: '&H00000000', bold: 0, borderStyle: 1, outlineWidth: 1 }
+};
+
+function styleLine(name, { fontSize, alignment, style }) {
+  const c = STYLE_COLOURS[style];
+  return `Style: ${name},Arial,${fontSize},${c.primary},${c.primary},${c.outline},${c.back},` +
+    `${c.bold},0,0,0,100,100,0,0,${c.borderStyle},${c.outlineWidth},0,${alignment},10,10,10,1`;
+}
+
+// 3723.5 -> "1:02:03.50"
+export function assTimestamp(seconds) {
+  const totalCs = Math.max(0, Math.round(seconds * 100));
+  const pad = (value) => String(value).padStart(2, '0');
+  return `${Math.floor(totalCs / 360000)}:${pad(Math.floor(totalCs / 6000) % 60)}:` +
+    `${pad(Math.floor(totalCs / 100) % 60)}.${pad(totalCs % 100)}`;
+}
+
+// Cue text as literal ASS event text: override tags are escaped and line breaks become \N
+export function escapeAssText(text) {
+  return text.replace(/[\\{}]/g, (char) => `\\${char}`).replace(/\r?\n/g, '\\N');
+}
+
+// One ASS document with the primary cues at `position` and the translated cues (if any)
+// at the opposite edge, in a slightly smaller font
+export function buildAssDocument({ cues, translatedCues = [], style = 'default', position = 'bottom' }) {
+  const primaryAlignment = position === 'top' ? ASS_ALIGN_TOP : ASS_ALIGN_BOTTOM;
+  const translatedAlignment = position === 'top' ? ASS_ALIGN_BOTTOM : ASS_ALIGN_TOP;
+  const events = [
+    ...cues.map((cue) => ({ ...cue, styleName: 'Primary' })),
+    ...translatedCues.map((cue) => ({ ...cue, styleName: 'Translated' }))
+  ].map((cue) => `Dialogue: 0,${assTimestamp(cue.start)},${assTimestamp(cue.end)},${cue.styleName},,0,0,0,,${escapeAssText(cue.text)}`);
+
+  return [
+    '[Script Info]',
+    'ScriptType: v4.00+',
+    `PlayResX: ${PLAY_RES_X}`,
+    `PlayResY: ${PLAY_RES_Y}`,
+    'WrapStyle: 0',
+    'ScaledBorderAndShadow: yes',
+    '',
+    '[V4+ Styles]',
+    'Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, ' +
+      'Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding',
+    styleLine('Primary', { fontSize: 20, alignment: primaryAlignment, style }),
+    styleLine('Translated', { fontSize: 18, alignment: translatedAlignment, style }),
+    '',
+    '[Events]',
+    'Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text',
+    ...events,
+    ''
+  ].join('\n');
+}
+
+// ass filter for a document on disk. Escape backslashes first, then single quotes for safe
+// embedding in the filter string.
+export function assFilter(assPath, options = '') {
+  return `ass='${assPath.replace(/\\/g, '\\\\').replace(/'/g, "\\'")}'${options}`;
+}
+
+// Frame format the overlay is rendered in: the displayed size (after rotation), frame rate
+// and duration of the video. Null when the input has no usable video stream.
+export function overlayFormat(metadata) {
+  const video = videoStreamOf(metadata);
+  const duration = durationOf(metadata);
+  if (!video?.width || !video?.height || !duration) return null;
+  const rotation = Number(video.side_data_list?.find((data) => data.rotation !== undefined)?.rotation ?? video.tags?.rotate ?? 0);
+  const rotated = Math.abs(rotation) % 180 === 90;
+  const fps = parseFrameRate(video.avg_frame_rate) || parseFrameRate(video.r_frame_rate) || 30;
+  return {
+    width: rotated ? video.height : video.width,
+    height: rotated ? video.width : video.height,
+    fps: Math.round(fps * 1000) / 1000,
+    duration
+  };
+}
+
+// Command rendering the document into a transparent QuickTime RLE video. The frames are
+// mostly empty and identical between cues, which RLE stores in almost no space.
+export function subtitleOverlayCommand(assPath, { width, height, fps, duration }) {
+  return ffmpeg()
+    .input(`color=c=black@0:s=${width}x${height}:r=${fps}:d=${duration}`)
+    .inputFormat('lavfi')
+    .videoFilters(['format=rgba', assFilter(assPath, ':alpha=1')])
+    .videoCodec('qtrle')
+    .outputOptions(['-pix_fmt', 'argb'])
+    .format('mov');
+}
@@ -0,0 +1,282 @@
+// Content-addressed media store for server-side processing.
+// Uploads and rendered outputs are kept on disk under their SHA-256 so chained
+// edits can reference a previous result by id instead of re-uploading it.
+import { createHash, randomUUID } from 'crypto';
+import { createReadStream, createWriteStream, promises as fs } from 'fs';
+import path from 'path';
+import { Transform } from 'stream';
+import { pipeline } from 'stream/promises';
+
+const CONTENT_ID_PATTERN = /^[a-f0-9]{64}$/;
+const OUTPUT_ID_PATTERN = /^out-[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}$/;
+const MAX_OUTPUT_ALIASES = 10000;
+
+export function isValidAssetId(id) {
+  return typeof id === 'string' && (CONTENT_ID_PATTERN.test(id) || OUTPUT_ID_PATTERN.test(id));
+}
+
+// Public view of an asset record, safe to return to clients.
+// proxy marks low-resolution previews that must be exported for full quality.
+export function describeAsset(asset) {
+  const description = { assetId: asset.id, size: asset.size, mimeType: asset.mimeType };
+  if (asset.meta?.lineage) description.proxy = true;
+  return description;
+}
+
+// Stream a file through SHA-256 without buffering it
+async function hashFile(filePath) {
+  const hash = createHash('sha256');
+  let size = 0;
+  for await (const chunk of createReadStream(filePath)) {
+    hash.update(chunk);
+    size += chunk.length;
+  }
+  return { hash: hash.digest('hex'), size };
+}
+
+export class AssetStore {
+  constructor({ dir, maxBytes = 10 * 1024 * 1024 * 1024 } = {}) {
+    if (!dir) throw new Error('AssetStore requires a directory');
+    this.dir = dir;
+    this.incomingDir = path.join(dir, '.incoming');
+    this.maxBytes = maxBytes;
+    this.assets = new Map(); // content hash -> asset record
+    this.outputAliases = new Map(); // provisional output id -> Promise<content hash | null>
+    this.pendingCommits = new Map(); // content hash -> Promise<asset> while it is being committed
+    this.dropListeners = new Set(); // called with each asset removed from the store
+    this.totalBytes = 0;
+  }
+
+  async init() {
+    await fs.mkdir(this.incomingDir, { recursive: true });
+
+    // Anything left in .incoming was interrupted mid-write by a previous process
+    for (const name of await fs.readdir(this.incomingDir)) {
+      await fs.unlink(path.join(this.incomingDir, name)).catch(() => {});
+    }
+
+    // Rebuild the index from the metadata sidecars
+    for (const name of await fs.readdir(this.dir)) {
+      const id = name.replace(/\.json$/, '');
+      if (id === name || !CONTENT_ID_PATTERN.test(id)) continue;
+      const sidecarPath = path.join(this.dir, name);
+      try {
+        const record = JSON.parse(await fs.readFile(sidecarPath, 'utf8'));
+        const assetPath = path.join(this.dir, `${id}.${record.ext}`);
+        const stat = await fs.stat(assetPath);
+        this.index({
+          id,
+          path: assetPath,
+          ext: record.ext,
+          size: stat.size,
+          mimeType: record.mimeType,
+          meta: record.meta || {},
+          createdAt: record.createdAt || stat.mtimeMs,
+          lastAccessAt: stat.mtimeMs,
+          refs: 0
+        });
+      } catch (error) {
+        await fs.unlink(sidecarPath).catch(() => {});
+      }
+    }
+
+    await this.evict();
+  }
+
+  index(asset) {
+    this.assets.set(asset.id, asset);
+    this.totalBytes += asset.size;
+  }
+
+  // Move a fully written, already hashed file into the store (or drop it if the content is known).
+  // Concurrent commits of the same content wait for the first one, so it is indexed only once.
+  async commitFile(tmpPath, file) {
+    const existing = this.assets.get(file.hash);
+    if (existing) {
+      await fs.unlink(tmpPath).catch(() => {});
+      existing.lastAccessAt = Date.now();
+      return existing;
+    }
+
+    const pending = this.pendingCommits.get(file.hash);
+    if (pending) {
+      await pending.catch(() => {});
+      // Either indexed by now, or the first commit failed and this copy is committed instead
+      return this.commitFile(tmpPath, file);
+    }
+
+    const commit = this.storeFile(tmpPath, file);
+    this.pendingCommits.set(file.hash, commit);
+    try {
+      return await commit;
+    } finally {
+      this.pendingCommits.delete(file.hash);
+    }
+  }
+
+  async storeFile(tmpPath, { hash, size, mimeType, ext, meta }) {
+    const assetPath = path.join(this.dir, `${hash}.${ext}`);
+    await fs.rename(tmpPath, assetPath);
+    const asset = {
+      id: hash,
+      path: assetPath,
+      ext,
+      size,
+      mimeType,
+      meta: meta || {},
+      createdAt: Date.now(),
+      lastAccessAt: Date.now(),
+      refs: 0
+    };
+    await fs.writeFile(
+      path.join(this.dir, `${hash}.json`),
+      JSON.stringify({ ext, mimeType, meta: asset.meta, createdAt: asset.createdAt })
+    );
+    this.index(asset);
+    // Pinned while evicting, so making room never drops what is being committed
+    asset.refs++;
+    try {
+      await this.evict();
+    } finally {
+      this.release(asset);
+    }
+    return asset;
+  }
+
+  // Hash a readable stream into the store without holding it in memory.
+  // Streams longer than maxBytes are rejected with an error whose code is LIMIT_FILE_SIZE.
+  async ingestStream(readable, { mimeType = 'application/octet-stream', ext = 'bin', meta, maxBytes = Infinity } = {}) {
+    const tmpPath = path.join(this.incomingDir, `${randomUUID()}.${ext}`);
+    const hash = createHash('sha256');
+    let size = 0;
+    const hasher = new Transform({
+      transform(chunk, encoding, callback) {
+        size += chunk.length;
+        if (size > maxBytes) {
+          const error = new Error(`Upload exceeds the ${maxBytes} byte limit`);
+          error.code = 'LIMIT_FILE_SIZE';
+          return callback(error);
+        }
+        hash.update(chunk);
+        callback(null, chunk);
+      }
+    });
+
+    try {
+      await pipeline(readable, hasher, createWriteStream(tmpPath));
+    } catch (error) {
+      await fs.unlink(tmpPath).catch(() => {});
+      throw error;
+    }
+
+    return this.commitFile(tmpPath, { hash: hash.digest('hex'), size, mimeType, ext, meta });
+  }
+
+  async ingestBuffer(buffer, options = {}) {
+    const hash = createHash('sha256').update(buffer).digest('hex');
+    const tmpPath = path.join(this.incomingDir, `${randomUUID()}.${options.ext || 'bin'}`);
+    await fs.writeFile(tmpPath, buffer);
+    return this.commitFile(tmpPath, {
+      hash,
+      size: buffer.length,
+      mimeType: options.mimeType || 'application/octet-stream',
+      ext: options.ext || 'bin',
+      meta: options.meta
+    });
+  }
+
+  // Reserve a path for an output that is still being rendered. The returned id can be
+  // handed to the client immediately; lookups on it wait until the output is committed.
+  reserveOutput({ mimeType = 'video/mp4', ext = 'mp4', meta } = {}) {
+    const id = `out-${randomUUID()}`;
+    const outputPath = path.join(this.incomingDir, `${id}.${ext}`);
+    let settle;
+    this.outputAliases.set(id, new Promise((resolve) => { settle = resolve; }));
+    if (this.outputAliases.size > MAX_OUTPUT_ALIASES) {
+      this.outputAliases.delete(this.outputAliases.keys().next().value);
+    }
+
+    return {
+      id,
+      path: outputPath,
+      commit: async () => {
+        try {
+          const { hash, size } = await hashFile(outputPath);
+          const asset = await this.commitFile(outputPath, { hash, size, mimeType, ext, meta });
+          settle(asset.id);
+          return asset;
+        } catch (error) {
+          settle(null);
+          this.outputAliases.delete(id);
+          await fs.unlink(outputPath).catch(() => {});
+          throw error;
+        }
+      },
+      abort: async () => {
+        settle(null);
+        this.outputAliases.delete(id);
+        await fs.unlink(outputPath).catch(() => {});
+      }
+    };
+  }
+
+  // Resolve an asset id (content hash or provisional output id) to its record
+  async get(id) {
+    if (!isValidAssetId(id)) return null;
+    let hash = id;
+    if (this.outputAliases.has(id)) {
+      hash = await this.outputAliases.get(id);
+      if (!hash) return null;
+    }
+    const asset = this.assets.get(hash);
+    if (!asset) return null;
+    asset.lastAccessAt = Date.now();
+    return asset;
+  }
+
+  // Like get(), but protects the asset from eviction until release() is called
+  async acquire(id) {
+    const asset = await this.get(id);
+    if (asset) asset.refs++;
+    return asset;
+  }
+
+  release(asset) {
+    if (asset) asset.refs = Math.max(0, asset.refs - 1);
+  }
+
+  // Drop least recently used assets until the store is back under its byte quota
+  async evict() {
+    if (this.totalBytes <= this.maxBytes) return;
+    const candidates = [...this.assets.values()]
+      .filter((asset) => asset.refs === 0)
+      .sort((a, b) => a.lastAccessAt - b.lastAccessAt);
+
+    for (const asset of candidates) {
+      if (this.totalBytes <= this.maxBytes) break;
+      // Earlier drops yield, so a candidate may have been acquired or removed since the snapshot
+      if (this.assets.get(asset.id) !== asset || asset.refs > 0) continue;
+      await this.drop(asset);
+    }
+  }
+
+  // The index is updated before the first await, and only once per record, so concurrent
+  // drops of the same asset neither double-count its bytes nor remove a newer record.
+  async drop(asset) {
+    if (this.assets.get(asset.id) !== asset) return;
+    this.assets.delete(asset.id);
+    this.totalBytes -= asset.size;
+    await fs.unlink(asset.path).catch(() => {});
+    await fs.unlink(path.join(this.dir, `${asset.id}.json`)).catch(() => {});
+    for (const listener of this.dropListeners) {
+      await Promise.resolve(listener(asset)).catch((error) => console.warn('Asset drop listener failed:', error.message));
+    }
+  }
+
+  // Run listener(asset) whenever an asset is removed from the store, to clean up data derived
+  // from it. Returns a function that removes the listener.
+  onDrop(listener) {
+    this.dropListeners.add(listener);
+    return () => this.dropListeners.delete(listener);
+  }
+}
@@ -0,0 +1,40 @@
+// Derived audio renditions of a source: decoded once per source content hash and kept in
+// the asset store (through the render cache, which evicts the least recently used ones),
+// so captioning, silence detection and loudness analysis of the same source read a small
+// ready-made file instead of decoding the source again.
+import ffmpeg from 'fluent-ffmpeg';
+
+export const AUDIO_RENDITIONS = {
+  // Mono 16 kHz MP3: compact input for speech-to-text, cut into chunks by stream copy
+  speech: {
+    ext: 'mp3',
+    mimeType: 'audio/mpeg',
+    outputOptions: ['-ac', '1', '-ar', '16000', '-c:a', 'libmp3lame', '-b:a', '64k']
+  },
+  // 48 kHz 16-bit PCM in the source's channel layout, for measurements (RF64 past 4 GiB)
+  analysis: {
+    ext: 'wav',
+    mimeType: 'audio/wav',
+    outputOptions: ['-ar', '48000', '-c:a', 'pcm_s16le', '-rf64', 'auto']
+  }
+};
+
+export function isAudioRendition(name) {
+  return Object.hasOwn(AUDIO_RENDITIONS, name);
+}
+
+// Command extracting a rendition of the source's first audio stream (output not yet set)
+export function audioRenditionCommand(inputPath, name) {
+  const rendition = AUDIO_RENDITIONS[name];
+  return ffmpeg(inputPath)
+    .noVideo()
+    .outputOptions(['-map', '0:a:0', '-map_metadata', '-1', ...rendition.outputOptions])
+    .format(rendition.ext);
+}
+
+// Command cutting [start, end) out of the speech rendition without re-encoding
+export function speechClipCommand(speechPath, { start, end }) {
+  const command = ffmpeg(speechPath).seekInput(start);
+  if (Number.isFinite(end)) command.duration(end - start);
+  return command.audioCodec('copy').format('mp3');
+}
@@ -0,0 +1,123 @@
+// Overlap-add processing of long audio through filters that run single-threaded.
+// The audio is cut into chunks that are filtered by concurrent FFmpeg processes. Each chunk
+// starts with a pre-roll that warms up the filter state and is discarded, and ends with an
+// overlap that is crossfaded with the start of the next chunk, so the seams are inaudible
+// for filters whose state settles within the pre-roll. Video is stream-copied.
+// Reversal is chunked too: reversing every chunk and joining them in reverse order is
+// exactly areverse of the whole track, with memory bounded by the chunk length.
+import ffmpeg from 'fluent-ffmpeg';
+import { promises as fs } from 'fs';
+import path from 'path';
+import { runWithConcurrency } from './segmentedEncode.js';
+import { durationOf } from './probeCache.js';
+import { tmpScratch } from './scratch.js';
+
+const seconds = (value) => value.toFixed(6);
+// Float PCM chunks of a stereo 48 kHz track, reserved in scratch space up front
+const pcmBytes = (duration) => Math.ceil(duration * 48000 * 2 * 4);
+
+// Chunks covering [0, duration): each renders [renderStart, renderEnd), drops the first
+// preRoll seconds and keeps [start, renderEnd), which overlaps the next chunk by overlap.
+export function planAudioChunks(duration, chunkSeconds, { preRoll, overlap }) {
+  const count = Math.max(1, Math.round(duration / chunkSeconds));
+  const length = duration / count;
+  return Array.from({ length: count }, (_, i) => {
+    const start = i * length;
+    const end = i === count - 1 ? duration : (i + 1) * length;
+    const renderStart = Math.max(0, start - preRoll);
+    return {
+      start,
+      renderStart,
+      renderEnd: i === count - 1 ? duration : Math.min(duration, end + overlap),
+      preRoll: start - renderStart
+    };
+  });
+}
+
+// Filtergraph joining chunk inputs offset..offset+count-1 into [a]
+export function buildChunkJoinFilter(count, overlap, offset = 0) {
+  if (count === 1) return `[${offset}:a]anull[a]`;
+  const filters = [];
+  let previous = `${offset}:a`;
+  for (let i = 1; i < count; i++) {
+    const label = i === count - 1 ? 'a' : `j${i}`;
+    filters.push(`[${previous}][${offset + i}:a]acrossfade=d=${seconds(overlap)}:c1=tri:c2=tri[${label}]`);
+    previous = label;
+  }
+  return filters.join(';');
+}
+
+// Filter the audio of inputPath through audioFilters into an MP4 at outputPath, copying video.
+// runFfmpeg(command) runs a fluent-ffmpeg command to completion (under the job scheduler);
+// parallelism bounds how many chunk renders this job queues at once.
+export async function chunkedAudioRender({
+  inputPath, outputPath, metadata, audioFilters, runFfmpeg, parallelism,
+  chunkSeconds, preRoll = 2, overlap = 0.05, scratch = tmpScratch
+}) {
+  const duration = durationOf(metadata);
+  if (!duration) throw new Error('Cannot split audio of unknown duration');
+
+  const chunks = planAudioChunks(duration, chunkSeconds, { preRoll, overlap });
+  const scratchDir = await scratch.createDir('chunked-audio', { reserveBytes: pcmBytes(duration) });
+  const workDir = scratchDir.path;
+  try {
+    // Chunks are kept as float PCM so the join is the only lossy encode
+    const chunkPaths = chunks.map((_, i) => path.join(workDir, `chunk-${i}.wav`));
+    await runWithConcurrency(chunks, parallelism, (chunk, i) => runFfmpeg(
+      ffmpeg(inputPath)
+        .seekInput(seconds(chunk.renderStart))
+        .duration(seconds(chunk.renderEnd - chunk.renderStart))
+        .noVideo()
+        .audioFilters([...audioFilters, `atrim=start=${seconds(chunk.preRoll)}`, 'asetpts=PTS-STARTPTS'].join(','))
+        .outputOptions(['-map', '0:a:0', '-c:a', 'pcm_f32le'])
+        .format('wav')
+        .output(chunkPaths[i])
+    ));
+
+    const join = ffmpeg(inputPath);
+    chunkPaths.forEach((chunkPath) => join.input(chunkPath));
+    await runFfmpeg(join
+      .complexFilter(buildChunkJoinFilter(chunkPaths.length, overlap, 1))
+      .outputOptions(['-map', '0:v?', '-c:v', 'copy', '-map', '[a]', '-c:a', 'aac', '-b:a', '192k', '-movflags', '+faststart'])
+      .output(outputPath));
+  } finally {
+    await scratchDir.release();
+  }
+}
+
+// Reverse the audio of inputPath into an MP4 at outputPath, copying video. Unlike a single
+// areverse, which buffers the whole decoded track, each process holds one chunk.
+export async function chunkedAudioReverse({ inputPath, outputPath, metadata, runFfmpeg, parallelism, chunkSeconds, scratch = tmpScratch }) {
+  const duration = durationOf(metadata);
+  if (!duration) throw new Error('Cannot split audio of unknown duration');
+
+  const chunks = planAudioChunks(duration, chunkSeconds, { preRoll: 0, overlap: 0 });
+  const scratchDir = await scratch.createDir('reverse-audio', { reserveBytes: pcmBytes(duration) });
+  const workDir = scratchDir.path;
+  try {
+    // PCM chunks join sample-exactly with the concat demuxer
+    const chunkPaths = chunks.map((_, i) => path.join(workDir, `chunk-${i}.wav`));
+    await runWithConcurrency(chunks, parallelism, (chunk, i) => runFfmpeg(
+      ffmpeg(inputPath)
+        .seekInput(seconds(chunk.renderStart))
+        .duration(seconds(chunk.renderEnd - chunk.renderStart))
+        .noVideo()
+        .audioFilters('areverse')
+        .outputOptions(['-map', '0:a:0', '-c:a', 'pcm_f32le'])
+        .format('wav')
+        .output(chunkPaths[i])
+    ));
+
+    const listPath = path.join(workDir, 'chunks.txt');
+    await fs.writeFile(listPath, [...chunkPaths].reverse().map((p) => `file '${p}'`).join('\n'));
+
+    await runFfmpeg(ffmpeg()
+      .input(listPath)
+      .inputOptions(['-f', 'concat', '-safe', '0'])
+      .input(inputPath)
+      .outputOptions(['-map', '1:v?', '-c:v', 'copy', '-map', '0:a:0', '-c:a', 'aac', '-b:a', '192k', '-movflags', '+faststart'])
+      .output(outputPath));
+  } finally {
+    await scratchDir.release();
+  }
+}
@@ -0,0 +1,171 @@
+// Per-user budgets of FFmpeg time. A media request is admitted when its owner's budget
+// covers its estimated encode seconds (duration x resolution x operation weight, from probe
+// data), which are charged up front. When the request is done, the estimate is replaced by
+// the measured time its FFmpeg processes held a scheduler slot: the difference is refunded,
+// or charged when the work took longer. Work a request hands off (a background render job)
+// holds the meter, keeping the estimate reserved until it ends. Budgets refill continuously
+// over the window.
+import { isFilterOperation, isAudioOnlyOperation } from './videoOps.js';
+
+// Resolution the operation weights are calibrated at
+export const REFERENCE_PIXELS = 1920 * 1080;
+// Flat cost of any admitted request (probing, muxing, cache lookups)
+const MIN_COST_SECONDS = 0.5;
+// Bitrate assumed to turn an upload's size into a duration before it can be probed
+const ASSUMED_UPLOAD_BITS_PER_SECOND = 8_000_000;
+
+// Encode seconds per second of 1080p input. Video re-encodes are the unit; audio-only
+// filters copy the video; remuxes and probes barely decode.
+const OPERATION_WEIGHTS = {
+  upload: 0,
+  get_video_info: 0,
+  get_video_dimensions: 0,
+  mux_subtitles: 0.01,
+  extract_audio: 0.05,
+  convert_audio_format: 0.05,
+  generate_captions: 0.05
+};
+const AUDIO_WEIGHT = 0.05;
+const VIDEO_WEIGHT = 1;
+
+export function operationWeight(operation, args = {}) {
+  if (operation === 'apply_operations') {
+    const entries = Array.isArray(args.operations) ? args.operations : [];
+    return Math.max(AUDIO_WEIGHT, ...entries.map((entry) => operationWeight(entry?.operation, entry?.args)));
+  }
+  // Stream-copy trims only re-encode the partial GOPs at the edges (none in fast mode)
+  if (operation === 'trim_video') return args.mode === 'fast' ? 0.01 : 0.1;
+  if (Object.hasOwn(OPERATION_WEIGHTS, operation)) return OPERATION_WEIGHTS[operation];
+  if (isFilterOperation(operation) && isAudioOnlyOperation(operation)) return AUDIO_WEIGHT;
+  return VIDEO_WEIGHT;
+}
+
+// Estimated encode seconds of an operation on an input of the given duration and frame
+// size (audio-only inputs are costed as audio work at any weight)
+export function estimateEncodeSeconds({ duration, width, height, operation, args }) {
+  const weight = operationWeight(operation, args);
+  const pixelScale = width > 0 && height > 0 ? (width * height) / REFERENCE_PIXELS : AUDIO_WEIGHT;
+  return MIN_COST_SECONDS + (duration > 0 ? duration : 0) * pixelScale * weight;
+}
+
+// Input duration guessed from an upload's byte size
+export function durationFromUploadSize(bytes) {
+  return bytes > 0 ? (bytes * 8) / ASSUMED_UPLOAD_BITS_PER_SECOND : 0;
+}
+
+// Whose budget a request is charged to. Signed-in users have their own; sample-mode requests
+// share one per client IP, since anyone can mint new sample tokens.
+export function budgetOwner(req) {
+  return req.user?.id ? `user:${req.user.id}` : `ip:${req.ip}`;
+}
+
+export class CostBudgetError extends Error {
+  constructor(retryAfterSeconds) {
+    super('Video processing budget used up, please try again later');
+    this.name = 'CostBudgetError';
+    this.code = 'cost_budget_exceeded';
+    this.retryAfterSeconds = retryAfterSeconds;
+  }
+}
+
+// What one admitted request has been charged and measured
+class CostMeter {
+  constructor(limiter, owner, estimate) {
+    this.limiter = limiter;
+    this.owner = owner;
+    this.estimate = estimate;
+    this.measured = 0;
+    this.settled = false;
+    this.holds = 0;
+  }
+
+  // Keep the estimate reserved until the returned release() is called (once per holder);
+  // the meter settles when its last holder releases it
+  hold() {
+    this.holds++;
+    let released = false;
+    return () => {
+      if (released) return;
+      released = true;
+      if (--this.holds === 0) this.settle();
+    };
+  }
+
+  // Record FFmpeg slot seconds; after settlement they are charged directly
+  add(seconds) {
+    this.measured += seconds;
+    if (this.settled) this.limiter.adjust(this.owner, -seconds);
+  }
+
+  // Replace the up-front estimate with the measured cost so far (idempotent)
+  settle() {
+    if (this.settled) return;
+    this.settled = true;
+    this.limiter.adjust(this.owner, this.estimate - this.measured);
+  }
+}
+
+export class CostLimiter {
+  constructor({ budgetSeconds, windowSeconds, maxOwners = 10000, now = Date.now }) {
+    this.budgetSeconds = budgetSeconds;
+    this.refillPerSecond = budgetSeconds / windowSeconds;
+    this.maxOwners = maxOwners;
+    this.now = now;
+    this.buckets = new Map(); // owner -> { balance, updatedAt }, least recently used first
+    this.admitted = 0;
+    this.rejected = 0;
+  }
+
+  bucket(owner) {
+    const now = this.now();
+    let bucket = this.buckets.get(owner);
+    if (bucket) {
+      this.buckets.delete(owner);
+      bucket.balance = Math.min(this.budgetSeconds, bucket.balance + ((now - bucket.updatedAt) / 1000) * this.refillPerSecond);
+      bucket.updatedAt = now;
+    } else {
+      bucket = { balance: this.budgetSeconds, updatedAt: now };
+    }
+    this.buckets.set(owner, bucket);
+    // Idle owners whose budget has refilled are forgotten first; owners still in debt are kept
+    for (const [oldestOwner, oldest] of this.buckets) {
+      if (this.buckets.size <= this.maxOwners) break;
+      if (oldest.balance + ((now - oldest.updatedAt) / 1000) * this.refillPerSecond < this.budgetSeconds) continue;
+      this.buckets.delete(oldestOwner);
+    }
+    return bucket;
+  }
+
+  balance(owner) {
+    return this.bucket(owner).balance;
+  }
+
+  // Charge the estimate and return its meter, or throw CostBudgetError with the time until
+  // the budget covers it. Estimates above the whole budget need a full budget.
+  admit(owner, estimate) {
+    const bucket = this.bucket(owner);
+    const required = Math.min(estimate, this.budgetSeconds);
+    if (bucket.balance < required) {
+      this.rejected++;
+      throw new CostBudgetError(Math.max(1, Math.ceil((required - bucket.balance) / this.refillPerSecond)));
+    }
+    bucket.balance -= estimate;
+    this.admitted++;
+    return new CostMeter(this, owner, estimate);
+  }
+
+  // Credit (positive) or debit (negative) an owner's budget
+  adjust(owner, seconds) {
+    const bucket = this.bucket(owner);
+    bucket.balance = Math.min(this.budgetSeconds, bucket.balance + seconds);
+  }
+
+  stats() {
+    return {
+      budgetSeconds: this.budgetSeconds,
+      owners: this.buckets.size,
+      admitted: this.admitted,
+      rejected: this.rejected
+    };
+  }
+}
@@ -0,0 +1,30 @@
+// Named x264 encode profiles. Chat edits are previews and default to the fast draft
+// profile; final is meant for the exported result.
+// threads: 0 lets x264 pick (all cores); lower values leave room for concurrent jobs.
+
+export const ENCODE_PROFILES = {
+  draft: { preset: 'ultrafast', crf: 28, tune: 'fastdecode', threads: 2 },
+  balanced: { preset: 'veryfast', crf: 23, tune: null, threads: 4 },
+  final: { preset: 'slow', crf: 18, tune: null, threads: 0 }
+};
+
+export const DEFAULT_ENCODE_PROFILE = 'draft';
+
+export function isEncodeProfile(name) {
+  return typeof name === 'string' && Object.hasOwn(ENCODE_PROFILES, name);
+}
+
+// Profile chosen by the tool arg (encodeProfile) or the x-encode-profile header, in that order.
+// Returns { name, ...settings }, or null when an unknown profile was requested.
+export function selectEncodeProfile({ args, header } = {}) {
+  const name = args?.encodeProfile ?? header ?? DEFAULT_ENCODE_PROFILE;
+  return isEncodeProfile(name) ? { name, ...ENCODE_PROFILES[name] } : null;
+}
+
+// FFmpeg output options for libx264 with the given profile
+export function x264OutputOptions({ preset, crf, tune, threads }) {
+  const options = ['-preset', preset, '-crf', String(crf)];
+  if (tune) options.push('-tune', tune);
+  if (threads) options.push('-threads', String(threads));
+  return options;
+}
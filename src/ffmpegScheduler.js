@@ -0,0 +1,101 @@
+// Global admission control for FFmpeg processes.
+// A fixed number of slots (scaled by CPU count) run at once; further jobs wait in a bounded
+// FIFO queue, and jobs beyond the queue are rejected immediately with a retry estimate.
+import os from 'os';
+
+const DEFAULT_JOB_SECONDS = 10;
+const MAX_RETRY_AFTER_SECONDS = 300;
+
+export class SchedulerBusyError extends Error {
+  constructor(retryAfterSeconds) {
+    super('Server is busy processing other videos, please retry shortly');
+    this.name = 'SchedulerBusyError';
+    this.code = 'server_busy';
+    this.retryAfterSeconds = retryAfterSeconds;
+  }
+}
+
+export function cpuCount() {
+  return typeof os.availableParallelism === 'function' ? os.availableParallelism() : os.cpus().length;
+}
+
+export class JobScheduler {
+  constructor({ concurrency = 1, maxQueue = 0 } = {}) {
+    this.concurrency = Math.max(1, Math.floor(concurrency));
+    this.maxQueue = Math.max(0, Math.floor(maxQueue));
+    this.running = 0;
+    this.waiting = []; // { grant, reject, cleanup }
+    this.avgJobSeconds = DEFAULT_JOB_SECONDS;
+  }
+
+  // Concurrency from a per-core ratio, e.g. 0.5 on 8 cores -> 4 concurrent jobs
+  static fromEnv({ jobsPerCore, maxQueue }) {
+    return new JobScheduler({
+      concurrency: Math.max(1, Math.round(cpuCount() * jobsPerCore)),
+      maxQueue
+    });
+  }
+
+  isSaturated() {
+    return this.running >= this.concurrency && this.waiting.length >= this.maxQueue;
+  }
+
+  // Rough time until a newly queued job would start, from the average job duration
+  retryAfterSeconds() {
+    const rounds = Math.floor(this.waiting.length / this.concurrency) + 1;
+    return Math.min(MAX_RETRY_AFTER_SECONDS, Math.max(1, Math.ceil(rounds * this.avgJobSeconds)));
+  }
+
+  // Wait for a slot. Resolves to an idempotent release() that must be called when the
+  // process exits. Rejects with SchedulerBusyError when the queue is full, or with the
+  // signal's reason if the caller gives up while queued.
+  acquire({ signal } = {}) {
+    if (signal?.aborted) return Promise.reject(signal.reason || new Error('Aborted'));
+    if (this.running < this.concurrency) return Promise.resolve(this.grant());
+    if (this.waiting.length >= this.maxQueue) {
+      return Promise.reject(new SchedulerBusyError(this.retryAfterSeconds()));
+    }
+
+    return new Promise((resolve, reject) => {
+      const entry = {
+        grant: () => resolve(this.grant()),
+        reject,
+        cleanup: () => signal?.removeEventListener('abort', onAbort)
+      };
+      const onAbort = () => {
+        const index = this.waiting.indexOf(entry);
+        if (index !== -1) this.waiting.splice(index, 1);
+        reject(signal.reason || new Error('Aborted'));
+      };
+      signal?.addEventListener('abort', onAbort, { once: true });
+      this.waiting.push(entry);
+    });
+  }
+
+  grant() {
+    this.running++;
+    const startedAt = Date.now();
+    let released = false;
+    return () => {
+      if (released) return;
+      released = true;
+      this.running--;
+      // Exponentially weighted average keeps the Retry-After estimate current
+      this.avgJobSeconds = this.avgJobSeconds * 0.8 + ((Date.now() - startedAt) / 1000) * 0.2;
+      const next = this.waiting.shift();
+      if (next) {
+        next.cleanup();
+        next.grant();
+      }
+    };
+  }
+
+  stats() {
+    return {
+      running: this.running,
+      queued: this.waiting.length,
+      concurrency: this.concurrency,
+      maxQueue: this.maxQueue
+    };
+  }
+}
@@ -0,0 +1,56 @@
+// Two-pass EBU R128 loudness normalization. A measurement pass reads the integrated
+// loudness, loudness range, true peak and gating threshold of the input; those stats do not
+// depend on the target, so they are cached per content hash and the normalization pass can
+// run loudnorm in linear mode (one constant gain) at any target.
+import ffmpeg from 'fluent-ffmpeg';
+
+export const TRUE_PEAK = -1.5;
+export const LOUDNESS_RANGE = 11;
+
+const STAT_FIELDS = {
+  inputI: 'input_i',
+  inputTp: 'input_tp',
+  inputLra: 'input_lra',
+  inputThresh: 'input_thresh'
+};
+
+// Stats from loudnorm's print_format=json report on stderr. Fields are null when the input
+// has no measurable loudness (e.g. digital silence reports -inf).
+export function parseLoudnormStats(stderr) {
+  const start = stderr.lastIndexOf('{');
+  const end = stderr.lastIndexOf('}');
+  if (start === -1 || end < start) throw new Error('loudnorm did not report loudness stats');
+  const report = JSON.parse(stderr.slice(start, end + 1));
+  return Object.fromEntries(Object.entries(STAT_FIELDS).map(([key, field]) => {
+    const value = Number(report[field]);
+    return [key, Number.isFinite(value) ? value : null];
+  }));
+}
+
+export function hasLoudnessStats(stats) {
+  return Boolean(stats) && Object.keys(STAT_FIELDS).every((key) => Number.isFinite(stats[key]));
+}
+
+// loudnorm filter for a target integrated loudness. With measured stats it runs in linear
+// mode; without them it falls back to single-pass dynamic normalization.
+export function loudnormFilter(target, stats) {
+  const base = `loudnorm=I=${target}:TP=${TRUE_PEAK}:LRA=${LOUDNESS_RANGE}`;
+  if (!hasLoudnessStats(stats)) return base;
+  return `${base}:measured_I=${stats.inputI}:measured_LRA=${stats.inputLra}` +
+    `:measured_TP=${stats.inputTp}:measured_thresh=${stats.inputThresh}:linear=true`;
+}
+
+// Measurement pass: decode the audio once and read loudnorm's report.
+// runFfmpeg(command) runs a fluent-ffmpeg command to completion (under the job scheduler).
+export async function measureLoudness(inputPath, { runFfmpeg }) {
+  const stderr = [];
+  const command = ffmpeg(inputPath)
+    .noVideo()
+    .audioFilters(`loudnorm=TP=${TRUE_PEAK}:LRA=${LOUDNESS_RANGE}:print_format=json`)
+    .outputOptions(['-map', '0:a:0'])
+    .format('null')
+    .output('-')
+    .on('stderr', (line) => stderr.push(line));
+  await runFfmpeg(command);
+  return parseLoudnormStats(stderr.join('\n'));
+}
@@ -0,0 +1,194 @@
+// In-process metrics in the Prometheus text exposition format (0.0.4), for /metrics.
+// Counters and histograms are updated as requests run; gauges and counters may instead be
+// read from a collect() callback at scrape time, for values other modules already track.
+// Each metric keeps at most maxSeries label combinations; further ones are folded into a
+// series whose labels are all "_other", so client-supplied values cannot grow it unbounded.
+import { monitorEventLoopDelay } from 'perf_hooks';
+
+export const DEFAULT_SECONDS_BUCKETS = [0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600];
+const OTHER_LABEL_VALUE = '_other';
+
+const escapeHelp = (text) => text.replace(/\\/g, '\\\\').replace(/\n/g, '\\n');
+const escapeLabelValue = (value) => String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n');
+
+export function formatValue(value) {
+  if (Number.isNaN(value)) return 'NaN';
+  if (value === Infinity) return '+Inf';
+  if (value === -Infinity) return '-Inf';
+  return String(value);
+}
+
+function formatLabels(labelNames, values, extra = '') {
+  const pairs = labelNames.map((name, i) => `${name}="${escapeLabelValue(values[i])}"`);
+  if (extra) pairs.push(extra);
+  return pairs.length > 0 ? `{${pairs.join(',')}}` : '';
+}
+
+class Metric {
+  constructor(type, { name, help, labelNames = [], maxSeries = 1000, collect }) {
+    this.type = type;
+    this.name = name;
+    this.help = help;
+    this.labelNames = labelNames;
+    this.maxSeries = maxSeries;
+    this.collectFn = collect;
+    this.series = new Map(); // JSON of label values -> { values, ...state }
+  }
+
+  seriesFor(labels = {}) {
+    let values = this.labelNames.map((name) => (labels[name] ?? '') + '');
+    let key = JSON.stringify(values);
+    let entry = this.series.get(key);
+    if (entry) return entry;
+    if (this.series.size >= this.maxSeries) {
+      values = this.labelNames.map(() => OTHER_LABEL_VALUE);
+      key = JSON.stringify(values);
+      entry = this.series.get(key);
+      if (entry) return entry;
+    }
+    entry = this.createSeries(values);
+    this.series.set(key, entry);
+    return entry;
+  }
+
+  createSeries(values) {
+    return { values, value: 0 };
+  }
+
+  // Sample lines of this metric, after collect() has refreshed it
+  async lines() {
+    if (this.collectFn) {
+      const collected = await this.collectFn();
+      const samples = typeof collected === 'number' ? [{ labels: {}, value: collected }] : collected;
+      this.series.clear();
+      for (const { labels, value } of samples) this.seriesFor(labels).value = value;
+    }
+    return [...this.series.values()].map((entry) =>
+      `${this.name}${formatLabels(this.labelNames, entry.values)} ${formatValue(entry.value)}`
+    );
+  }
+}
+
+class Counter extends Metric {
+  constructor(options) {
+    super('counter', options);
+  }
+
+  inc(labels, value = 1) {
+    this.seriesFor(labels).value += value;
+  }
+}
+
+class Gauge extends Metric {
+  constructor(options) {
+    super('gauge', options);
+  }
+
+  set(labels, value) {
+    this.seriesFor(labels).value = value;
+  }
+}
+
+class Histogram extends Metric {
+  constructor({ buckets = DEFAULT_SECONDS_BUCKETS, ...options }) {
+    super('histogram', options);
+    this.buckets = [...buckets].sort((a, b) => a - b);
+  }
+
+  createSeries(values) {
+    return { values, counts: this.buckets.map(() => 0), sum: 0, count: 0 };
+  }
+
+  observe(labels, value) {
+    const entry = this.seriesFor(labels);
+    this.buckets.forEach((bound, i) => {
+      if (value <= bound) entry.counts[i]++;
+    });
+    entry.sum += value;
+    entry.count++;
+  }
+
+  // Returns end(extraLabels) which observes the seconds since the timer started
+  startTimer(labels = {}) {
+    const startedAt = process.hrtime.bigint();
+    return (extraLabels = {}) => {
+      const seconds = Number(process.hrtime.bigint() - startedAt) / 1e9;
+      this.observe({ ...labels, ...extraLabels }, seconds);
+      return seconds;
+    };
+  }
+
+  async lines() {
+    const lines = [];
+    for (const entry of this.series.values()) {
+      this.buckets.forEach((bound, i) => {
+        lines.push(`${this.name}_bucket${formatLabels(this.labelNames, entry.values, `le="${formatValue(bound)}"`)} ${entry.counts[i]}`);
+      });
+      lines.push(`${this.name}_bucket${formatLabels(this.labelNames, entry.values, 'le="+Inf"')} ${entry.count}`);
+      lines.push(`${this.name}_sum${formatLabels(this.labelNames, entry.values)} ${formatValue(entry.sum)}`);
+      lines.push(`${this.name}_count${formatLabels(this.labelNames, entry.values)} ${entry.count}`);
+    }
+    return lines;
+  }
+}
+
+export class MetricsRegistry {
+  constructor() {
+    this.metrics = new Map(); // name -> metric
+  }
+
+  register(metric) {
+    if (this.metrics.has(metric.name)) throw new Error(`Metric ${metric.name} is already registered`);
+    this.metrics.set(metric.name, metric);
+    return metric;
+  }
+
+  counter(options) {
+    return this.register(new Counter(options));
+  }
+
+  gauge(options) {
+    return this.register(new Gauge(options));
+  }
+
+  histogram(options) {
+    return this.register(new Histogram(options));
+  }
+
+  // The exposition text of every metric; a failing collect() drops only its own metric
+  async render() {
+    const blocks = [];
+    for (const metric of this.metrics.values()) {
+      let lines;
+      try {
+        lines = await metric.lines();
+      } catch (error) {
+        console.warn(`Collecting metric ${metric.name} failed:`, error.message);
+        continue;
+      }
+      blocks.push(`# HELP ${metric.name} ${escapeHelp(metric.help)}\n# TYPE ${metric.name} ${metric.type}\n${lines.map((line) => `${line}\n`).join('')}`);
+    }
+    return blocks.join('');
+  }
+}
+
+// Event-loop delay since the previous scrape, as a gauge per quantile (in seconds)
+export function monitorEventLoopLag(registry, { name = 'event_loop_lag_seconds', resolutionMs = 20 } = {}) {
+  const histogram = monitorEventLoopDelay({ resolution: resolutionMs });
+  histogram.enable();
+  return registry.gauge({
+    name,
+    help: 'Event loop delay since the previous scrape',
+    labelNames: ['quantile'],
+    collect: () => {
+      // Without samples (no time has passed) the percentiles are 0 and max is a negative sentinel
+      const samples = histogram.count > 0 ? [
+        { labels: { quantile: '0.5' }, value: histogram.percentile(50) / 1e9 },
+        { labels: { quantile: '0.99' }, value: histogram.percentile(99) / 1e9 },
+        { labels: { quantile: '1' }, value: histogram.max / 1e9 }
+      ] : [];
+      histogram.reset();
+      return samples;
+    }
+  });
+}
@@ -0,0 +1,121 @@
+// ffprobe results per stored asset. Assets are content-addressed, so a probe never goes
+// stale: it is run once per content hash, kept in a bounded in-memory LRU, and spilled to
+// disk so restarts and memory evictions do not spawn ffprobe again. Spilled results are
+// deleted along with their asset when the store drops it.
+// Returned metadata is shared between callers and must be treated as read-only.
+// Other per-content measurements (e.g. loudness stats) reuse the cache with their own probe
+// function (called with the asset's path and the asset), directory and file suffix.
+import ffmpeg from 'fluent-ffmpeg';
+import { promises as fs } from 'fs';
+import path from 'path';
+
+const DEFAULT_FILE_SUFFIX = '.probe.json';
+
+function ffprobeFile(filePath) {
+  return new Promise((resolve, reject) => {
+    ffmpeg.ffprobe(filePath, (err, metadata) => (err ? reject(err) : resolve(metadata)));
+  });
+}
+
+export function videoStreamOf(metadata) {
+  return metadata?.streams?.find((stream) => stream.codec_type === 'video') || null;
+}
+
+export function hasAudioStream(metadata) {
+  return Boolean(metadata?.streams?.some((stream) => stream.codec_type === 'audio'));
+}
+
+// Duration in seconds, or null if unknown
+export function durationOf(metadata) {
+  const duration = Number(metadata?.format?.duration);
+  return duration > 0 ? duration : null;
+}
+
+export class ProbeCache {
+  constructor({ dir, store, maxEntries = 500, probe = ffprobeFile, suffix = DEFAULT_FILE_SUFFIX }) {
+    this.dir = dir;
+    this.suffix = suffix;
+    this.store = store;
+    this.maxEntries = maxEntries;
+    this.probe = probe;
+    this.entries = new Map(); // asset id -> metadata, least recently used first
+    this.pending = new Map(); // asset id -> in-flight Promise<metadata>
+    this.hits = 0;
+    this.diskHits = 0;
+    this.misses = 0;
+    if (store?.onDrop) store.onDrop((asset) => this.forget(asset.id));
+  }
+
+  // Drop spilled probes of assets the store no longer has
+  async init() {
+    await fs.mkdir(this.dir, { recursive: true });
+    for (const name of await fs.readdir(this.dir)) {
+      if (!name.endsWith(this.suffix)) continue;
+      if (!this.store?.assets.has(name.slice(0, -this.suffix.length))) {
+        await fs.unlink(path.join(this.dir, name)).catch(() => {});
+      }
+    }
+  }
+
+  filePath(id) {
+    return path.join(this.dir, `${id}${this.suffix}`);
+  }
+
+  // Metadata of a stored asset ({ id, path }); rejects when ffprobe fails
+  async get(asset) {
+    const { id } = asset;
+    const cached = this.entries.get(id);
+    if (cached) {
+      this.entries.delete(id);
+      this.entries.set(id, cached);
+      this.hits++;
+      return cached;
+    }
+    if (this.pending.has(id)) return this.pending.get(id);
+
+    const loading = this.load(asset).finally(() => this.pending.delete(id));
+    this.pending.set(id, loading);
+    return loading;
+  }
+
+  async load(asset) {
+    const { id, path: assetPath } = asset;
+    let metadata;
+    try {
+      metadata = JSON.parse(await fs.readFile(this.filePath(id), 'utf8'));
+      this.diskHits++;
+    } catch {
+      this.misses++;
+      metadata = await this.probe(assetPath, asset);
+      await fs.writeFile(this.filePath(id), JSON.stringify(metadata))
+        .catch((error) => console.warn('Failed to spill probe result:', error.message));
+      // Dropped while it was being probed: its forget() ran before the spill existed
+      if (this.store && !this.store.assets.has(id)) {
+        await this.forget(id);
+        return metadata;
+      }
+    }
+
+    this.entries.set(id, metadata);
+    for (const oldestId of this.entries.keys()) {
+      if (this.entries.size <= this.maxEntries) break;
+      this.entries.delete(oldestId);
+    }
+    return metadata;
+  }
+
+  async forget(id) {
+    this.entries.delete(id);
+    await fs.unlink(this.filePath(id)).catch(() => {});
+  }
+
+  stats() {
+    return {
+      hits: this.hits,
+      diskHits: this.diskHits,
+      misses: this.misses,
+      entries: this.entries.size,
+      maxEntries: this.maxEntries
+    };
+  }
+}
@@ -0,0 +1,88 @@
+// Proxy editing: interactive edits of large videos run on a low-resolution proxy, and each
+// proxy-derived output records its lineage ({ sourceId, scale, operations }) so the same edit
+// chain can be replayed on the full-resolution source at export.
+// Operation args always stay in source coordinates; they are scaled down only to render
+// the preview on the proxy.
+import { isFilterOperation } from './videoOps.js';
+
+const MAX_REPLAY_BATCH = 20;
+
+// Pixel-valued args per operation
+const PIXEL_ARGS = {
+  resize_video: ['width', 'height'],
+  crop_video: ['x', 'y', 'width', 'height'],
+  add_text: ['x', 'y', 'fontsize']
+};
+const EVEN_ARGS = new Set(['width', 'height']);
+
+// Operations whose output can be re-rendered from the source by replaying them in order
+export function isReplayableOperation(operation) {
+  return operation === 'apply_operations' || operation === 'trim_video' || isFilterOperation(operation);
+}
+
+// Proxy size for a video whose shorter side exceeds targetShortSide, or null when the video
+// is already small enough. scale is source pixels per proxy pixel.
+export function proxyDimensions(width, height, targetShortSide) {
+  const shortSide = Math.min(width, height);
+  if (!(targetShortSide > 0) || !(shortSide > targetShortSide)) return null;
+  return { shortSide: targetShortSide, scale: shortSide / targetShortSide };
+}
+
+// Multiply pixel args by factor (e.g. 1 / scale to render on the proxy). Widths and
+// heights stay even for 4:2:0 encoders; -1 ("keep aspect") is left alone.
+export function scaleOperationArgs(operation, args = {}, factor) {
+  if (operation === 'apply_operations') {
+    return {
+      ...args,
+      operations: (args.operations || []).map((entry) => ({
+        ...entry,
+        args: scaleOperationArgs(entry?.operation, entry?.args, factor)
+      }))
+    };
+  }
+  const keys = PIXEL_ARGS[operation];
+  if (!keys || factor === 1) return args;
+
+  const scaled = { ...args };
+  for (const key of keys) {
+    const value = Number(args[key]);
+    if (args[key] === undefined || !Number.isFinite(value) || value < 0) continue;
+    scaled[key] = EVEN_ARGS.has(key)
+      ? Math.max(2, Math.round((value * factor) / 2) * 2)
+      : Math.round(value * factor);
+  }
+  return scaled;
+}
+
+// Lineage of an output rendered from an input with the given lineage
+export function extendLineage(lineage, operation, args = {}) {
+  const { encodeProfile, ...recordedArgs } = args;
+  return { ...lineage, operations: [...lineage.operations, { operation, args: recordedArgs }] };
+}
+
+// Steps that re-render a lineage: runs of filter operations are fused into
+// apply_operations batches so the replay costs as few encodes as possible.
+export function replaySteps(operations) {
+  const expanded = operations.flatMap((entry) => (
+    entry.operation === 'apply_operations' ? entry.args.operations : [entry]
+  ));
+
+  const steps = [];
+  let batch = [];
+  const flush = () => {
+    if (batch.length === 1) steps.push(batch[0]);
+    else if (batch.length > 1) steps.push({ operation: 'apply_operations', args: { operations: batch } });
+    batch = [];
+  };
+  for (const entry of expanded) {
+    if (isFilterOperation(entry.operation)) {
+      batch.push({ operation: entry.operation, args: entry.args || {} });
+      if (batch.length === MAX_REPLAY_BATCH) flush();
+    } else {
+      flush();
+      steps.push({ operation: entry.operation, args: entry.args || {} });
+    }
+  }
+  flush();
+  return steps;
+}
@@ -0,0 +1,134 @@
+// Render result cache: maps (input content hash, operation, canonical args) to the
+// asset id of a previous output, so identical edits are served from disk without FFmpeg.
+// Outputs themselves live in the AssetStore; this index tracks which of them are reusable
+// renders and keeps them referenced while indexed, so the AssetStore's own eviction leaves them
+// alone. The least recently used entries beyond its byte quota are dropped and their outputs
+// released back to that eviction, since chained edits may still reference them by id.
+// Hit and miss counts cover lookups on behalf of a user's edit; lookups of intermediates
+// (proxies, audio renditions, overlays) pass internal and are counted separately.
+import { createHash } from 'crypto';
+import { promises as fs } from 'fs';
+
+// Bump when the FFmpeg pipeline changes in a way that makes old renders stale
+const RENDER_CACHE_VERSION = 1;
+const PERSIST_DELAY_MS = 1000;
+
+// JSON with object keys sorted recursively, so equivalent args produce the same key
+export function canonicalize(value) {
+  if (Array.isArray(value)) return `[${value.map(canonicalize).join(',')}]`;
+  if (value && typeof value === 'object') {
+    return `{${Object.keys(value).sort()
+      .filter((key) => value[key] !== undefined)
+      .map((key) => `${JSON.stringify(key)}:${canonicalize(value[key])}`)
+      .join(',')}}`;
+  }
+  return JSON.stringify(value ?? null);
+}
+
+export function renderCacheKey(inputId, operation, args) {
+  return createHash('sha256')
+    .update(canonicalize({ v: RENDER_CACHE_VERSION, input: inputId, operation, args: args || {} }))
+    .digest('hex');
+}
+
+export class RenderCache {
+  constructor({ store, indexPath, maxBytes = 2 * 1024 * 1024 * 1024 }) {
+    this.store = store;
+    this.indexPath = indexPath;
+    this.maxBytes = maxBytes;
+    this.entries = new Map(); // key -> { assetId, size }, in least-recently-used-first order
+    this.totalBytes = 0;
+    this.hits = 0;
+    this.misses = 0;
+    this.internalHits = 0;
+    this.internalMisses = 0;
+    this.persistTimer = null;
+  }
+
+  async init() {
+    try {
+      const saved = JSON.parse(await fs.readFile(this.indexPath, 'utf8'));
+      for (const [key, entry] of saved.entries || []) {
+        const asset = this.store.assets.get(entry.assetId);
+        if (!asset) continue;
+        asset.refs++;
+        this.entries.set(key, entry);
+        this.totalBytes += entry.size;
+      }
+    } catch (error) {
+      if (error.code !== 'ENOENT') console.warn('Render cache index unreadable, starting empty:', error.message);
+    }
+  }
+
+  // Returns the cached output asset, or null. The output must still exist in the store.
+  async lookup(key, { internal = false } = {}) {
+    const entry = this.entries.get(key);
+    const asset = entry ? await this.store.get(entry.assetId) : null;
+    if (!asset) {
+      if (entry) this.remove(key);
+      if (internal) this.internalMisses++;
+      else this.misses++;
+      return null;
+    }
+    // Re-insert to mark as most recently used
+    this.entries.delete(key);
+    this.entries.set(key, entry);
+    if (internal) this.internalHits++;
+    else this.hits++;
+    return asset;
+  }
+
+  record(key, asset) {
+    // An output larger than the whole quota would only evict everything, itself included
+    if (!asset || asset.size > this.maxBytes) return;
+    // Referenced before an older entry for the key is removed, which may be the same output
+    asset.refs++;
+    if (this.entries.has(key)) this.remove(key);
+    this.entries.set(key, { assetId: asset.id, size: asset.size });
+    this.totalBytes += asset.size;
+    for (const oldestKey of this.entries.keys()) {
+      if (this.totalBytes <= this.maxBytes) break;
+      this.remove(oldestKey);
+    }
+    this.schedulePersist();
+  }
+
+  remove(key) {
+    const entry = this.entries.get(key);
+    if (!entry) return;
+    this.entries.delete(key);
+    this.totalBytes -= entry.size;
+    const asset = this.store.assets.get(entry.assetId);
+    if (asset) this.store.release(asset);
+    this.schedulePersist();
+  }
+
+  stats() {
+    const lookups = this.hits + this.misses;
+    return {
+      hits: this.hits,
+      misses: this.misses,
+      hitRate: lookups > 0 ? this.hits / lookups : 0,
+      internalHits: this.internalHits,
+      internalMisses: this.internalMisses,
+      entries: this.entries.size,
+      bytes: this.totalBytes,
+      maxBytes: this.maxBytes
+    };
+  }
+
+  schedulePersist() {
+    if (this.persistTimer) return;
+    this.persistTimer = setTimeout(() => {
+      this.persistTimer = null;
+      this.persist().catch((error) => console.error('Failed to persist render cache index:', error));
+    }, PERSIST_DELAY_MS);
+    if (typeof this.persistTimer.unref === 'function') this.persistTimer.unref();
+  }
+
+  async persist() {
+    const tmpPath = `${this.indexPath}.tmp`;
+    await fs.writeFile(tmpPath, JSON.stringify({ entries: [...this.entries] }));
+    await fs.rename(tmpPath, this.indexPath);
+  }
+}
@@ -0,0 +1,142 @@
+// Asynchronous render jobs: a submitted render gets an id immediately, runs in the
+// background, and reports FFmpeg progress to any number of event subscribers.
+import { randomUUID } from 'crypto';
+
+const FINISHED_JOB_TTL_MS = 60 * 60 * 1000;
+
+// Parse FFmpeg `-progress` output (key=value lines, one block per update ending in
+// progress=continue|end). Calls onProgress with each completed block.
+export function createProgressParser(onProgress) {
+  let block = {};
+  return (line) => {
+    const separator = line.indexOf('=');
+    if (separator <= 0) return;
+    const key = line.slice(0, separator).trim();
+    const value = line.slice(separator + 1).trim();
+    block[key] = value;
+    if (key !== 'progress') return;
+
+    // out_time_us and the misnamed out_time_ms are both microseconds
+    const outTimeUs = Number(block.out_time_us ?? block.out_time_ms);
+    onProgress({
+      frame: Number(block.frame) || 0,
+      fps: Number(block.fps) || 0,
+      speed: parseFloat(block.speed) || 0,
+      outTimeSeconds: Number.isFinite(outTimeUs) && outTimeUs > 0 ? outTimeUs / 1e6 : 0,
+      done: value === 'end'
+    });
+    block = {};
+  };
+}
+
+// Add percent complete and ETA when the expected output duration is known
+export function withEstimates(progress, expectedDurationSeconds) {
+  if (!(expectedDurationSeconds > 0)) return progress;
+  const fraction = Math.min(1, progress.outTimeSeconds / expectedDurationSeconds);
+  const remaining = Math.max(0, expectedDurationSeconds - progress.outTimeSeconds);
+  return {
+    ...progress,
+    percent: Math.round(fraction * 1000) / 10,
+    etaSeconds: progress.speed > 0 ? Math.round(remaining / progress.speed) : null
+  };
+}
+
+export class RenderJobs {
+  constructor({ ttlMs = FINISHED_JOB_TTL_MS } = {}) {
+    this.jobs = new Map();
+    this.ttlMs = ttlMs;
+    this.sweepTimer = setInterval(() => this.sweep(), Math.min(ttlMs, 60_000));
+    if (typeof this.sweepTimer.unref === 'function') this.sweepTimer.unref();
+  }
+
+  create({ owner, operation }) {
+    const job = {
+      id: randomUUID(),
+      owner,
+      operation,
+      status: 'queued',
+      progress: null,
+      result: null,
+      error: null,
+      errorCode: null,
+      createdAt: Date.now(),
+      finishedAt: null,
+      listeners: new Set()
+    };
+    this.jobs.set(job.id, job);
+    return job;
+  }
+
+  // Jobs are only visible to the requester that submitted them
+  get(id, owner) {
+    const job = this.jobs.get(id);
+    return job && job.owner === owner ? job : null;
+  }
+
+  emit(job, event, data) {
+    for (const listener of job.listeners) listener(event, data);
+  }
+
+  start(job) {
+    job.status = 'running';
+    this.emit(job, 'status', { status: job.status });
+  }
+
+  progress(job, progress) {
+    job.progress = progress;
+    this.emit(job, 'progress', progress);
+  }
+
+  complete(job, result) {
+    job.status = 'done';
+    job.result = result;
+    job.finishedAt = Date.now();
+    this.emit(job, 'done', result);
+    job.listeners.clear();
+  }
+
+  fail(job, error) {
+    job.status = 'failed';
+    job.error = error.message || String(error);
+    job.errorCode = error.code || null;
+    job.finishedAt = Date.now();
+    this.emit(job, 'failed', { error: job.error, code: error.code });
+    job.listeners.clear();
+  }
+
+  // Replays the current state to the listener, then streams updates until the job ends.
+  // Returns an unsubscribe function.
+  subscribe(job, listener) {
+    listener('status', { status: job.status });
+    if (job.progress) listener('progress', job.progress);
+    if (job.status === 'done') {
+      listener('done', job.result);
+      return () => {};
+    }
+    if (job.status === 'failed') {
+      listener('failed', { error: job.error, code: job.errorCode || undefined });
+      return () => {};
+    }
+    job.listeners.add(listener);
+    return () => job.listeners.delete(listener);
+  }
+
+  describe(job) {
+    return {
+      jobId: job.id,
+      operation: job.operation,
+      status: job.status,
+      progress: job.progress,
+      result: job.result,
+      error: job.error,
+      code: job.errorCode
+    };
+  }
+
+  sweep() {
+    const cutoff = Date.now() - this.ttlMs;
+    for (const [id, job] of this.jobs) {
+      if (job.finishedAt && job.finishedAt < cutoff) this.jobs.delete(id);
+    }
+  }
+}
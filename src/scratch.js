@@ -0,0 +1,219 @@
+// Scratch space for FFmpeg intermediates (segments, chunks, subtitle documents, attached audio).
+// Every job works in its own directory, removed as a whole when the job releases it, so early
+// returns cannot leak single files. Small jobs are placed on tmpfs when one is configured.
+// Bytes held by live jobs (their reservation, or their measured size once larger) count
+// against a global quota that media requests are admitted against, and directories left
+// behind by exited processes are swept at startup and periodically.
+import { randomBytes } from 'crypto';
+import { promises as fs } from 'fs';
+import os from 'os';
+import path from 'path';
+
+// `${pid}-${label}-${random}`: the pid tells the sweeper whether the owner is still running
+const DIR_NAME_PATTERN = /^(\d+)-[a-z0-9_-]+-[0-9a-f]{8}$/;
+const MAX_RETRY_AFTER_SECONDS = 300;
+
+export class ScratchFullError extends Error {
+  constructor(retryAfterSeconds) {
+    super('Server is out of scratch space for video processing, please retry shortly');
+    this.name = 'ScratchFullError';
+    this.code = 'scratch_full';
+    this.retryAfterSeconds = Math.min(MAX_RETRY_AFTER_SECONDS, Math.max(1, Math.ceil(retryAfterSeconds)));
+  }
+}
+
+export function processIsAlive(pid) {
+  try {
+    process.kill(pid, 0);
+    return true;
+  } catch (error) {
+    // EPERM: the process exists but belongs to another user
+    return error.code === 'EPERM';
+  }
+}
+
+// Total size of the files under a directory (0 once it is gone)
+async function directorySize(dirPath) {
+  let entries;
+  try {
+    entries = await fs.readdir(dirPath, { withFileTypes: true });
+  } catch {
+    return 0;
+  }
+  let total = 0;
+  for (const entry of entries) {
+    const entryPath = path.join(dirPath, entry.name);
+    if (entry.isDirectory()) {
+      total += await directorySize(entryPath);
+    } else {
+      total += await fs.stat(entryPath).then((stat) => stat.size, () => 0);
+    }
+  }
+  return total;
+}
+
+// One job's directory; release() removes it and everything in it (idempotent)
+class ScratchDir {
+  constructor(arena, name, dirPath) {
+    this.arena = arena;
+    this.name = name;
+    this.path = dirPath;
+  }
+
+  file(name) {
+    return path.join(this.path, name);
+  }
+
+  release() {
+    return this.arena.release(this);
+  }
+}
+
+export class ScratchArena {
+  constructor({
+    dir,
+    tmpfsDir = null,
+    tmpfsMaxBytes = 256 * 1024 * 1024,
+    maxBytes = 20 * 1024 * 1024 * 1024,
+    staleMs = 24 * 60 * 60 * 1000,
+    pid = process.pid,
+    isProcessAlive = processIsAlive,
+    now = Date.now
+  } = {}) {
+    if (!dir) throw new Error('ScratchArena requires a directory');
+    this.dir = dir;
+    this.tmpfsDir = tmpfsDir;
+    this.tmpfsMaxBytes = tmpfsMaxBytes;
+    this.maxBytes = maxBytes;
+    this.staleMs = staleMs;
+    this.pid = pid;
+    this.isProcessAlive = isProcessAlive;
+    this.now = now;
+    this.live = new Map(); // dir name -> { path, reserved, measured, tmpfs }
+    this.created = 0;
+    this.swept = 0;
+    this.sweepTimer = null;
+  }
+
+  async init() {
+    await fs.mkdir(this.dir, { recursive: true });
+    if (this.tmpfsDir) {
+      await fs.mkdir(this.tmpfsDir, { recursive: true }).catch((error) => {
+        console.warn(`Scratch tmpfs directory ${this.tmpfsDir} unavailable, using ${this.dir}:`, error.message);
+        this.tmpfsDir = null;
+      });
+    }
+    await this.sweep();
+  }
+
+  // Bytes held by live jobs
+  usedBytes({ tmpfs } = {}) {
+    let total = 0;
+    for (const job of this.live.values()) {
+      if (tmpfs === undefined || job.tmpfs === tmpfs) total += Math.max(job.reserved, job.measured);
+    }
+    return total;
+  }
+
+  isFull() {
+    return this.usedBytes() >= this.maxBytes;
+  }
+
+  // Create a job directory. small places it on tmpfs while the tmpfs share has room for
+  // reserveBytes; the reservation counts against the quota until the job measures larger.
+  async createDir(label, { small = false, reserveBytes = 0 } = {}) {
+    const tmpfs = Boolean(small && this.tmpfsDir && this.usedBytes({ tmpfs: true }) + reserveBytes <= this.tmpfsMaxBytes);
+    const name = `${this.pid}-${String(label).toLowerCase().replace(/[^a-z0-9_-]/g, '_')}-${randomBytes(4).toString('hex')}`;
+    const dirPath = path.join(tmpfs ? this.tmpfsDir : this.dir, name);
+    // Registered before it exists so a concurrent sweep never mistakes it for an orphan
+    this.live.set(name, { path: dirPath, reserved: Math.max(0, reserveBytes), measured: 0, tmpfs });
+    try {
+      await fs.mkdir(dirPath, { recursive: true });
+    } catch (error) {
+      this.live.delete(name);
+      throw error;
+    }
+    this.created++;
+    return new ScratchDir(this, name, dirPath);
+  }
+
+  async release(scratchDir) {
+    if (!this.live.has(scratchDir.name)) return;
+    this.live.delete(scratchDir.name);
+    await fs.rm(scratchDir.path, { recursive: true, force: true }).catch(() => {});
+  }
+
+  // Run fn(dir) in a job directory that is released when it settles
+  async withDir(label, fn, options) {
+    const scratchDir = await this.createDir(label, options);
+    try {
+      return await fn(scratchDir);
+    } finally {
+      await scratchDir.release();
+    }
+  }
+
+  // Measure live jobs, then remove directories no live job owns: those of exited processes,
+  // this process's own from before a restart under the same pid, and unrecognized entries
+  // older than staleMs. Resolves to the number removed.
+  async sweep() {
+    for (const job of this.live.values()) {
+      job.measured = await directorySize(job.path);
+    }
+    let removed = 0;
+    for (const root of [this.dir, this.tmpfsDir].filter(Boolean)) {
+      let names;
+      try {
+        names = await fs.readdir(root);
+      } catch {
+        continue;
+      }
+      for (const name of names) {
+        if (this.live.has(name) || !(await this.isOrphan(root, name))) continue;
+        await fs.rm(path.join(root, name), { recursive: true, force: true }).catch(() => {});
+        removed++;
+      }
+    }
+    this.swept += removed;
+    return removed;
+  }
+
+  async isOrphan(root, name) {
+    const match = DIR_NAME_PATTERN.exec(name);
+    if (match) {
+      const pid = Number(match[1]);
+      return pid === this.pid || !this.isProcessAlive(pid);
+    }
+    const stat = await fs.stat(path.join(root, name)).catch(() => null);
+    return Boolean(stat) && this.now() - stat.mtimeMs > this.staleMs;
+  }
+
+  startSweeper(intervalMs) {
+    this.stopSweeper();
+    this.sweepTimer = setInterval(() => {
+      this.sweep().catch((error) => console.warn('Scratch sweep failed:', error.message));
+    }, intervalMs);
+    this.sweepTimer.unref?.();
+  }
+
+  stopSweeper() {
+    if (this.sweepTimer) clearInterval(this.sweepTimer);
+    this.sweepTimer = null;
+  }
+
+  stats() {
+    return {
+      jobs: this.live.size,
+      usedBytes: this.usedBytes(),
+      tmpfsBytes: this.usedBytes({ tmpfs: true }),
+      maxBytes: this.maxBytes,
+      created: this.created,
+      swept: this.swept
+    };
+  }
+}
+
+// Unconfigured arena under the OS temp directory, used by the processing modules when no
+// arena is passed (the server passes its own). Its root is its own, never the server's
+// SCRATCH_DIR default, so the server's sweeper cannot remove its live directories.
+export const tmpScratch = new ScratchArena({ dir: path.join(os.tmpdir(), 'finalcut-scratch-default') });
@@ -0,0 +1,120 @@
+// Split-process-join encoding of long videos. The source is split at keyframes into
+// segments whose video is filtered and encoded by concurrent FFmpeg processes; the encoded
+// segments are joined losslessly with the concat demuxer. Audio goes through its filter
+// chain in a single pass (it is cheap, and audio filters may carry state across the whole
+// stream) and is muxed with the joined video.
+import ffmpeg from 'fluent-ffmpeg';
+import { promises as fs } from 'fs';
+import path from 'path';
+import { probeKeyframes, startTimeOf } from './smartCut.js';
+import { hasAudioStream, durationOf } from './probeCache.js';
+import { tmpScratch } from './scratch.js';
+
+const EPSILON = 0.001;
+
+// Segment boundaries at keyframes, each segment at least segmentSeconds long (the last may
+// be longer). Without usable keyframes the whole video is one segment.
+export function planSegments(keyframes, duration, segmentSeconds) {
+  const sorted = [...new Set(keyframes)].filter((t) => t > EPSILON && t < duration - EPSILON).sort((a, b) => a - b);
+  const segments = [];
+  let start = 0;
+  for (const keyframe of sorted) {
+    if (keyframe - start >= segmentSeconds - EPSILON && duration - keyframe >= segmentSeconds / 2) {
+      segments.push({ start, end: keyframe });
+      start = keyframe;
+    }
+  }
+  segments.push({ start, end: duration });
+  return segments;
+}
+
+// Run task(item) for every item with at most limit in flight. Every task settles before
+// this does; rejects with the first failure.
+export async function runWithConcurrency(items, limit, task) {
+  let next = 0;
+  let failure = null;
+  const worker = async () => {
+    while (next < items.length && !failure) {
+      const index = next++;
+      try {
+        await task(items[index], index);
+      } catch (error) {
+        failure = failure || error;
+      }
+    }
+  };
+  await Promise.all(Array.from({ length: Math.max(1, Math.min(limit, items.length)) }, worker));
+  if (failure) throw failure;
+}
+
+const seconds = (value) => value.toFixed(6);
+
+// FFmpeg command encoding one segment of the video into MPEG-TS. Segments start on
+// keyframes, so input seeking is exact and no frame is decoded twice. The segment is bounded
+// on the input side: filters that retime the video (speed_video's setpts) change its output
+// length, which an output -t would cut short.
+export function segmentCommand({ inputPath, segment, videoFilters, videoEncodeOptions, outputPath }) {
+  return ffmpeg(inputPath)
+    .seekInput(seconds(segment.start))
+    .inputOptions(['-t', seconds(segment.end - segment.start)])
+    .noAudio()
+    .videoFilters(videoFilters.join(','))
+    .outputOptions(['-map', '0:v:0', '-c:v', 'libx264', ...videoEncodeOptions])
+    .format('mpegts')
+    .output(outputPath);
+}
+
+// Encode inputPath through videoFilters/audioFilters into an MP4 at outputPath.
+// runFfmpeg(command) runs a fluent-ffmpeg command to completion (under the job scheduler);
+// parallelism bounds how many segment encodes this render queues at once.
+export async function segmentedEncode({
+  inputPath, outputPath, metadata, videoFilters, audioFilters = [], videoEncodeOptions,
+  runFfmpeg, parallelism, segmentSeconds, findKeyframes = probeKeyframes, scratch = tmpScratch
+}) {
+  const duration = durationOf(metadata);
+  if (!duration) throw new Error('Cannot split a video of unknown duration');
+
+  // Keyframe times count from the start time, like the -ss each segment seeks with
+  const keyframes = await findKeyframes(inputPath, [[0, duration]], { startTime: startTimeOf(metadata) });
+  const segments = planSegments(keyframes, duration, segmentSeconds);
+  // The segments add up to about the size of the output, estimated as the input's
+  const scratchDir = await scratch.createDir('segmented', { reserveBytes: Number(metadata.format?.size) || 0 });
+  const workDir = scratchDir.path;
+  try {
+    const segmentPaths = segments.map((_, i) => path.join(workDir, `segment-${i}.ts`));
+    const jobs = [];
+
+    // Matroska holds any source audio codec when the chain is empty and audio is copied
+    const audioPath = path.join(workDir, 'audio.mka');
+    const hasAudio = hasAudioStream(metadata);
+    if (hasAudio) {
+      const command = ffmpeg(inputPath).noVideo().outputOptions(['-map', '0:a:0']);
+      if (audioFilters.length > 0) command.audioFilters(audioFilters.join(',')).audioCodec('aac').audioBitrate('192k');
+      else command.audioCodec('copy');
+      jobs.push(runFfmpeg(command.output(audioPath)));
+    }
+
+    jobs.push(runWithConcurrency(segments, parallelism, (segment, i) => runFfmpeg(
+      segmentCommand({ inputPath, segment, videoFilters, videoEncodeOptions, outputPath: segmentPaths[i] })
+    )));
+
+    // Let every job settle before the work dir is removed, even if one of them failed
+    const failed = (await Promise.allSettled(jobs)).find((result) => result.status === 'rejected');
+    if (failed) throw failed.reason;
+
+    const listPath = path.join(workDir, 'segments.txt');
+    await fs.writeFile(listPath, segmentPaths.map((p) => `file '${p}'`).join('\n'));
+
+    const mux = ffmpeg()
+      .input(listPath)
+      .inputOptions(['-f', 'concat', '-safe', '0']);
+    const maps = ['-map', '0:v:0'];
+    if (hasAudio) {
+      mux.input(audioPath);
+      maps.push('-map', '1:a:0');
+    }
+    await runFfmpeg(mux.outputOptions([...maps, '-c', 'copy', '-movflags', '+faststart']).output(outputPath));
+  } finally {
+    await scratchDir.release();
+  }
+}
@@ -0,0 +1,135 @@
+// Server-Timing breakdown of a media request, shared by the server (recording) and the
+// client (reading the header and showing it next to the chat message).
+// A phase may run several times and concurrently (parallel segment encodes, say); its
+// duration is the wall time during which at least one run was active.
+
+export const SERVER_TIMING_PHASES = {
+  ingest: 'Upload received',
+  spool: 'Scratch files written',
+  probe: 'Media probed',
+  queue: 'Waiting for FFmpeg',
+  encode: 'FFmpeg running',
+  egress: 'Response sent'
+};
+
+// FFmpeg's realtime factor from a stats line ("... speed=2.5x") or -progress output ("speed=2.5x")
+export function parseFfmpegSpeed(line) {
+  const match = /speed=\s*([\d.]+)x/.exec(line);
+  const speed = match ? Number(match[1]) : NaN;
+  return speed > 0 ? speed : null;
+}
+
+export class ServerTiming {
+  constructor({ now = () => performance.now() } = {}) {
+    this.now = now;
+    this.phases = new Map(); // name -> { total, active, since }
+    this.speed = null;
+    this.speedSeconds = 0;
+  }
+
+  // Start a run of a phase; returns end(), which is idempotent
+  phase(name) {
+    let state = this.phases.get(name);
+    if (!state) {
+      state = { total: 0, active: 0, since: 0 };
+      this.phases.set(name, state);
+    }
+    if (state.active++ === 0) state.since = this.now();
+    let ended = false;
+    return () => {
+      if (ended) return;
+      ended = true;
+      if (--state.active === 0) state.total += this.now() - state.since;
+    };
+  }
+
+  async time(name, fn) {
+    const end = this.phase(name);
+    try {
+      return await fn();
+    } finally {
+      end();
+    }
+  }
+
+  // The speed of the longest FFmpeg process of the request stands for the request
+  recordSpeed(processSeconds, speed) {
+    if (speed && processSeconds >= this.speedSeconds) {
+      this.speed = speed;
+      this.speedSeconds = processSeconds;
+    }
+  }
+
+  // Milliseconds per finished phase; phases still running are left out
+  durations() {
+    const durations = {};
+    for (const [name, state] of this.phases) {
+      if (state.active === 0) durations[name] = state.total;
+    }
+    return durations;
+  }
+
+  header() {
+    const entries = Object.entries(this.durations()).map(([name, ms]) => `${name};dur=${ms.toFixed(1)}`);
+    if (this.speed) entries.push(`speed;desc="${this.speed}x"`);
+    return entries.join(', ');
+  }
+}
+
+// Attach timing to a Node response. A response with a known length has finished its work by
+// the time its headers go out, so its Server-Timing header carries the whole breakdown. A
+// streamed (chunked) one is still encoding then, and browsers and proxies drop trailers, so
+// it gets no header; onComplete(header) receives its full breakdown, egress included, as it
+// ends, for the server to deliver some other way.
+export function sendServerTiming(req, res, timing, { onComplete } = {}) {
+  let endEgress = null;
+  let streamed = false;
+  const { writeHead, end } = res;
+  res.writeHead = function (statusCode, ...rest) {
+    if (!res.headersSent && !endEgress) {
+      streamed = res.useChunkedEncodingByDefault && req.method !== 'HEAD' && !res.hasHeader('Content-Length')
+        && statusCode !== 204 && statusCode !== 304;
+      if (!streamed) res.setHeader('Server-Timing', timing.header());
+      endEgress = timing.phase('egress');
+    }
+    return writeHead.call(this, statusCode, ...rest);
+  };
+  res.end = function (...args) {
+    if (endEgress) {
+      endEgress();
+      if (streamed && onComplete) {
+        streamed = false;
+        onComplete(timing.header());
+      }
+    }
+    return end.apply(this, args);
+  };
+  return () => endEgress?.();
+}
+
+// [{ name, dur, desc }] from a Server-Timing header value
+export function parseServerTiming(header) {
+  if (typeof header !== 'string' || !header.trim()) return [];
+  return header.split(',').map((entry) => {
+    const [name, ...params] = entry.split(';').map((part) => part.trim());
+    const metric = { name };
+    for (const param of params) {
+      const [key, rawValue = ''] = param.split('=');
+      const value = rawValue.trim().replace(/^"(.*)"$/, '$1');
+      if (key.trim() === 'dur') metric.dur = Number(value);
+      if (key.trim() === 'desc') metric.desc = value;
+    }
+    return metric;
+  }).filter((metric) => metric.name);
+}
+
+const formatMilliseconds = (ms) => (ms >= 1000 ? `${(ms / 1000).toFixed(1)} s` : `${Math.round(ms)} ms`);
+
+// "ingest 1.2 s · probe 40 ms · encode 8.3 s · speed 2.4x · total 9.9 s", in phase order
+export function formatServerTiming(metrics) {
+  const order = [...Object.keys(SERVER_TIMING_PHASES), 'speed', 'total'];
+  return [...metrics]
+    .sort((a, b) => (order.indexOf(a.name) >>> 0) - (order.indexOf(b.name) >>> 0))
+    .map((metric) => (Number.isFinite(metric.dur) ? `${metric.name} ${formatMilliseconds(metric.dur)}` : `${metric.name} ${metric.desc || ''}`.trim()))
+    .join(' · ');
+}
@@ -0,0 +1,226 @@
+// Frame-accurate trimming without re-encoding the whole range ("smart cut").
+// Only the partial GOPs before the first keyframe and after the last keyframe inside the
+// range are re-encoded; the keyframe-aligned middle is stream-copied. Audio is re-encoded
+// separately (it is cheap) and muxed with the concatenated video.
+// MP4 stores a single set of H.264 parameter sets (SPS/PPS), so the splice is only kept when
+// the edges came out with the source's; otherwise the range is re-encoded in full.
+import ffmpeg from 'fluent-ffmpeg';
+import { execFile } from 'child_process';
+import { promises as fs } from 'fs';
+import path from 'path';
+import { tmpScratch } from './scratch.js';
+
+const FFPROBE_PATH = process.env.FFPROBE_PATH || 'ffprobe';
+const EPSILON = 0.001;
+// How far around each cut point keyframes are looked for before scanning the whole range
+const KEYFRAME_SEARCH_WINDOW_SECONDS = 30;
+
+// Split [start, end) into re-encoded edges and a stream-copied, keyframe-aligned middle.
+// keyframes are presentation times in seconds; duration is the source length.
+export function planSmartCut(keyframes, start, end, duration = Infinity) {
+  const sorted = [...keyframes].sort((a, b) => a - b);
+  const firstKey = sorted.find((t) => t >= start - EPSILON && t < end - EPSILON);
+  if (firstKey === undefined) return [{ start, end, copy: false }];
+
+  // Cutting at the end of the source needs no tail re-encode
+  const toEnd = end >= duration - EPSILON;
+  const lastKey = toEnd ? end : [...sorted].reverse().find((t) => t <= end + EPSILON && t >= firstKey);
+
+  const segments = [];
+  if (firstKey - start > EPSILON) segments.push({ start, end: firstKey, copy: false });
+  if (lastKey - firstKey > EPSILON) segments.push({ start: firstKey, end: lastKey, copy: true });
+  if (end - lastKey > EPSILON) segments.push({ start: lastKey, end, copy: false });
+  return segments;
+}
+
+// Time of the first timestamp in the file (non-zero in MPEG-TS and many camera files).
+// -ss counts from it; packet pts_time and -read_intervals do not.
+export function startTimeOf(metadata) {
+  return Number(metadata?.format?.start_time) || 0;
+}
+
+// Video keyframe times within the given [from, to] intervals, read from packet flags only
+// (no decoding). Intervals and the returned times are relative to startTime, the file's
+// start_time, like -ss.
+export function probeKeyframes(inputPath, intervals, { startTime = 0 } = {}) {
+  const readIntervals = intervals
+    .map(([from, to]) => `${(Math.max(0, from) + startTime).toFixed(3)}%${(to + startTime).toFixed(3)}`)
+    .join(',');
+  return new Promise((resolve, reject) => {
+    execFile(FFPROBE_PATH, [
+      '-v', 'error',
+      '-select_streams', 'v:0',
+      '-read_intervals', readIntervals,
+      '-show_entries', 'packet=pts_time,flags',
+      '-of', 'csv=p=0',
+      inputPath
+    ], { maxBuffer: 64 * 1024 * 1024 }, (err, stdout) => {
+      if (err) return reject(err);
+      const keyframes = new Set();
+      for (const line of stdout.split('\n')) {
+        const [ptsTime, flags] = line.trim().split(',');
+        if (flags && flags.includes('K') && ptsTime !== 'N/A') keyframes.add(Number(ptsTime));
+      }
+      resolve([...keyframes].filter(Number.isFinite).map((t) => t - startTime));
+    });
+  });
+}
+
+async function findKeyframes(inputPath, start, end, options) {
+  const window = KEYFRAME_SEARCH_WINDOW_SECONDS;
+  if (end - start <= 2 * window) return probeKeyframes(inputPath, [[start, end]], options);
+
+  const keyframes = await probeKeyframes(inputPath, [[start, start + window], [end - window, end]], options);
+  const hasFirst = keyframes.some((t) => t >= start - EPSILON && t <= start + window);
+  const hasLast = keyframes.some((t) => t >= end - window && t <= end + EPSILON);
+  // Very long GOPs: fall back to scanning the whole range
+  return hasFirst && hasLast ? keyframes : probeKeyframes(inputPath, [[start, end]], options);
+}
+
+// MD5 of the first video stream's codec extradata (its SPS/PPS for H.264), or null without any
+export function probeExtradataHash(inputPath) {
+  return new Promise((resolve, reject) => {
+    execFile(FFPROBE_PATH, [
+      '-v', 'error',
+      '-select_streams', 'v:0',
+      '-show_data_hash', 'MD5',
+      '-show_entries', 'stream=extradata_size,extradata_hash',
+      '-of', 'json',
+      inputPath
+    ], (err, stdout) => {
+      if (err) return reject(err);
+      try {
+        const stream = JSON.parse(stdout).streams?.[0];
+        resolve(stream?.extradata_size > 0 && stream.extradata_hash ? stream.extradata_hash : null);
+      } catch (error) {
+        reject(error);
+      }
+    });
+  });
+}
+
+// Whether every segment carries the same, known parameter sets, so that they can be joined
+// under one avcC
+export async function segmentsShareParameterSets(segmentPaths, probeHash = probeExtradataHash) {
+  const hashes = await Promise.all(segmentPaths.map((segmentPath) => probeHash(segmentPath)));
+  return hashes.every((hash) => hash && hash === hashes[0]);
+}
+
+const X264_PROFILES = {
+  'Constrained Baseline': 'baseline',
+  Baseline: 'baseline',
+  Main: 'main',
+  High: 'high',
+  'High 10': 'high10',
+  'High 4:2:2': 'high422',
+  'High 4:4:4 Predictive': 'high444'
+};
+
+// x264 options that make re-encoded edges match the source's profile, level and pixel format
+export function edgeEncodeOptions(videoStream) {
+  const options = ['-pix_fmt', videoStream.pix_fmt || 'yuv420p'];
+  const profile = X264_PROFILES[videoStream.profile];
+  if (profile) options.push('-profile:v', profile);
+  if (videoStream.level > 0) options.push('-level:v', (videoStream.level / 10).toFixed(1));
+  return options;
+}
+
+function probe(inputPath) {
+  return new Promise((resolve, reject) => {
+    ffmpeg.ffprobe(inputPath, (err, metadata) => (err ? reject(err) : resolve(metadata)));
+  });
+}
+
+const seconds = (value) => value.toFixed(6);
+
+// Trim inputPath to [start, end) into an MP4 at outputPath.
+// runFfmpeg(command) runs a fluent-ffmpeg command to completion (under the job scheduler);
+// videoEncodeOptions are the x264 output options used for re-encoded edges.
+export async function smartCut({ inputPath, start, end, outputPath, runFfmpeg, videoEncodeOptions = ['-preset', 'veryfast', '-crf', '18'], metadata, scratch = tmpScratch }) {
+  if (!Number.isFinite(start) || !Number.isFinite(end) || start < 0 || end <= start) {
+    throw new Error('Trim range must satisfy 0 <= start < end');
+  }
+
+  metadata = metadata || await probe(inputPath);
+  const duration = Number(metadata.format?.duration) || Infinity;
+  if (start >= duration - EPSILON) {
+    const error = new Error(`Trim start ${start}s is past the end of the ${duration.toFixed(3)}s video`);
+    error.code = 'trim_out_of_range';
+    throw error;
+  }
+  end = Math.min(end, duration);
+  const videoStream = metadata.streams?.find((s) => s.codec_type === 'video');
+  const hasAudio = metadata.streams?.some((s) => s.codec_type === 'audio');
+
+  // Frame-accurate in any case, just slower than splicing
+  const reencodeRange = () => runFfmpeg(
+    ffmpeg(inputPath)
+      .seekInput(seconds(start))
+      .duration(seconds(end - start))
+      .outputOptions(['-map', '0:v?', '-map', '0:a?', '-c:v', 'libx264', ...videoEncodeOptions, '-c:a', 'aac', '-movflags', '+faststart'])
+      .output(outputPath)
+  );
+
+  // Only H.264 edges can be re-encoded to match the copied middle
+  if (!videoStream || videoStream.codec_name !== 'h264') return reencodeRange();
+
+  const keyframes = await findKeyframes(inputPath, start, end, { startTime: startTimeOf(metadata) });
+  const segments = planSmartCut(keyframes, start, end, duration);
+  const scratchDir = await scratch.createDir('smartcut', { reserveBytes: Number(metadata.format?.size) || 0 });
+  const workDir = scratchDir.path;
+  try {
+    // MPEG-TS segments carry SPS/PPS in-band, so re-encoded edges and the copied middle
+    // can be joined with the concat demuxer without re-encoding
+    const segmentPaths = segments.map((_, i) => path.join(workDir, `segment-${i}.ts`));
+    const jobs = segments.map((segment, i) => {
+      const command = ffmpeg(inputPath)
+        .seekInput(seconds(segment.start))
+        .duration(seconds(segment.end - segment.start))
+        .noAudio();
+      if (segment.copy) {
+        command.outputOptions(['-map', '0:v:0', '-c:v', 'copy', '-bsf:v', 'h264_mp4toannexb']);
+      } else {
+        command.outputOptions(['-map', '0:v:0', '-c:v', 'libx264', ...videoEncodeOptions, ...edgeEncodeOptions(videoStream)]);
+      }
+      return runFfmpeg(command.format('mpegts').output(segmentPaths[i]));
+    });
+
+    const audioPath = path.join(workDir, 'audio.m4a');
+    if (hasAudio) {
+      jobs.push(runFfmpeg(
+        ffmpeg(inputPath)
+          .seekInput(seconds(start))
+          .duration(seconds(end - start))
+          .noVideo()
+          .outputOptions(['-map', '0:a:0', '-c:a', 'aac', '-b:a', '192k'])
+          .output(audioPath)
+      ));
+    }
+    // Let every job settle before the work dir is removed, even if one of them failed
+    const failed = (await Promise.allSettled(jobs)).find((result) => result.status === 'rejected');
+    if (failed) throw failed.reason;
+
+    // x264 edges rarely share a non-x264 source's SPS/PPS even at the same profile and level,
+    // and players decode frames against the wrong ones when they differ
+    const spliced = segments.some((segment) => segment.copy) && segments.some((segment) => !segment.copy);
+    if (spliced && !(await segmentsShareParameterSets(segmentPaths))) {
+      await reencodeRange();
+      return;
+    }
+
+    const listPath = path.join(workDir, 'segments.txt');
+    await fs.writeFile(listPath, segmentPaths.map((p) => `file '${p}'`).join('\n'));
+
+    const mux = ffmpeg()
+      .input(listPath)
+      .inputOptions(['-f', 'concat', '-safe', '0']);
+    const maps = ['-map', '0:v:0'];
+    if (hasAudio) {
+      mux.input(audioPath);
+      maps.push('-map', '1:a:0');
+    }
+    await runFfmpeg(mux.outputOptions([...maps, '-c', 'copy', '-movflags', '+faststart']).output(outputPath));
+  } finally {
+    await scratchDir.release();
+  }
+}
@@ -0,0 +1,70 @@
+// Soft subtitles: caption tracks muxed into the container next to stream-copied video and
+// audio, so captioning is a remux instead of an encode. MP4 stores the tracks as mov_text;
+// the player shows WebVTT versions of the same cues through <track> elements.
+import ffmpeg from 'fluent-ffmpeg';
+import { promises as fs } from 'fs';
+import path from 'path';
+import { parseSrt, formatSrt } from './srt.js';
+import { tmpScratch } from './scratch.js';
+
+// MP4 language tags are ISO 639-2 (bibliographic) codes
+const ISO_639_2 = {
+  ar: 'ara', de: 'ger', en: 'eng', es: 'spa', fr: 'fre', hi: 'hin', it: 'ita', ja: 'jpn',
+  ko: 'kor', nl: 'dut', pl: 'pol', pt: 'por', ru: 'rus', sv: 'swe', tr: 'tur', uk: 'ukr',
+  vi: 'vie', zh: 'chi'
+};
+
+// "pt-BR" -> "por"; "und" for unknown or auto-detected languages
+export function mp4LanguageCode(language) {
+  const base = String(language || '').toLowerCase().split('-')[0];
+  if (ISO_639_2[base]) return ISO_639_2[base];
+  return /^[a-z]{3}$/.test(base) ? base : 'und';
+}
+
+// Subtitle tracks [{ srt, language }] from mux_subtitles args: srtContent (language) and an
+// optional translatedSrtContent (translatedLanguage). Returns { tracks } or { error }.
+export function subtitleTracksFromArgs({ srtContent, language, translatedSrtContent, translatedLanguage } = {}) {
+  const primary = typeof srtContent === 'string' ? parseSrt(srtContent) : [];
+  if (primary.length === 0) return { error: 'srtContent with at least one subtitle cue is required for mux_subtitles' };
+  const tracks = [{ srt: formatSrt(primary), language: language || 'und' }];
+  const translated = typeof translatedSrtContent === 'string' ? parseSrt(translatedSrtContent) : [];
+  if (translated.length > 0) tracks.push({ srt: formatSrt(translated), language: translatedLanguage || 'und' });
+  return { tracks };
+}
+
+// Output options copying the video and audio of input 0 and adding subtitle inputs 1..n as
+// mov_text tracks, the first one shown by default
+export function softSubtitleOutputOptions(tracks) {
+  return [
+    '-map', '0:v?', '-map', '0:a?',
+    ...tracks.flatMap((_, i) => ['-map', `${i + 1}:s:0`]),
+    '-c:v', 'copy', '-c:a', 'copy', '-c:s', 'mov_text',
+    ...tracks.flatMap((track, i) => [
+      `-metadata:s:s:${i}`, `language=${mp4LanguageCode(track.language)}`,
+      `-metadata:s:s:${i}`, `handler_name=${track.language}`,
+      `-disposition:s:${i}`, i === 0 ? 'default' : '0'
+    ]),
+    '-movflags', '+faststart'
+  ];
+}
+
+// Mux the tracks into an MP4 at outputPath. runFfmpeg(command) runs a fluent-ffmpeg command
+// to completion (under the job scheduler).
+export async function muxSoftSubtitles({ inputPath, outputPath, tracks, runFfmpeg, scratch = tmpScratch }) {
+  const scratchDir = await scratch.createDir('soft-subtitles', { small: true });
+  const workDir = scratchDir.path;
+  try {
+    const command = ffmpeg(inputPath);
+    for (const [i, track] of tracks.entries()) {
+      const srtPath = path.join(workDir, `track-${i}.srt`);
+      await fs.writeFile(srtPath, track.srt, 'utf8');
+      command.input(srtPath);
+    }
+    await runFfmpeg(command
+      .outputOptions(softSubtitleOutputOptions(tracks))
+      .format('mp4')
+      .output(outputPath));
+  } finally {
+    await scratchDir.release();
+  }
+}
@@ -0,0 +1,54 @@
+// SRT subtitle parsing and formatting. Cues are { start, end, text } with times in seconds.
+
+const TIMING = /(\d{1,2}):(\d{2}):(\d{2})[,.](\d{1,3})\s*-->\s*(\d{1,2}):(\d{2}):(\d{2})[,.](\d{1,3})/;
+
+const toSeconds = (h, m, s, ms) => Number(h) * 3600 + Number(m) * 60 + Number(s) + Number(ms.padEnd(3, '0')) / 1000;
+
+// Parse SRT text, tolerating model output wrapped in code fences or with missing numbers
+export function parseSrt(text) {
+  const cues = [];
+  const blocks = String(text || '').replace(/\r\n/g, '\n').replace(/^```\w*\n?|```\s*$/gm, '').split(/\n\s*\n/);
+  for (const block of blocks) {
+    const lines = block.split('\n').map((line) => line.trim()).filter(Boolean);
+    const timingIndex = lines.findIndex((line) => TIMING.test(line));
+    if (timingIndex === -1) continue;
+    const [, h1, m1, s1, ms1, h2, m2, s2, ms2] = lines[timingIndex].match(TIMING);
+    const cueText = lines.slice(timingIndex + 1).join('\n');
+    if (!cueText) continue;
+    cues.push({ start: toSeconds(h1, m1, s1, ms1), end: toSeconds(h2, m2, s2, ms2), text: cueText });
+  }
+  return cues;
+}
+
+// 3723.5 -> "01:02:03,500"
+export function formatTimestamp(seconds) {
+  const totalMs = Math.max(0, Math.round(seconds * 1000));
+  const pad = (value, width = 2) => String(value).padStart(width, '0');
+  return `${pad(Math.floor(totalMs / 3600000))}:${pad(Math.floor(totalMs / 60000) % 60)}:` +
+    `${pad(Math.floor(totalMs / 1000) % 60)},${pad(totalMs % 1000, 3)}`;
+}
+
+// Cues as SRT, numbered from 1
+export function formatSrt(cues) {
+  return cues
+    .map((cue, i) => `${i + 1}\n${formatTimestamp(cue.start)} --> ${formatTimestamp(cue.end)}\n${cue.text}`)
+    .join('\n\n');
+}
+
+// Shift cues of a chunk to its position in the whole media, keeping them inside the chunk
+export function offsetCues(cues, offset, maxDuration = Infinity) {
+  return cues
+    .filter((cue) => cue.start < maxDuration)
+    .map((cue) => ({
+      start: cue.start + offset,
+      end: Math.min(Math.max(cue.end, cue.start), maxDuration) + offset,
+      text: cue.text
+    }));
+}
+
+// Convert SRT subtitle content to WebVTT format
+export function srtToVtt(srt) {
+  return 'WEBVTT\n\n' + srt
+    .replace(/\r\n/g, '\n')
+    .replace(/(\d{2}:\d{2}:\d{2}),(\d{3})/g, '$1.$2');
+}
@@ -19,6 +19,24 @@ describe('VideoPreview Component', () => {
     expect(screen.getByText('Test Video')).toBeInTheDocument();
   });
 
+  it('renders subtitle tracks on the video', () => {
+    const { container } = render(
+      <VideoPreview
+        videoUrl="test-video.mp4"
+        textTracks={[
+          { src: 'blob:en', srcLang: 'en', label: 'en', default: true },
+          { src: 'blob:es', srcLang: 'es', label: 'es' }
+        ]}
+      />
+    );
+    const tracks = container.querySelectorAll('video track');
+    expect(tracks).toHaveLength(2);
+    expect(tracks[0]).toHaveAttribute('kind', 'subtitles');
+    expect(tracks[0]).toHaveAttribute('srclang', 'en');
+    expect(tracks[0]).toHaveAttribute('default');
+    expect(tracks[1]).not.toHaveAttribute('default');
+  });
+
   it('renders default title when not provided', () => {
     render(<VideoPreview videoUrl="test-video.mp4" />);
     expect(screen.getByText('Video Preview')).toBeInTheDocument();
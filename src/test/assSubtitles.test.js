@@ -0,0 +1,42 @@
+import { describe, it, expect } from 'vitest';
+import { assTimestamp, escapeAssText, buildAssDocument, assFilter, overlayFormat } from '../assSubtitles.js';
+
+describe('assSubtitles', () => {
+  it('formats ASS timestamps in centiseconds', () => {
+    expect(assTimestamp(3723.5)).toBe('1:02:03.50');
+    expect(assTimestamp(0.004)).toBe('0:00:00.00');
+    expect(assTimestamp(59.996)).toBe('0:01:00.00');
+  });
+
+  it('escapes override tags and line breaks in cue text', () => {
+    expect(escapeAssText('a {\\b1} b\nc')).toBe('a \\{\\\\b1\\} b\\Nc');
+  });
+
+  it('puts both tracks in one document with opposite alignments', () => {
+    const doc = buildAssDocument({
+      cues: [{ start: 1, end: 2.5, text: 'Hello' }],
+      translatedCues: [{ start: 1, end: 2.5, text: 'Hola' }],
+      style: 'yellow',
+      position: 'top'
+    });
+    expect(doc).toContain('PlayResY: 288');
+    expect(doc).toContain('Style: Primary,Arial,20,&H0000FFFF,&H0000FFFF,&H00000000,&H00000000,-1,0,0,0,100,100,0,0,1,1,0,8,');
+    expect(doc).toContain('Style: Translated,Arial,18,&H0000FFFF,');
+    expect(doc).toMatch(/Style: Translated,.*,0,2,10,10,10,1/);
+    expect(doc).toContain('Dialogue: 0,0:00:01.00,0:00:02.50,Primary,,0,0,0,,Hello');
+    expect(doc).toContain('Dialogue: 0,0:00:01.00,0:00:02.50,Translated,,0,0,0,,Hola');
+  });
+
+  it('escapes the document path for the ass filter', () => {
+    expect(assFilter("/tmp/it's.ass", ':alpha=1')).toBe("ass='/tmp/it\\'s.ass':alpha=1");
+  });
+
+  it('renders the overlay at the displayed size and frame rate of the video', () => {
+    const metadata = {
+      format: { duration: '12.5' },
+      streams: [{ codec_type: 'video', width: 1920, height: 1080, avg_frame_rate: '30000/1001', side_data_list: [{ rotation: -90 }] }]
+    };
+    expect(overlayFormat(metadata)).toEqual({ width: 1080, height: 1920, fps: 29.97, duration: 12.5 });
+    expect(overlayFormat({ format: { duration: '3' }, streams: [{ codec_type: 'audio' }] })).toBeNull();
+  });
+});
@@ -0,0 +1,142 @@
+import { describe, it, expect, beforeEach, afterEach } from 'vitest';
+import { promises as fs } from 'fs';
+import os from 'os';
+import path from 'path';
+import { Readable } from 'stream';
+import { AssetStore, isValidAssetId, describeAsset } from '../assetStore.js';
+
+describe('AssetStore', () => {
+  let dir;
+  let store;
+
+  beforeEach(async () => {
+    dir = await fs.mkdtemp(path.join(os.tmpdir(), 'finalcut-assets-test-'));
+    store = new AssetStore({ dir, maxBytes: 1024 });
+    await store.init();
+  });
+
+  afterEach(async () => {
+    await fs.rm(dir, { recursive: true, force: true });
+  });
+
+  it('keys uploads by content hash and deduplicates identical content', async () => {
+    const first = await store.ingestBuffer(Buffer.from('same bytes'), { mimeType: 'video/mp4', ext: 'mp4' });
+    const second = await store.ingestStream(Readable.from([Buffer.from('same '), Buffer.from('bytes')]), { mimeType: 'video/mp4', ext: 'mp4' });
+
+    expect(first.id).toMatch(/^[a-f0-9]{64}$/);
+    expect(second.id).toBe(first.id);
+    expect(store.totalBytes).toBe(10);
+    expect(await fs.readFile(first.path, 'utf8')).toBe('same bytes');
+    expect(describeAsset(first)).toEqual({ assetId: first.id, size: 10, mimeType: 'video/mp4' });
+  });
+
+  it('indexes concurrent commits of the same content once', async () => {
+    const held = await store.acquire((await store.ingestBuffer(Buffer.from('abc'), { ext: 'mp4' })).id);
+    const [first, second, third] = await Promise.all([
+      store.ingestBuffer(Buffer.from('same bytes'), { ext: 'mp4' }),
+      store.ingestStream(Readable.from([Buffer.from('same '), Buffer.from('bytes')]), { ext: 'mp4' }),
+      store.ingestBuffer(Buffer.from('abc'), { ext: 'mp4' })
+    ]);
+
+    expect(second).toBe(first);
+    expect(store.totalBytes).toBe(13);
+    // A commit of content already indexed keeps the record callers hold
+    expect(third).toBe(held);
+    expect(held.refs).toBe(1);
+    expect(store.pendingCommits.size).toBe(0);
+    expect(await fs.readdir(store.incomingDir)).toEqual([]);
+  });
+
+  it('rejects streams over the byte limit without storing them', async () => {
+    await expect(
+      store.ingestStream(Readable.from([Buffer.from('12345'), Buffer.from('678')]), { ext: 'mp4', maxBytes: 6 })
+    ).rejects.toMatchObject({ code: 'LIMIT_FILE_SIZE' });
+    expect(store.assets.size).toBe(0);
+    expect(await fs.readdir(store.incomingDir)).toEqual([]);
+  });
+
+  it('resolves a reserved output id once the output is committed', async () => {
+    const reservation = store.reserveOutput({ mimeType: 'video/mp4', ext: 'mp4' });
+    expect(isValidAssetId(reservation.id)).toBe(true);
+
+    const lookup = store.get(reservation.id);
+    await fs.writeFile(reservation.path, 'rendered output');
+    const committed = await reservation.commit();
+
+    const resolved = await lookup;
+    expect(resolved.id).toBe(committed.id);
+    expect(await fs.readFile(resolved.path, 'utf8')).toBe('rendered output');
+  });
+
+  it('resolves an aborted output id to null', async () => {
+    const reservation = store.reserveOutput();
+    const lookup = store.get(reservation.id);
+    await reservation.abort();
+    expect(await lookup).toBeNull();
+  });
+
+  it('rejects malformed and unknown ids', async () => {
+    expect(isValidAssetId('../../etc/passwd')).toBe(false);
+    expect(await store.get('../../etc/passwd')).toBeNull();
+    expect(await store.get('a'.repeat(64))).toBeNull();
+  });
+
+  it('evicts least recently used assets over quota but never acquired ones', async () => {
+    const oldest = await store.ingestBuffer(Buffer.alloc(400, 1), { ext: 'bin' });
+    const pinned = await store.acquire((await store.ingestBuffer(Buffer.alloc(400, 2), { ext: 'bin' })).id);
+    pinned.lastAccessAt = 0;
+    const newest = await store.ingestBuffer(Buffer.alloc(400, 3), { ext: 'bin' });
+
+    expect(await store.get(oldest.id)).toBeNull();
+    expect(await store.get(pinned.id)).not.toBeNull();
+    expect(await store.get(newest.id)).not.toBeNull();
+    expect(store.totalBytes).toBe(800);
+
+    store.release(pinned);
+    expect(pinned.refs).toBe(0);
+  });
+
+  it('keeps an asset over quota on its own through the commit that stores it', async () => {
+    const older = await store.ingestBuffer(Buffer.alloc(400, 1), { ext: 'bin' });
+    const large = await store.ingestBuffer(Buffer.alloc(1500, 2), { ext: 'bin' });
+
+    expect(await store.get(older.id)).toBeNull();
+    expect(await store.get(large.id)).toBe(large);
+    expect(large.refs).toBe(0);
+    expect(store.totalBytes).toBe(1500);
+  });
+
+  it('skips candidates acquired while an eviction is running', async () => {
+    const first = await store.ingestBuffer(Buffer.alloc(400, 1), { ext: 'bin' });
+    const second = await store.ingestBuffer(Buffer.alloc(400, 2), { ext: 'bin' });
+    second.lastAccessAt = first.lastAccessAt + 1;
+    store.onDrop(async () => { await store.acquire(second.id); });
+    store.maxBytes = 100;
+
+    await store.evict();
+
+    expect(await store.get(first.id)).toBeNull();
+    expect(await store.get(second.id)).toBe(second);
+    expect(store.totalBytes).toBe(400);
+  });
+
+  it('accounts for an asset dropped twice only once', async () => {
+    const asset = await store.ingestBuffer(Buffer.from('twice'), { ext: 'bin' });
+    await Promise.all([store.drop(asset), store.drop(asset)]);
+
+    expect(store.assets.size).toBe(0);
+    expect(store.totalBytes).toBe(0);
+  });
+
+  it('rebuilds its index from disk on init', async () => {
+    const asset = await store.ingestBuffer(Buffer.from('persisted'), { mimeType: 'audio/mpeg', ext: 'mp3' });
+
+    const reopened = new AssetStore({ dir, maxBytes: 1024 });
+    await reopened.init();
+    const restored = await reopened.get(asset.id);
+
+    expect(restored.mimeType).toBe('audio/mpeg');
+    expect(restored.size).toBe(9);
+    expect(restored.path).toBe(asset.path);
+  });
+});
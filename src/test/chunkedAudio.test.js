@@ -0,0 +1,38 @@
+import { describe, it, expect } from 'vitest';
+import { planAudioChunks, buildChunkJoinFilter } from '../chunkedAudio.js';
+
+describe('planAudioChunks', () => {
+  it('overlaps each chunk with the next and pre-rolls all but the first', () => {
+    expect(planAudioChunks(300, 100, { preRoll: 2, overlap: 0.05 })).toEqual([
+      { start: 0, renderStart: 0, renderEnd: 100.05, preRoll: 0 },
+      { start: 100, renderStart: 98, renderEnd: 200.05, preRoll: 2 },
+      { start: 200, renderStart: 198, renderEnd: 300, preRoll: 2 }
+    ]);
+  });
+
+  it('spreads uneven durations across evenly sized chunks', () => {
+    const chunks = planAudioChunks(240, 100, { preRoll: 1, overlap: 0 });
+    expect(chunks.map((chunk) => chunk.start)).toEqual([0, 120]);
+    expect(chunks[1].renderEnd).toBe(240);
+  });
+
+  it('tiles the duration exactly without pre-roll or overlap, as reversal needs', () => {
+    const chunks = planAudioChunks(360, 120, { preRoll: 0, overlap: 0 });
+    expect(chunks.map((chunk) => [chunk.renderStart, chunk.renderEnd])).toEqual([[0, 120], [120, 240], [240, 360]]);
+  });
+
+  it('keeps short audio in one chunk', () => {
+    expect(planAudioChunks(30, 100, { preRoll: 2, overlap: 0.05 })).toEqual([
+      { start: 0, renderStart: 0, renderEnd: 30, preRoll: 0 }
+    ]);
+  });
+});
+
+describe('buildChunkJoinFilter', () => {
+  it('crossfades consecutive chunk inputs', () => {
+    expect(buildChunkJoinFilter(3, 0.05, 1)).toBe(
+      '[1:a][2:a]acrossfade=d=0.050000:c1=tri:c2=tri[j1];[j1][3:a]acrossfade=d=0.050000:c1=tri:c2=tri[a]'
+    );
+    expect(buildChunkJoinFilter(1, 0.05, 1)).toBe('[1:a]anull[a]');
+  });
+});
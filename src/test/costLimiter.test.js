@@ -0,0 +1,94 @@
+import { describe, it, expect } from 'vitest';
+import { CostLimiter, CostBudgetError, budgetOwner, operationWeight, estimateEncodeSeconds, durationFromUploadSize } from '../costLimiter.js';
+
+describe('costLimiter', () => {
+  it('weighs video re-encodes over audio filters, remuxes and probes', () => {
+    expect(operationWeight('speed_video')).toBe(1);
+    expect(operationWeight('adjust_volume')).toBe(0.05);
+    expect(operationWeight('get_video_info')).toBe(0);
+    expect(operationWeight('trim_video', { mode: 'fast' })).toBe(0.01);
+    expect(operationWeight('apply_operations', {
+      operations: [{ operation: 'adjust_volume' }, { operation: 'adjust_hue' }]
+    })).toBe(1);
+    expect(operationWeight('export')).toBe(1);
+  });
+
+  it('scales the estimate with duration and resolution', () => {
+    const hd = estimateEncodeSeconds({ duration: 60, width: 1920, height: 1080, operation: 'speed_video' });
+    const uhd = estimateEncodeSeconds({ duration: 60, width: 3840, height: 2160, operation: 'speed_video' });
+    const info = estimateEncodeSeconds({ duration: 5, width: 3840, height: 2160, operation: 'get_video_info' });
+    expect(hd).toBeCloseTo(60.5);
+    expect(uhd).toBeCloseTo(240.5);
+    expect(info).toBe(0.5);
+    expect(durationFromUploadSize(10_000_000)).toBe(10);
+  });
+
+  it('charges estimates and rejects with the time until the budget covers them', () => {
+    let now = 0;
+    const limiter = new CostLimiter({ budgetSeconds: 100, windowSeconds: 100, now: () => now });
+    limiter.admit('user:1', 80);
+    expect(() => limiter.admit('user:1', 30)).toThrow(CostBudgetError);
+    try {
+      limiter.admit('user:1', 30);
+    } catch (error) {
+      expect(error.retryAfterSeconds).toBe(10);
+    }
+    // Budgets are per user, and refill over the window
+    limiter.admit('user:2', 30);
+    now = 10_000;
+    limiter.admit('user:1', 30);
+    expect(limiter.stats()).toMatchObject({ admitted: 3, rejected: 2 });
+  });
+
+  it('settles the estimate against the measured cost', () => {
+    const limiter = new CostLimiter({ budgetSeconds: 100, windowSeconds: 1e9, now: () => 0 });
+    const meter = limiter.admit('user:1', 60);
+    meter.add(10);
+    meter.settle();
+    meter.settle();
+    expect(limiter.balance('user:1')).toBe(90);
+
+    // Work measured after settlement is charged directly
+    meter.add(15);
+    expect(limiter.balance('user:1')).toBe(75);
+
+    const overrun = limiter.admit('user:1', 5);
+    overrun.add(50);
+    overrun.settle();
+    expect(limiter.balance('user:1')).toBe(25);
+  });
+
+  it('keeps a background job\'s estimate reserved after its request has been answered', () => {
+    const limiter = new CostLimiter({ budgetSeconds: 100, windowSeconds: 1e9, now: () => 0 });
+    // A job submission: the response (202) closes right away, the render holds the meter
+    const job = limiter.admit('user:1', 80);
+    const closeResponse = job.hold();
+    const releaseJob = job.hold();
+    closeResponse();
+    expect(limiter.balance('user:1')).toBe(20);
+    expect(() => limiter.admit('user:1', 80)).toThrow(CostBudgetError);
+
+    job.add(30);
+    releaseJob();
+    releaseJob();
+    expect(limiter.balance('user:1')).toBe(70);
+  });
+
+  it('charges sample-mode requests from one IP to one budget, whatever their token', () => {
+    const limiter = new CostLimiter({ budgetSeconds: 100, windowSeconds: 1e9, now: () => 0 });
+    const first = { ip: '203.0.113.7', headers: { 'sample-access-token': 'token-a' } };
+    const second = { ip: '203.0.113.7', headers: { 'sample-access-token': 'token-b' } };
+    limiter.admit(budgetOwner(first), 80);
+    expect(() => limiter.admit(budgetOwner(second), 30)).toThrow(CostBudgetError);
+    expect(budgetOwner({ ip: '198.51.100.1', headers: {} })).not.toBe(budgetOwner(first));
+    expect(budgetOwner({ ip: '203.0.113.7', user: { id: 5 } })).toBe('user:5');
+  });
+
+  it('admits estimates above the whole budget only with a full budget', () => {
+    const limiter = new CostLimiter({ budgetSeconds: 100, windowSeconds: 1e9, now: () => 0 });
+    limiter.admit('user:1', 500).settle();
+    expect(limiter.balance('user:1')).toBe(100);
+    limiter.admit('user:1', 500);
+    expect(() => limiter.admit('user:1', 500)).toThrow(CostBudgetError);
+  });
+});
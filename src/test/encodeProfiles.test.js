@@ -0,0 +1,27 @@
+import { describe, it, expect } from 'vitest';
+import { selectEncodeProfile, x264OutputOptions, DEFAULT_ENCODE_PROFILE } from '../encodeProfiles.js';
+
+describe('encodeProfiles', () => {
+  it('defaults to the draft profile', () => {
+    expect(DEFAULT_ENCODE_PROFILE).toBe('draft');
+    expect(selectEncodeProfile({ args: {} }).name).toBe('draft');
+    expect(selectEncodeProfile().name).toBe('draft');
+  });
+
+  it('prefers the tool arg over the header', () => {
+    expect(selectEncodeProfile({ header: 'balanced' }).name).toBe('balanced');
+    expect(selectEncodeProfile({ args: { encodeProfile: 'final' }, header: 'balanced' }).name).toBe('final');
+  });
+
+  it('rejects unknown profiles', () => {
+    expect(selectEncodeProfile({ header: 'ultra' })).toBeNull();
+    expect(selectEncodeProfile({ args: { encodeProfile: 'toString' } })).toBeNull();
+  });
+
+  it('builds x264 output options', () => {
+    expect(x264OutputOptions(selectEncodeProfile({ header: 'draft' }))).toEqual(
+      ['-preset', 'ultrafast', '-crf', '28', '-tune', 'fastdecode', '-threads', '2']
+    );
+    expect(x264OutputOptions(selectEncodeProfile({ header: 'final' }))).toEqual(['-preset', 'slow', '-crf', '18']);
+  });
+});
@@ -0,0 +1,54 @@
+import { describe, it, expect } from 'vitest';
+import { JobScheduler, SchedulerBusyError } from '../ffmpegScheduler.js';
+
+describe('JobScheduler', () => {
+  it('runs up to its concurrency and queues the rest in order', async () => {
+    const scheduler = new JobScheduler({ concurrency: 2, maxQueue: 2 });
+    const first = await scheduler.acquire();
+    await scheduler.acquire();
+    const started = [];
+    const third = scheduler.acquire().then((release) => { started.push('third'); return release; });
+    scheduler.acquire().then(() => started.push('fourth'));
+
+    expect(scheduler.stats()).toMatchObject({ running: 2, queued: 2 });
+    first();
+    first(); // release is idempotent
+    const releaseThird = await third;
+    expect(started).toEqual(['third']);
+    expect(scheduler.stats()).toMatchObject({ running: 2, queued: 1 });
+
+    releaseThird();
+    await Promise.resolve();
+    expect(started).toEqual(['third', 'fourth']);
+  });
+
+  it('rejects immediately with a retry estimate once the queue is full', async () => {
+    const scheduler = new JobScheduler({ concurrency: 1, maxQueue: 1 });
+    await scheduler.acquire();
+    scheduler.acquire();
+
+    expect(scheduler.isSaturated()).toBe(true);
+    const error = await scheduler.acquire().catch((e) => e);
+    expect(error).toBeInstanceOf(SchedulerBusyError);
+    expect(error.retryAfterSeconds).toBeGreaterThanOrEqual(1);
+  });
+
+  it('drops queued jobs whose caller gives up', async () => {
+    const scheduler = new JobScheduler({ concurrency: 1, maxQueue: 4 });
+    const release = await scheduler.acquire();
+    const controller = new AbortController();
+    const queued = scheduler.acquire({ signal: controller.signal });
+
+    controller.abort(new Error('Client disconnected'));
+    await expect(queued).rejects.toThrow('Client disconnected');
+    expect(scheduler.stats().queued).toBe(0);
+
+    release();
+    expect(scheduler.stats().running).toBe(0);
+  });
+
+  it('derives concurrency from the per-core ratio with a floor of one', () => {
+    expect(JobScheduler.fromEnv({ jobsPerCore: 0, maxQueue: 3 }).concurrency).toBe(1);
+    expect(JobScheduler.fromEnv({ jobsPerCore: 0, maxQueue: 3 }).maxQueue).toBe(3);
+  });
+});
@@ -0,0 +1,39 @@
+import { describe, it, expect } from 'vitest';
+import { parseLoudnormStats, hasLoudnessStats, loudnormFilter } from '../loudness.js';
+
+const REPORT = `[Parsed_loudnorm_0 @ 0x55d5c8a0] 
+{
+	"input_i" : "-27.61",
+	"input_tp" : "-4.47",
+	"input_lra" : "18.06",
+	"input_thresh" : "-39.20",
+	"output_i" : "-16.58",
+	"output_tp" : "-1.50",
+	"output_lra" : "14.78",
+	"output_thresh" : "-27.71",
+	"normalization_type" : "dynamic",
+	"target_offset" : "0.58"
+}`;
+
+describe('loudness', () => {
+  it('parses the measured input stats from the loudnorm report', () => {
+    const stats = parseLoudnormStats(`size=N/A time=00:10:00.00\n${REPORT}\n`);
+    expect(stats).toEqual({ inputI: -27.61, inputTp: -4.47, inputLra: 18.06, inputThresh: -39.2 });
+    expect(hasLoudnessStats(stats)).toBe(true);
+  });
+
+  it('treats unmeasurable loudness as missing stats', () => {
+    const stats = parseLoudnormStats(REPORT.replace('"-27.61"', '"-inf"'));
+    expect(stats.inputI).toBe(null);
+    expect(hasLoudnessStats(stats)).toBe(false);
+    expect(() => parseLoudnormStats('no report')).toThrow('did not report');
+  });
+
+  it('normalizes linearly from measured stats and dynamically without them', () => {
+    const stats = { inputI: -27.61, inputTp: -4.47, inputLra: 18.06, inputThresh: -39.2 };
+    expect(loudnormFilter(-14, stats)).toBe(
+      'loudnorm=I=-14:TP=-1.5:LRA=11:measured_I=-27.61:measured_LRA=18.06:measured_TP=-4.47:measured_thresh=-39.2:linear=true'
+    );
+    expect(loudnormFilter(-16, null)).toBe('loudnorm=I=-16:TP=-1.5:LRA=11');
+  });
+});
@@ -0,0 +1,58 @@
+import { describe, it, expect } from 'vitest';
+import { MetricsRegistry, monitorEventLoopLag, formatValue } from '../metrics.js';
+
+describe('metrics', () => {
+  it('renders counters and gauges with escaped labels', async () => {
+    const registry = new MetricsRegistry();
+    const counter = registry.counter({ name: 'requests_total', help: 'Requests', labelNames: ['route'] });
+    counter.inc({ route: '/api/process-video' });
+    counter.inc({ route: '/api/process-video' }, 2);
+    counter.inc({ route: 'say "hi"\n' });
+    registry.gauge({ name: 'queue', help: 'Queue', collect: () => 3 });
+
+    const text = await registry.render();
+    expect(text).toContain('# HELP requests_total Requests\n# TYPE requests_total counter\n');
+    expect(text).toContain('requests_total{route="/api/process-video"} 3\n');
+    expect(text).toContain('requests_total{route="say \\"hi\\"\\n"} 1\n');
+    expect(text).toContain('# TYPE queue gauge\nqueue 3\n');
+    expect(() => registry.gauge({ name: 'queue', help: 'Again' })).toThrow(/already registered/);
+  });
+
+  it('renders cumulative histogram buckets with sum and count', async () => {
+    const registry = new MetricsRegistry();
+    const histogram = registry.histogram({ name: 'latency_seconds', help: 'Latency', labelNames: ['op'], buckets: [1, 0.1] });
+    histogram.observe({ op: 'trim_video' }, 0.05);
+    histogram.observe({ op: 'trim_video' }, 0.5);
+    histogram.observe({ op: 'trim_video' }, 5);
+
+    const text = await registry.render();
+    expect(text).toContain('latency_seconds_bucket{op="trim_video",le="0.1"} 1\n');
+    expect(text).toContain('latency_seconds_bucket{op="trim_video",le="1"} 2\n');
+    expect(text).toContain('latency_seconds_bucket{op="trim_video",le="+Inf"} 3\n');
+    expect(text).toContain('latency_seconds_sum{op="trim_video"} 5.55\n');
+    expect(text).toContain('latency_seconds_count{op="trim_video"} 3\n');
+    expect(formatValue(Infinity)).toBe('+Inf');
+  });
+
+  it('folds label combinations past maxSeries into one series', async () => {
+    const registry = new MetricsRegistry();
+    const counter = registry.counter({ name: 'ops_total', help: 'Ops', labelNames: ['op'], maxSeries: 2 });
+    ['a', 'b', 'c', 'd'].forEach((op) => counter.inc({ op }));
+    const text = await registry.render();
+    expect(text).toContain('ops_total{op="a"} 1\n');
+    expect(text).toContain('ops_total{op="_other"} 2\n');
+    expect(text).not.toContain('op="c"');
+  });
+
+  it('reports event-loop lag quantiles and skips a failing collector', async () => {
+    const registry = new MetricsRegistry();
+    registry.gauge({ name: 'broken', help: 'Broken', collect: () => { throw new Error('gone'); } });
+    monitorEventLoopLag(registry);
+    await new Promise((resolve) => setTimeout(resolve, 50));
+
+    const text = await registry.render();
+    expect(text).not.toContain('broken');
+    const max = Number(text.match(/event_loop_lag_seconds\{quantile="1"\} (\S+)/)[1]);
+    expect(max).toBeGreaterThan(0);
+  });
+});
@@ -0,0 +1,96 @@
+import { describe, it, expect, beforeEach, afterEach } from 'vitest';
+import { promises as fs } from 'fs';
+import os from 'os';
+import path from 'path';
+import { AssetStore } from '../assetStore.js';
+import { ProbeCache, videoStreamOf, hasAudioStream, durationOf } from '../probeCache.js';
+
+const METADATA = {
+  format: { duration: '12.5' },
+  streams: [{ codec_type: 'video', width: 1920, height: 1080 }, { codec_type: 'audio' }]
+};
+
+describe('ProbeCache', () => {
+  let dir;
+  let probes;
+  const probe = async (filePath) => {
+    probes.push(filePath);
+    return METADATA;
+  };
+  const asset = { id: 'a'.repeat(64), path: '/assets/a.mp4' };
+
+  beforeEach(async () => {
+    dir = await fs.mkdtemp(path.join(os.tmpdir(), 'finalcut-probe-cache-test-'));
+    probes = [];
+  });
+
+  afterEach(async () => {
+    await fs.rm(dir, { recursive: true, force: true });
+  });
+
+  it('probes each asset once, including concurrent requests', async () => {
+    const cache = new ProbeCache({ dir, probe });
+    const [first, second] = await Promise.all([cache.get(asset), cache.get(asset)]);
+    expect(first).toEqual(METADATA);
+    expect(second).toBe(first);
+    expect(await cache.get(asset)).toBe(first);
+    expect(probes).toEqual(['/assets/a.mp4']);
+    expect(cache.stats()).toMatchObject({ misses: 1, hits: 1, entries: 1 });
+  });
+
+  it('reloads spilled probes from disk after memory eviction or restart', async () => {
+    const cache = new ProbeCache({ dir, probe, maxEntries: 1 });
+    await cache.get(asset);
+    await cache.get({ id: 'b'.repeat(64), path: '/assets/b.mp4' });
+    expect(cache.entries.has(asset.id)).toBe(false);
+
+    expect(await cache.get(asset)).toEqual(METADATA);
+    const restarted = new ProbeCache({ dir, probe });
+    expect(await restarted.get(asset)).toEqual(METADATA);
+    expect(probes).toEqual(['/assets/a.mp4', '/assets/b.mp4']);
+    expect(restarted.stats().diskHits).toBe(1);
+  });
+
+  it('drops spilled probes of assets no longer in the store', async () => {
+    await new ProbeCache({ dir, probe }).get(asset);
+    const cache = new ProbeCache({ dir, probe, store: { assets: new Map() } });
+    await cache.init();
+    expect(await fs.readdir(dir)).toEqual([]);
+  });
+
+  it('deletes the spilled probe when the store drops its asset at runtime', async () => {
+    const store = new AssetStore({ dir: path.join(dir, 'assets') });
+    await store.init();
+    const probesDir = path.join(dir, 'probes');
+    const cache = new ProbeCache({ dir: probesDir, probe, store });
+    await cache.init();
+    const stored = await store.ingestBuffer(Buffer.from('video'), { ext: 'mp4' });
+    await cache.get(stored);
+    expect(await fs.readdir(probesDir)).toEqual([`${stored.id}.probe.json`]);
+
+    await store.drop(stored);
+    expect(await fs.readdir(probesDir)).toEqual([]);
+    expect(cache.stats().entries).toBe(0);
+  });
+
+  it('keeps other measurements under their own file suffix', async () => {
+    const cache = new ProbeCache({ dir, probe, suffix: '.loudness.json' });
+    await cache.get(asset);
+    expect(await fs.readdir(dir)).toEqual([`${asset.id}.loudness.json`]);
+  });
+
+  it('passes the asset to the probe, for measurements of derived files', async () => {
+    const received = [];
+    const cache = new ProbeCache({ dir, suffix: '.loudness.json', probe: async (filePath, source) => { received.push(source); return {}; } });
+    await cache.get(asset);
+    expect(received).toEqual([asset]);
+  });
+
+  it('reads stream layout and duration', () => {
+    expect(videoStreamOf(METADATA).width).toBe(1920);
+    expect(hasAudioStream(METADATA)).toBe(true);
+    expect(hasAudioStream({ streams: [] })).toBe(false);
+    expect(durationOf(METADATA)).toBe(12.5);
+    expect(durationOf({ format: {} })).toBeNull();
+  });
+});
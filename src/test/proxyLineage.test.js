@@ -0,0 +1,59 @@
+import { describe, it, expect } from 'vitest';
+import { isReplayableOperation, proxyDimensions, scaleOperationArgs, extendLineage, replaySteps } from '../proxyLineage.js';
+
+describe('proxyLineage', () => {
+  it('only proxies videos larger than the target', () => {
+    expect(proxyDimensions(3840, 2160, 480)).toEqual({ shortSide: 480, scale: 4.5 });
+    expect(proxyDimensions(2160, 3840, 480)).toEqual({ shortSide: 480, scale: 4.5 });
+    expect(proxyDimensions(854, 480, 480)).toBeNull();
+    expect(proxyDimensions(3840, 2160, 0)).toBeNull();
+  });
+
+  it('scales pixel args, keeping sizes even', () => {
+    expect(scaleOperationArgs('crop_video', { x: 100, y: 50, width: 1920, height: 1080 }, 1 / 4.5))
+      .toEqual({ x: 22, y: 11, width: 426, height: 240 });
+    expect(scaleOperationArgs('resize_video', { width: 1280, height: -1 }, 0.25)).toEqual({ width: 320, height: -1 });
+    expect(scaleOperationArgs('add_text', { text: 'hi', fontsize: 48 }, 0.5)).toEqual({ text: 'hi', fontsize: 24 });
+    expect(scaleOperationArgs('adjust_hue', { degrees: 30 }, 0.5)).toEqual({ degrees: 30 });
+  });
+
+  it('scales pixel args inside batches', () => {
+    const scaled = scaleOperationArgs('apply_operations', {
+      operations: [{ operation: 'crop_video', args: { x: 40, y: 40, width: 400, height: 400 } }, { operation: 'flip_video_horizontal' }]
+    }, 0.5);
+    expect(scaled.operations[0].args).toEqual({ x: 20, y: 20, width: 200, height: 200 });
+    expect(scaled.operations[1].args).toEqual({});
+  });
+
+  it('records operations without their encode profile', () => {
+    const lineage = { sourceId: 'a'.repeat(64), scale: 2, operations: [] };
+    const next = extendLineage(lineage, 'adjust_hue', { degrees: 30, encodeProfile: 'draft' });
+    expect(next.operations).toEqual([{ operation: 'adjust_hue', args: { degrees: 30 } }]);
+    expect(lineage.operations).toEqual([]);
+  });
+
+  it('fuses runs of filter operations when replaying', () => {
+    const steps = replaySteps([
+      { operation: 'adjust_hue', args: { degrees: 30 } },
+      { operation: 'apply_operations', args: { operations: [{ operation: 'adjust_volume', args: { volume: 2 } }] } },
+      { operation: 'trim_video', args: { start: 1, end: 4 } },
+      { operation: 'flip_video_horizontal', args: {} }
+    ]);
+    expect(steps).toEqual([
+      {
+        operation: 'apply_operations',
+        args: { operations: [{ operation: 'adjust_hue', args: { degrees: 30 } }, { operation: 'adjust_volume', args: { volume: 2 } }] }
+      },
+      { operation: 'trim_video', args: { start: 1, end: 4 } },
+      { operation: 'flip_video_horizontal', args: {} }
+    ]);
+  });
+
+  it('knows which operations can be replayed', () => {
+    expect(isReplayableOperation('trim_video')).toBe(true);
+    expect(isReplayableOperation('apply_operations')).toBe(true);
+    expect(isReplayableOperation('adjust_hue')).toBe(true);
+    expect(isReplayableOperation('extract_audio')).toBe(false);
+    expect(isReplayableOperation('convert_video_format')).toBe(false);
+  });
+});
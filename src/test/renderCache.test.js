@@ -0,0 +1,92 @@
+import { describe, it, expect, beforeEach, afterEach } from 'vitest';
+import { promises as fs } from 'fs';
+import os from 'os';
+import path from 'path';
+import { AssetStore } from '../assetStore.js';
+import { RenderCache, renderCacheKey, canonicalize } from '../renderCache.js';
+
+describe('RenderCache', () => {
+  let dir;
+  let store;
+  let cache;
+
+  beforeEach(async () => {
+    dir = await fs.mkdtemp(path.join(os.tmpdir(), 'finalcut-render-cache-test-'));
+    store = new AssetStore({ dir });
+    await store.init();
+    cache = new RenderCache({ store, indexPath: path.join(dir, 'render-cache.json'), maxBytes: 100 });
+    await cache.init();
+  });
+
+  afterEach(async () => {
+    clearTimeout(cache.persistTimer);
+    await fs.rm(dir, { recursive: true, force: true });
+  });
+
+  it('keys renders by canonical args regardless of key order', () => {
+    expect(canonicalize({ b: 1, a: { d: [1, 2], c: 'x' } })).toBe('{"a":{"c":"x","d":[1,2]},"b":1}');
+    expect(renderCacheKey('in', 'resize_video', { width: 640, height: 360 }))
+      .toBe(renderCacheKey('in', 'resize_video', { height: 360, width: 640 }));
+    expect(renderCacheKey('in', 'resize_video', { width: 640, height: 360 }))
+      .not.toBe(renderCacheKey('other', 'resize_video', { width: 640, height: 360 }));
+  });
+
+  it('counts misses and serves recorded outputs as hits', async () => {
+    const key = renderCacheKey('in', 'adjust_volume', { volume: 2 });
+    expect(await cache.lookup(key)).toBeNull();
+
+    const output = await store.ingestBuffer(Buffer.from('rendered'), { mimeType: 'video/mp4', ext: 'mp4' });
+    cache.record(key, output);
+    expect((await cache.lookup(key)).id).toBe(output.id);
+    expect(cache.stats()).toMatchObject({ hits: 1, misses: 1, entries: 1, bytes: 8 });
+  });
+
+  it('drops least recently used entries beyond its byte quota', async () => {
+    const first = await store.ingestBuffer(Buffer.alloc(60, 1), { ext: 'mp4' });
+    const second = await store.ingestBuffer(Buffer.alloc(60, 2), { ext: 'mp4' });
+    cache.record('first', first);
+    cache.record('second', second);
+
+    expect(await cache.lookup('first')).toBeNull();
+    expect((await cache.lookup('second')).id).toBe(second.id);
+    expect(cache.stats().bytes).toBe(60);
+  });
+
+  it('hands evicted outputs back to the store instead of deleting them', async () => {
+    const first = await store.ingestBuffer(Buffer.alloc(40, 1), { ext: 'mp4' });
+    const second = await store.ingestBuffer(Buffer.alloc(40, 2), { ext: 'mp4' });
+    const third = await store.ingestBuffer(Buffer.alloc(40, 3), { ext: 'mp4' });
+    cache.record('first', first);
+    cache.record('second', second);
+    const inUse = await store.acquire(second.id);
+    cache.record('third', third);
+    cache.record('fourth', await store.ingestBuffer(Buffer.alloc(40, 4), { ext: 'mp4' }));
+
+    // Chained edits may still reference an evicted output; the store's LRU reclaims it
+    expect(store.assets.get(first.id).refs).toBe(0);
+    expect(await fs.stat(first.path)).toBeTruthy();
+    expect(inUse.refs).toBe(1);
+    expect(store.assets.get(third.id).refs).toBe(1);
+  });
+
+  it('counts lookups of intermediates apart from the hit rate', async () => {
+    const output = await store.ingestBuffer(Buffer.from('proxy'), { ext: 'mp4' });
+    cache.record('proxy', output);
+    await cache.lookup('proxy', { internal: true });
+    await cache.lookup('overlay', { internal: true });
+    await cache.lookup('edit');
+    expect(cache.stats()).toMatchObject({ hits: 0, misses: 1, hitRate: 0, internalHits: 1, internalMisses: 1 });
+  });
+
+  it('persists its index and skips outputs that no longer exist', async () => {
+    const output = await store.ingestBuffer(Buffer.from('kept'), { ext: 'mp4' });
+    cache.record('kept', output);
+    cache.entries.set('gone', { assetId: 'f'.repeat(64), size: 4 });
+    await cache.persist();
+
+    const reopened = new RenderCache({ store, indexPath: path.join(dir, 'render-cache.json') });
+    await reopened.init();
+    expect(reopened.entries.has('gone')).toBe(false);
+    expect((await reopened.lookup('kept')).id).toBe(output.id);
+  });
+});
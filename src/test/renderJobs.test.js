@@ -0,0 +1,64 @@
+import { describe, it, expect } from 'vitest';
+import { RenderJobs, createProgressParser, withEstimates } from '../renderJobs.js';
+
+describe('createProgressParser', () => {
+  it('emits one update per -progress block', () => {
+    const updates = [];
+    const parse = createProgressParser((progress) => updates.push(progress));
+    ['frame=120', 'fps=48.5', 'out_time_us=4000000', 'speed=2.01x', 'progress=continue',
+      'frame=300', 'fps=50', 'out_time_ms=10000000', 'speed=2x', 'progress=end', 'not a progress line']
+      .forEach(parse);
+
+    expect(updates).toEqual([
+      { frame: 120, fps: 48.5, speed: 2.01, outTimeSeconds: 4, done: false },
+      { frame: 300, fps: 50, speed: 2, outTimeSeconds: 10, done: true }
+    ]);
+  });
+
+  it('adds percent and ETA from the expected duration', () => {
+    expect(withEstimates({ outTimeSeconds: 4, speed: 2 }, 10)).toMatchObject({ percent: 40, etaSeconds: 3 });
+    expect(withEstimates({ outTimeSeconds: 4, speed: 0 }, 10).etaSeconds).toBeNull();
+    expect(withEstimates({ outTimeSeconds: 4, speed: 2 }, null)).toEqual({ outTimeSeconds: 4, speed: 2 });
+  });
+});
+
+describe('RenderJobs', () => {
+  it('streams events to subscribers and replays state to late ones', () => {
+    const jobs = new RenderJobs();
+    const job = jobs.create({ owner: 'user:1', operation: 'resize_video' });
+    const events = [];
+    jobs.subscribe(job, (event, data) => events.push([event, data]));
+
+    jobs.start(job);
+    jobs.progress(job, { percent: 50 });
+    jobs.complete(job, { assetId: 'a'.repeat(64), size: 10, mimeType: 'video/mp4' });
+    expect(events.map(([event]) => event)).toEqual(['status', 'status', 'progress', 'done']);
+
+    const late = [];
+    jobs.subscribe(job, (event) => late.push(event));
+    expect(late).toEqual(['status', 'progress', 'done']);
+  });
+
+  it('only exposes a job to its owner', () => {
+    const jobs = new RenderJobs();
+    const job = jobs.create({ owner: 'user:1', operation: 'trim_video' });
+    expect(jobs.get(job.id, 'user:1')).toBe(job);
+    expect(jobs.get(job.id, 'user:2')).toBeNull();
+  });
+
+  it('reports failures and forgets finished jobs after their TTL', () => {
+    const jobs = new RenderJobs({ ttlMs: 1000 });
+    const job = jobs.create({ owner: 'user:1', operation: 'trim_video' });
+    jobs.fail(job, Object.assign(new Error('budget spent'), { code: 'cost_budget_exceeded' }));
+    expect(jobs.describe(job)).toMatchObject({ status: 'failed', error: 'budget spent', code: 'cost_budget_exceeded' });
+
+    // Late subscribers can tell busy and budget failures from FFmpeg errors, as live ones can
+    const late = [];
+    jobs.subscribe(job, (event, data) => late.push([event, data]));
+    expect(late.at(-1)).toEqual(['failed', { error: 'budget spent', code: 'cost_budget_exceeded' }]);
+
+    job.finishedAt = Date.now() - 2000;
+    jobs.sweep();
+    expect(jobs.get(job.id, 'user:1')).toBeNull();
+  });
+});
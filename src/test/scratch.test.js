@@ -0,0 +1,86 @@
+import { describe, it, expect, beforeEach, afterEach } from 'vitest';
+import { promises as fs } from 'fs';
+import os from 'os';
+import path from 'path';
+import { ScratchArena, ScratchFullError, tmpScratch } from '../scratch.js';
+
+const exists = (filePath) => fs.stat(filePath).then(() => true, () => false);
+
+describe('ScratchArena', () => {
+  let root;
+  let dir;
+  let tmpfsDir;
+
+  beforeEach(async () => {
+    root = await fs.mkdtemp(path.join(os.tmpdir(), 'finalcut-scratch-test-'));
+    dir = path.join(root, 'disk');
+    tmpfsDir = path.join(root, 'tmpfs');
+  });
+
+  afterEach(async () => {
+    await fs.rm(root, { recursive: true, force: true });
+  });
+
+  it('removes a job directory and everything in it on release, even when the job throws', async () => {
+    const arena = new ScratchArena({ dir });
+    await arena.init();
+    let jobPath;
+    await expect(arena.withDir('segmented', async (scratchDir) => {
+      jobPath = scratchDir.path;
+      await fs.writeFile(scratchDir.file('segment-0.ts'), 'data');
+      throw new Error('encode failed');
+    })).rejects.toThrow('encode failed');
+    expect(await exists(jobPath)).toBe(false);
+    expect(arena.stats()).toMatchObject({ jobs: 0, created: 1 });
+  });
+
+  it('places small jobs on tmpfs while its share has room', async () => {
+    const arena = new ScratchArena({ dir, tmpfsDir, tmpfsMaxBytes: 100 });
+    await arena.init();
+    const small = await arena.createDir('subtitles', { small: true, reserveBytes: 80 });
+    const overflow = await arena.createDir('subtitles', { small: true, reserveBytes: 40 });
+    const large = await arena.createDir('segmented');
+    expect(path.dirname(small.path)).toBe(tmpfsDir);
+    expect(path.dirname(overflow.path)).toBe(dir);
+    expect(path.dirname(large.path)).toBe(dir);
+    expect(arena.stats().tmpfsBytes).toBe(80);
+  });
+
+  it('is full while live reservations or measured sizes reach the quota', async () => {
+    const arena = new ScratchArena({ dir, maxBytes: 100 });
+    await arena.init();
+    const reserved = await arena.createDir('transition', { reserveBytes: 60 });
+    expect(arena.isFull()).toBe(false);
+    const measured = await arena.createDir('smartcut', { reserveBytes: 10 });
+    await fs.writeFile(measured.file('audio.m4a'), Buffer.alloc(50));
+    await arena.sweep();
+    expect(arena.usedBytes()).toBe(110);
+    expect(arena.isFull()).toBe(true);
+    await reserved.release();
+    expect(arena.isFull()).toBe(false);
+    expect(new ScratchFullError(0).retryAfterSeconds).toBe(1);
+  });
+
+  it('sweeps directories of exited processes and of this pid before a restart', async () => {
+    await fs.mkdir(path.join(dir, '111-segmented-0123abcd'), { recursive: true });
+    await fs.mkdir(path.join(dir, '222-captions-0123abcd'), { recursive: true });
+    await fs.mkdir(path.join(dir, '333-smartcut-0123abcd'), { recursive: true });
+    await fs.mkdir(path.join(dir, 'unrelated'), { recursive: true });
+    const arena = new ScratchArena({ dir, pid: 333, isProcessAlive: (pid) => pid === 222 });
+    await arena.init();
+    const live = await arena.createDir('transition');
+    expect((await fs.readdir(dir)).sort()).toEqual(['222-captions-0123abcd', path.basename(live.path), 'unrelated'].sort());
+
+    // Unrecognized entries are only removed once stale
+    arena.now = () => Date.now() + arena.staleMs + 1000;
+    expect(await arena.sweep()).toBe(1);
+    expect(await exists(live.path)).toBe(true);
+    expect(arena.stats().swept).toBe(3);
+  });
+
+  it('keeps the default arena out of the server arena\'s root', () => {
+    const serverDefault = path.join(os.tmpdir(), 'finalcut-scratch');
+    expect(tmpScratch.dir).not.toBe(serverDefault);
+    expect(path.relative(serverDefault, tmpScratch.dir).startsWith('..')).toBe(true);
+  });
+});
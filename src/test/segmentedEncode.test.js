@@ -0,0 +1,90 @@
+import { describe, it, expect } from 'vitest';
+import { planSegments, runWithConcurrency, segmentCommand, segmentedEncode } from '../segmentedEncode.js';
+import { compileOperations } from '../videoOps.js';
+
+describe('planSegments', () => {
+  const keyframes = [0, 2, 4, 6, 8, 10, 12, 14, 16, 18];
+
+  it('splits at keyframes into segments of at least the target length', () => {
+    expect(planSegments(keyframes, 20, 5)).toEqual([
+      { start: 0, end: 6 },
+      { start: 6, end: 12 },
+      { start: 12, end: 20 }
+    ]);
+  });
+
+  it('does not leave a short last segment', () => {
+    expect(planSegments(keyframes, 19, 8)).toEqual([
+      { start: 0, end: 8 },
+      { start: 8, end: 19 }
+    ]);
+  });
+
+  it('keeps the whole video in one segment without usable keyframes', () => {
+    expect(planSegments([0], 20, 5)).toEqual([{ start: 0, end: 20 }]);
+    expect(planSegments([], 20, 5)).toEqual([{ start: 0, end: 20 }]);
+  });
+});
+
+describe('runWithConcurrency', () => {
+  it('runs every task with bounded concurrency', async () => {
+    let running = 0;
+    let peak = 0;
+    const done = [];
+    await runWithConcurrency([1, 2, 3, 4, 5], 2, async (item) => {
+      running++;
+      peak = Math.max(peak, running);
+      await new Promise((resolve) => setTimeout(resolve, 5));
+      running--;
+      done.push(item);
+    });
+    expect(peak).toBe(2);
+    expect(done.sort()).toEqual([1, 2, 3, 4, 5]);
+  });
+
+  it('rejects with the first failure after in-flight tasks settle', async () => {
+    let running = 0;
+    await expect(runWithConcurrency([1, 2, 3], 2, async (item) => {
+      running++;
+      await new Promise((resolve) => setTimeout(resolve, item === 1 ? 1 : 10));
+      running--;
+      if (item === 1) throw new Error('segment failed');
+    })).rejects.toThrow('segment failed');
+    expect(running).toBe(0);
+  });
+});
+
+describe('segmentedEncode', () => {
+  it('looks for keyframes relative to the start time of the source', async () => {
+    const calls = [];
+    await expect(segmentedEncode({
+      inputPath: 'in.ts',
+      outputPath: 'out.mp4',
+      metadata: { format: { duration: '60', start_time: '1.400000' }, streams: [] },
+      videoFilters: [],
+      findKeyframes: async (...args) => {
+        calls.push(args);
+        throw new Error('probed');
+      }
+    })).rejects.toThrow('probed');
+    expect(calls).toEqual([['in.ts', [[0, 60]], { startTime: 1.4 }]]);
+  });
+});
+
+describe('segmentCommand', () => {
+  it('bounds a slowed-down segment by its input span, not its output length', () => {
+    const { videoFilters } = compileOperations([{ operation: 'speed_video', args: { speed: 0.5 } }]);
+    const args = segmentCommand({
+      inputPath: 'in.mp4',
+      segment: { start: 30, end: 60 },
+      videoFilters,
+      videoEncodeOptions: ['-preset', 'veryfast'],
+      outputPath: 'segment-1.ts'
+    })._getArguments();
+
+    const input = args.indexOf('-i');
+    expect(args.slice(0, input)).toEqual(expect.arrayContaining(['-ss', '30.000000', '-t', '30.000000']));
+    expect(args.indexOf('-t')).toBeLessThan(input);
+    expect(args.lastIndexOf('-t')).toBeLessThan(input);
+  });
+});
@@ -0,0 +1,94 @@
+import { describe, it, expect } from 'vitest';
+import http from 'http';
+import { ServerTiming, parseFfmpegSpeed, parseServerTiming, formatServerTiming, sendServerTiming } from '../serverTiming.js';
+
+// Serve one request through sendServerTiming and return the headers a client sees, the body,
+// and the breakdown passed to onComplete
+async function serveOnce(handler) {
+  let completed = null;
+  const server = http.createServer((req, res) => {
+    const timing = new ServerTiming();
+    timing.phase('probe')();
+    sendServerTiming(req, res, timing, { onComplete: (header) => { completed = header; } });
+    handler(res, timing);
+  });
+  await new Promise((resolve) => server.listen(0, '127.0.0.1', resolve));
+  try {
+    const { headers, body } = await new Promise((resolve, reject) => {
+      http.get(`http://127.0.0.1:${server.address().port}/`, (res) => {
+        let body = '';
+        res.on('data', (chunk) => { body += chunk; });
+        res.on('end', () => resolve({ headers: res.headers, body }));
+      }).on('error', reject);
+    });
+    return { headers, body, completed };
+  } finally {
+    await new Promise((resolve) => server.close(resolve));
+  }
+}
+
+describe('serverTiming', () => {
+  it('counts overlapping runs of a phase once and leaves running phases out', () => {
+    let now = 0;
+    const timing = new ServerTiming({ now: () => now });
+    const firstSegment = timing.phase('encode');
+    now = 100;
+    const secondSegment = timing.phase('encode');
+    now = 300;
+    firstSegment();
+    firstSegment();
+    now = 400;
+    secondSegment();
+    const egress = timing.phase('egress');
+    now = 450;
+    expect(timing.durations()).toEqual({ encode: 400 });
+    egress();
+    expect(timing.durations()).toEqual({ encode: 400, egress: 50 });
+  });
+
+  it('reports the speed of the longest FFmpeg process', () => {
+    const timing = new ServerTiming({ now: () => 0 });
+    timing.recordSpeed(10, 1.5);
+    timing.recordSpeed(2, 30);
+    timing.recordSpeed(5, null);
+    expect(timing.header()).toBe('speed;desc="1.5x"');
+    expect(parseFfmpegSpeed('frame=  120 fps= 60 q=28.0 size=512kB time=00:00:04.00 bitrate=1048.6kbits/s speed=2.01x')).toBe(2.01);
+    expect(parseFfmpegSpeed('speed=N/A')).toBeNull();
+  });
+
+  it('round-trips the header and formats it in phase order', async () => {
+    let now = 0;
+    const timing = new ServerTiming({ now: () => now });
+    await timing.time('probe', async () => { now = 12.34; });
+    timing.recordSpeed(1, 3.2);
+    const metrics = parseServerTiming(timing.header());
+    expect(metrics).toEqual([{ name: 'probe', dur: 12.3 }, { name: 'speed', desc: '3.2x' }]);
+    expect(formatServerTiming([{ name: 'total', dur: 2500 }, ...metrics, { name: 'ingest', dur: 1200 }]))
+      .toBe('ingest 1.2 s · probe 12 ms · speed 3.2x · total 2.5 s');
+    expect(parseServerTiming(null)).toEqual([]);
+  });
+
+  it('sends the breakdown of a response with a known length in its header', async () => {
+    const { headers, completed } = await serveOnce((res, timing) => {
+      timing.phase('encode')();
+      res.setHeader('Content-Length', 2);
+      res.end('ok');
+    });
+    expect(parseServerTiming(headers['server-timing']).map((metric) => metric.name)).toEqual(['probe', 'encode']);
+    expect(completed).toBeNull();
+  });
+
+  it('sends no header for a streamed response and hands over its full breakdown when it ends', async () => {
+    const { headers, body, completed } = await serveOnce((res, timing) => {
+      const endEncode = timing.phase('encode');
+      res.write('chunk');
+      setTimeout(() => {
+        endEncode();
+        res.end('last');
+      }, 5);
+    });
+    expect(body).toBe('chunklast');
+    expect(headers['server-timing']).toBeUndefined();
+    expect(parseServerTiming(completed).map((metric) => metric.name)).toEqual(['probe', 'encode', 'egress']);
+  });
+});
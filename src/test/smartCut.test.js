@@ -0,0 +1,62 @@
+import { describe, it, expect, vi } from 'vitest';
+import { planSmartCut, smartCut, edgeEncodeOptions, segmentsShareParameterSets } from '../smartCut.js';
+
+describe('planSmartCut', () => {
+  const keyframes = [0, 2, 4, 6, 8, 10];
+
+  it('re-encodes only the partial GOPs around a copied middle', () => {
+    expect(planSmartCut(keyframes, 1.5, 7.25, 12)).toEqual([
+      { start: 1.5, end: 2, copy: false },
+      { start: 2, end: 6, copy: true },
+      { start: 6, end: 7.25, copy: false }
+    ]);
+  });
+
+  it('skips edges that already fall on keyframes', () => {
+    expect(planSmartCut(keyframes, 2, 8, 12)).toEqual([{ start: 2, end: 8, copy: true }]);
+  });
+
+  it('copies through to the end of the source without a tail encode', () => {
+    expect(planSmartCut(keyframes, 3, 12, 12)).toEqual([
+      { start: 3, end: 4, copy: false },
+      { start: 4, end: 12, copy: true }
+    ]);
+  });
+
+  it('re-encodes the whole range when it contains no keyframe', () => {
+    expect(planSmartCut(keyframes, 4.5, 5.5, 12)).toEqual([{ start: 4.5, end: 5.5, copy: false }]);
+    expect(planSmartCut([], 1, 3, 12)).toEqual([{ start: 1, end: 3, copy: false }]);
+  });
+
+  it('accepts unsorted keyframe lists', () => {
+    expect(planSmartCut([6, 0, 4, 2], 1, 5, 12)).toEqual([
+      { start: 1, end: 2, copy: false },
+      { start: 2, end: 4, copy: true },
+      { start: 4, end: 5, copy: false }
+    ]);
+  });
+});
+
+describe('smartCut', () => {
+  it('rejects a start past the end of the source before running FFmpeg', async () => {
+    const runFfmpeg = vi.fn();
+    const metadata = { format: { duration: '10.0' }, streams: [{ codec_type: 'video', codec_name: 'h264' }] };
+    await expect(smartCut({ inputPath: 'in.mp4', start: 12, end: 15, outputPath: 'out.mp4', runFfmpeg, metadata }))
+      .rejects.toMatchObject({ code: 'trim_out_of_range' });
+    expect(runFfmpeg).not.toHaveBeenCalled();
+  });
+
+  it('encodes edges at the source profile, level and pixel format', () => {
+    expect(edgeEncodeOptions({ profile: 'Main', level: 31, pix_fmt: 'yuv420p' }))
+      .toEqual(['-pix_fmt', 'yuv420p', '-profile:v', 'main', '-level:v', '3.1']);
+    expect(edgeEncodeOptions({ profile: 'Unknown', level: -99 })).toEqual(['-pix_fmt', 'yuv420p']);
+  });
+
+  it('splices segments only when they all carry the same known parameter sets', async () => {
+    const hashes = { 'a.ts': 'MD5:1', 'b.ts': 'MD5:1', 'c.ts': 'MD5:2', 'd.ts': null };
+    const probeHash = async (segmentPath) => hashes[segmentPath];
+    expect(await segmentsShareParameterSets(['a.ts', 'b.ts'], probeHash)).toBe(true);
+    expect(await segmentsShareParameterSets(['a.ts', 'c.ts'], probeHash)).toBe(false);
+    expect(await segmentsShareParameterSets(['d.ts', 'd.ts'], probeHash)).toBe(false);
+  });
+});
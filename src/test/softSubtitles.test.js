@@ -0,0 +1,28 @@
+import { describe, it, expect } from 'vitest';
+import { mp4LanguageCode, subtitleTracksFromArgs, softSubtitleOutputOptions } from '../softSubtitles.js';
+
+const SRT = '1\n00:00:01,000 --> 00:00:02,000\nHello';
+
+describe('softSubtitles', () => {
+  it('tags tracks with ISO 639-2 language codes', () => {
+    expect(mp4LanguageCode('en')).toBe('eng');
+    expect(mp4LanguageCode('pt-BR')).toBe('por');
+    expect(mp4LanguageCode('fil')).toBe('fil');
+    expect(mp4LanguageCode('auto')).toBe('und');
+  });
+
+  it('reads the primary and translated tracks from args', () => {
+    expect(subtitleTracksFromArgs({ srtContent: SRT, language: 'en', translatedSrtContent: SRT, translatedLanguage: 'es' }).tracks)
+      .toEqual([{ srt: SRT, language: 'en' }, { srt: SRT, language: 'es' }]);
+    expect(subtitleTracksFromArgs({ srtContent: SRT, translatedSrtContent: null }).tracks).toHaveLength(1);
+    expect(subtitleTracksFromArgs({ srtContent: 'no cues' }).error).toMatch(/srtContent/);
+  });
+
+  it('copies video and audio and adds mov_text tracks, the first one by default', () => {
+    const options = softSubtitleOutputOptions([{ language: 'en' }, { language: 'es' }]);
+    expect(options.join(' ')).toContain('-map 0:v? -map 0:a? -map 1:s:0 -map 2:s:0 -c:v copy -c:a copy -c:s mov_text');
+    expect(options.join(' ')).toContain('-metadata:s:s:1 language=spa');
+    expect(options.join(' ')).toContain('-disposition:s:0 default');
+    expect(options.join(' ')).toContain('-disposition:s:1 0');
+  });
+});
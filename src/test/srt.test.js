@@ -0,0 +1,34 @@
+import { describe, it, expect } from 'vitest';
+import { parseSrt, formatSrt, formatTimestamp, offsetCues, srtToVtt } from '../srt.js';
+
+describe('srt', () => {
+  it('parses cues, tolerating code fences and missing sequence numbers', () => {
+    const cues = parseSrt('```srt\n1\n00:00:01,000 --> 00:00:02,500\nHello\nworld\n\n00:00:03.2 --> 00:00:04,000\nAgain\n```');
+    expect(cues).toEqual([
+      { start: 1, end: 2.5, text: 'Hello\nworld' },
+      { start: 3.2, end: 4, text: 'Again' }
+    ]);
+  });
+
+  it('formats renumbered SRT', () => {
+    expect(formatTimestamp(3723.5)).toBe('01:02:03,500');
+    expect(formatSrt([{ start: 61, end: 62.25, text: 'Hi' }, { start: 63, end: 64, text: 'There' }])).toBe(
+      '1\n00:01:01,000 --> 00:01:02,250\nHi\n\n2\n00:01:03,000 --> 00:01:04,000\nThere'
+    );
+  });
+
+  it('shifts chunk cues to media time and keeps them inside the chunk', () => {
+    expect(offsetCues([
+      { start: 1, end: 2, text: 'a' },
+      { start: 58, end: 62, text: 'b' },
+      { start: 61, end: 63, text: 'c' }
+    ], 120, 60)).toEqual([
+      { start: 121, end: 122, text: 'a' },
+      { start: 178, end: 180, text: 'b' }
+    ]);
+  });
+
+  it('converts SRT to WebVTT', () => {
+    expect(srtToVtt('1\r\n00:00:01,000 --> 00:00:02,000\r\nHi')).toBe('WEBVTT\n\n1\n00:00:01.000 --> 00:00:02.000\nHi');
+  });
+});
@@ -1,5 +1,5 @@
 import { describe, it, expect, vi, beforeEach } from 'vitest';
-import { toolFunctions } from '../toolFunctions.js';
+import { toolFunctions, isFusableToolCall, runFusedToolCalls, setRenderProgressListener, setServerTimingListener, isProxyRender, registerServerAsset } from '../toolFunctions.js';
 
 // Mock fetch for server API calls
 global.fetch = vi.fn();
@@ -1026,6 +1026,191 @@ describe('toolFunctions', () => {
     });
   });
 
+  describe('fused tool calls', () => {
+    it('only fuses filter tools whose arguments are valid', () => {
+      expect(isFusableToolCall('adjust_brightness', { brightness: 0.2 })).toBe(true);
+      expect(isFusableToolCall('adjust_bass', { gain: 5 })).toBe(true);
+      expect(isFusableToolCall('adjust_brightness', { brightness: 5 })).toBe(false);
+      expect(isFusableToolCall('trim_video', { start: 0, end: 1 })).toBe(false);
+      expect(isFusableToolCall('toString', {})).toBe(false);
+    });
+
+    it('sends all edits as one apply_operations request', async () => {
+      const results = await runFusedToolCalls([
+        { name: 'adjust_brightness', args: { brightness: 0.2 } },
+        { name: 'adjust_saturation', args: { saturation: 1.5 } },
+        { name: 'adjust_bass', args: { gain: 5 } }
+      ], mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+
+      expect(global.fetch).toHaveBeenCalledTimes(1);
+      const [, init] = global.fetch.mock.calls[0];
+      expect(init.headers['x-operation']).toBe('apply_operations');
+      expect(JSON.parse(init.headers['x-args']).operations).toEqual([
+        { operation: 'adjust_brightness', args: { brightness: 0.2 } },
+        { operation: 'adjust_saturation', args: { saturation: 1.5 } },
+        { operation: 'bass_adjustment', args: { gain: 5 } }
+      ]);
+      expect(results).toEqual(['Brightness adjusted successfully.', 'Saturation adjusted successfully.', 'Bass adjusted successfully.']);
+      expect(mockSetVideoFileData).toHaveBeenCalledTimes(1);
+      expect(mockAddMessage).toHaveBeenCalledWith(
+        'Processed video (brightness adjusted, saturation adjusted, bass adjusted):',
+        false, 'mock-url', 'processed', 'video/mp4'
+      );
+    });
+
+    it('returns null when the batch fails so calls can run individually', async () => {
+      global.fetch.mockResolvedValueOnce({ ok: false, status: 400, json: async () => ({ error: 'bad batch' }) });
+      const results = await runFusedToolCalls([
+        { name: 'adjust_brightness', args: { brightness: 0.2 } },
+        { name: 'adjust_hue', args: { degrees: 30 } }
+      ], mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+
+      expect(results).toBeNull();
+      expect(mockSetVideoFileData).not.toHaveBeenCalled();
+    });
+  });
+
+  describe('render jobs', () => {
+    it('submits a job, reports its progress and downloads the output asset', async () => {
+      const assetId = 'a'.repeat(64);
+      const sse = new TextEncoder().encode(
+        'event: status\ndata: {"status":"running"}\n\n' +
+        'event: progress\ndata: {"percent":50,"etaSeconds":3}\n\n' +
+        `event: done\ndata: {"assetId":"${assetId}","size":8,"mimeType":"video/mp4"}\n\n`
+      );
+      global.fetch
+        .mockResolvedValueOnce({ ok: true, status: 202, json: async () => ({ jobId: 'job-1' }) })
+        .mockResolvedValueOnce(makeStreamResponse(sse.buffer))
+        .mockResolvedValueOnce(makeStreamResponse(new ArrayBuffer(8)));
+      const progress = [];
+      setRenderProgressListener((update) => progress.push(update));
+
+      try {
+        const result = await toolFunctions.resize_video({ width: 640, height: 360 }, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+        expect(result).toBe('Video resized successfully.');
+      } finally {
+        setRenderProgressListener(null);
+      }
+
+      expect(global.fetch.mock.calls.map(([url]) => url)).toEqual(['/api/jobs', '/api/jobs/job-1/events', `/api/assets/${assetId}`]);
+      expect(progress).toEqual([{ operation: 'resize_video', percent: 50, etaSeconds: 3 }, null]);
+      expect(mockSetVideoFileData).toHaveBeenCalledTimes(1);
+    });
+
+    it('surfaces a failed job as a tool error', async () => {
+      const sse = new TextEncoder().encode('event: failed\ndata: {"error":"ffmpeg exited with code 1"}\n\n');
+      global.fetch
+        .mockResolvedValueOnce({ ok: true, status: 202, json: async () => ({ jobId: 'job-2' }) })
+        .mockResolvedValueOnce(makeStreamResponse(sse.buffer));
+      setRenderProgressListener(() => {});
+
+      try {
+        const result = await toolFunctions.adjust_hue({ degrees: 30 }, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+        expect(result).toBe('Failed to adjust hue: ffmpeg exited with code 1');
+      } finally {
+        setRenderProgressListener(null);
+      }
+    });
+  });
+
+  describe('proxy previews', () => {
+    it('marks outputs rendered from a proxy', async () => {
+      const proxied = makeStreamResponse(new ArrayBuffer(8));
+      proxied.headers = new Map([['x-proxy', '1'], ['x-output-asset-id', 'a'.repeat(64)]]);
+      global.fetch.mockResolvedValueOnce(proxied);
+
+      await toolFunctions.adjust_hue({ degrees: 30 }, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+      const output = mockSetVideoFileData.mock.calls[0][0];
+      expect(isProxyRender(output)).toBe(true);
+      expect(isProxyRender(mockVideoFileData)).toBe(false);
+    });
+
+    it('exports at full quality without replacing the working video', async () => {
+      const result = await toolFunctions.export_video({}, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+
+      expect(result).toBe('Video exported at full quality.');
+      expect(global.fetch.mock.calls[0][0]).toBe('/api/export');
+      expect(mockSetVideoFileData).not.toHaveBeenCalled();
+      expect(mockAddMessage).toHaveBeenCalledWith('Exported video (full quality):', false, 'mock-url', 'exported', 'video/mp4');
+    });
+
+    it('registers uploads so the first edit references them by id', async () => {
+      const assetId = 'b'.repeat(64);
+      global.fetch.mockResolvedValueOnce({ ok: true, json: async () => ({ assetId, size: 3, mimeType: 'video/mp4' }) });
+
+      const registration = registerServerAsset(mockVideoFileData, 'video/mp4');
+      await toolFunctions.adjust_hue({ degrees: 30 }, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+      await registration;
+
+      expect(global.fetch.mock.calls[0][0]).toBe('/api/assets');
+      expect(global.fetch.mock.calls[0][1].body).toBe(mockVideoFileData);
+      expect(global.fetch.mock.calls[1][1].headers['x-asset-id']).toBe(assetId);
+      expect(global.fetch.mock.calls[1][1].body).toBeUndefined();
+    });
+
+    it('reports export failures', async () => {
+      global.fetch.mockResolvedValueOnce({ ok: false, status: 410, json: async () => ({ error: 'source expired' }) });
+      const result = await toolFunctions.export_video({}, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+      expect(result).toBe('Failed to export video: source expired');
+    });
+  });
+
+  describe('server timing', () => {
+    it('reports the Server-Timing breakdown of a processed video with the total seen by the client', async () => {
+      const timed = makeStreamResponse(new ArrayBuffer(8));
+      timed.headers = new Map([['server-timing', 'ingest;dur=120.5, probe;dur=4.0, queue;dur=0.2, speed;desc="2.5x"']]);
+      global.fetch.mockResolvedValueOnce(timed);
+      const listener = vi.fn();
+      setServerTimingListener(listener);
+      try {
+        await toolFunctions.adjust_hue({ degrees: 30 }, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+      } finally {
+        setServerTimingListener(null);
+      }
+
+      expect(listener).toHaveBeenCalledTimes(1);
+      const { operation, metrics } = listener.mock.calls[0][0];
+      expect(operation).toBe('adjust_hue');
+      expect(metrics.slice(0, 4)).toEqual([
+        { name: 'ingest', dur: 120.5 },
+        { name: 'probe', dur: 4 },
+        { name: 'queue', dur: 0.2 },
+        { name: 'speed', desc: '2.5x' }
+      ]);
+      expect(metrics[4].name).toBe('total');
+    });
+
+    it('fetches the final breakdown of a streamed output, which has no Server-Timing header', async () => {
+      const streamed = makeStreamResponse(new ArrayBuffer(8));
+      streamed.headers = new Map([['x-output-asset-id', 'out-1']]);
+      global.fetch
+        .mockResolvedValueOnce(streamed)
+        .mockResolvedValueOnce({ ok: true, json: async () => ({ serverTiming: 'probe;dur=4.0, encode;dur=900.0, egress;dur=30.0, speed;desc="2.5x"' }) });
+      const listener = vi.fn();
+      setServerTimingListener(listener);
+      try {
+        await toolFunctions.adjust_hue({ degrees: 30 }, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+      } finally {
+        setServerTimingListener(null);
+      }
+
+      expect(global.fetch.mock.calls[1][0]).toBe('/api/outputs/out-1/timing');
+      expect(listener).toHaveBeenCalledTimes(1);
+      expect(listener.mock.calls[0][0].metrics.map((metric) => metric.name)).toEqual(['probe', 'encode', 'egress', 'speed', 'total']);
+    });
+
+    it('stays quiet for responses without Server-Timing', async () => {
+      const listener = vi.fn();
+      setServerTimingListener(listener);
+      try {
+        await toolFunctions.adjust_hue({ degrees: 30 }, mockVideoFileData, mockSetVideoFileData, mockAddMessage);
+      } finally {
+        setServerTimingListener(null);
+      }
+      expect(listener).not.toHaveBeenCalled();
+    });
+  });
+
   describe('get_video_dimensions', () => {
     it('should include file size in output', async () => {
       const result = await toolFunctions.get_video_dimensions(
@@ -1296,6 +1481,75 @@ describe('toolFunctions', () => {
       expect(mockAddMessage).toHaveBeenCalledTimes(2);
     });
 
+    it('should mux soft subtitle tracks instead of burning when soft_subtitles is true', async () => {
+      const sampleSrt = '1\n00:00:00,000 --> 00:00:02,000\nHello world';
+
+      global.fetch.mockResolvedValueOnce({
+        ok: true,
+        json: async () => ({ srt: sampleSrt, vtt: 'WEBVTT\n\n' + sampleSrt })
+      });
+      // Second call: /api/process-video (mux_subtitles) returns video
+      global.fetch.mockResolvedValueOnce({
+        ok: true,
+        arrayBuffer: async () => new ArrayBuffer(8)
+      });
+
+      const result = await toolFunctions.generate_captions(
+        { language: 'en', soft_subtitles: true },
+        mockVideoFileData,
+        mockSetVideoFileData,
+        mockAddMessage
+      );
+
+      expect(result).toContain('without re-encoding');
+      const form = global.fetch.mock.calls[1][1].body;
+      expect(form.data.operation).toBe('mux_subtitles');
+      expect(JSON.parse(form.data.args)).toMatchObject({ srtContent: sampleSrt, language: 'en' });
+      expect(mockSetVideoFileData).toHaveBeenCalled();
+      const videoMessage = mockAddMessage.mock.calls[2];
+      expect(videoMessage[7]).toEqual([expect.objectContaining({ srcLang: 'en', label: 'en', default: true })]);
+    });
+
+    it('should report streamed caption chunks as progress', async () => {
+      const chunkSrt = '1\n00:00:00,000 --> 00:00:02,000\nHello world';
+      const events = [
+        'event: status\ndata: {"chunks":2}\n\n',
+        `event: cues\ndata: ${JSON.stringify({ index: 0, start: 0, srt: chunkSrt, cues: [{ start: 0, end: 2, text: 'Hello world' }] })}\n\n`,
+        `event: cues\ndata: ${JSON.stringify({ index: 1, start: 60, srt: '', cues: [] })}\n\nevent: done\ndata: ${JSON.stringify({ srt: chunkSrt, vtt: 'WEBVTT' })}\n\n`
+      ].map((text) => new TextEncoder().encode(text));
+      global.fetch.mockResolvedValueOnce({
+        ok: true,
+        headers: { get: (name) => (name === 'content-type' ? 'text/event-stream' : null) },
+        body: {
+          getReader: () => ({
+            read: async () => (events.length ? { done: false, value: events.shift() } : { done: true, value: undefined }),
+            cancel: async () => {}
+          })
+        }
+      });
+      const progress = [];
+      setRenderProgressListener((update) => progress.push(update));
+
+      try {
+        const result = await toolFunctions.generate_captions(
+          { burn_in: false },
+          mockVideoFileData,
+          mockSetVideoFileData,
+          mockAddMessage
+        );
+
+        expect(result).toContain('Captions generated');
+        expect(global.fetch.mock.calls[0][1].headers.Accept).toContain('text/event-stream');
+        expect(progress).toEqual([
+          { operation: 'generate_captions', percent: 50, preview: 'Hello world' },
+          { operation: 'generate_captions', percent: 100, preview: undefined },
+          null
+        ]);
+      } finally {
+        setRenderProgressListener(null);
+      }
+    });
+
     it('should handle caption generation failure gracefully', async () => {
       global.fetch.mockResolvedValueOnce({
         ok: false,
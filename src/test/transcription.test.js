@@ -0,0 +1,50 @@
+import { describe, it, expect } from 'vitest';
+import { parseSilences, planTranscriptionChunks, transcribeChunks } from '../transcription.js';
+
+describe('transcription', () => {
+  it('reads silent intervals from the silencedetect log', () => {
+    const log = [
+      '[silencedetect @ 0x1] silence_start: -0.01',
+      '[silencedetect @ 0x1] silence_end: 0.8 | silence_duration: 0.81',
+      'size=N/A time=00:01:00.00',
+      '[silencedetect @ 0x1] silence_start: 58.2',
+      '[silencedetect @ 0x1] silence_end: 59 | silence_duration: 0.8'
+    ].join('\n');
+    expect(parseSilences(log)).toEqual([{ start: 0, end: 0.8 }, { start: 58.2, end: 59 }]);
+  });
+
+  it('cuts chunks in the silence nearest to the target length', () => {
+    const silences = [{ start: 40, end: 41 }, { start: 58, end: 60 }, { start: 100, end: 101 }, { start: 125, end: 126 }];
+    expect(planTranscriptionChunks(silences, 200, { targetSeconds: 60 })).toEqual([
+      { start: 0, end: 59 },
+      { start: 59, end: 125.5 },
+      { start: 125.5, end: 200 }
+    ]);
+  });
+
+  it('cuts mid-speech only when there is no silence to cut at', () => {
+    expect(planTranscriptionChunks([], 300, { targetSeconds: 60 })).toEqual([
+      { start: 0, end: 60 },
+      { start: 60, end: 120 },
+      { start: 120, end: 180 },
+      { start: 180, end: 300 }
+    ]);
+    expect(planTranscriptionChunks([], 90, { targetSeconds: 60 })).toEqual([{ start: 0, end: 90 }]);
+  });
+
+  it('merges chunk transcripts in media time and reports each chunk as it completes', async () => {
+    const chunks = [{ start: 0, end: 60 }, { start: 60, end: 120 }];
+    const completed = [];
+    const cues = await transcribeChunks(chunks, {
+      parallelism: 2,
+      transcribe: async (chunk) => {
+        // The second chunk finishes first
+        await new Promise((resolve) => setTimeout(resolve, chunk.start === 0 ? 10 : 1));
+        return `1\n00:00:01,000 --> 00:00:02,000\nat ${chunk.start}`;
+      },
+      onChunk: (index, chunkCues) => completed.push([index, chunkCues[0].start])
+    });
+    expect(completed).toEqual([[1, 61], [0, 1]]);
+    expect(cues.map((cue) => cue.text)).toEqual(['at 0', 'at 60']);
+  });
+});
@@ -0,0 +1,158 @@
+import { describe, it, expect, vi, beforeEach, afterEach } from 'vitest';
+import { promises as fs } from 'fs';
+import os from 'os';
+import path from 'path';
+import { ScratchArena } from '../scratch.js';
+import {
+  XFADE_TRANSITIONS,
+  isTransitionType,
+  parseFrameRate,
+  targetFormat,
+  conformsToTarget,
+  planClipWindows,
+  xfadeOffsets,
+  buildXfadeFilter,
+  prepareTransition
+} from '../transitionEngine.js';
+
+describe('transitionEngine', () => {
+  const stream = { codec_name: 'h264', pix_fmt: 'yuv420p', width: 1920, height: 1080, avg_frame_rate: '30000/1001' };
+
+  it('maps every transition type to an xfade transition', () => {
+    expect(isTransitionType('wipe_left')).toBe(true);
+    expect(isTransitionType('toString')).toBe(false);
+    expect(XFADE_TRANSITIONS.fade).toBe('fadeblack');
+  });
+
+  it('takes the target format from the first clip', () => {
+    expect(parseFrameRate('30000/1001')).toBeCloseTo(29.97, 2);
+    expect(parseFrameRate('0/0')).toBe(null);
+    expect(targetFormat([{ ...stream, width: 1919 }, null])).toEqual({ width: 1920, height: 1080, fps: 29.97 });
+    expect(targetFormat([{ width: 640, height: 360 }]).fps).toBe(30);
+  });
+
+  it('copies only clips already in the target format', () => {
+    const target = targetFormat([stream]);
+    expect(conformsToTarget(stream, target)).toBe(true);
+    expect(conformsToTarget({ ...stream, codec_name: 'hevc' }, target)).toBe(false);
+    expect(conformsToTarget({ ...stream, width: 1280, height: 720 }, target)).toBe(false);
+    expect(conformsToTarget({ ...stream, avg_frame_rate: '25/1' }, target)).toBe(false);
+    expect(conformsToTarget(null, target)).toBe(false);
+  });
+
+  it('cuts clips at keyframes that leave full transition windows', () => {
+    const keyframes = [0, 2, 4, 6, 8];
+    expect(planClipWindows(keyframes, 10, 1, { first: true, last: false })).toEqual({ headEnd: 0, tailStart: 8 });
+    expect(planClipWindows(keyframes, 10, 1, { first: false, last: false })).toEqual({ headEnd: 2, tailStart: 8 });
+    expect(planClipWindows(keyframes, 10, 1, { first: false, last: true })).toEqual({ headEnd: 2, tailStart: 10 });
+    expect(planClipWindows(keyframes, 10, 2.5, { first: false, last: false })).toEqual({ headEnd: 4, tailStart: 6 });
+  });
+
+  it('reports clips whose keyframes cannot be split around their transitions', () => {
+    expect(planClipWindows([0], 10, 1, { first: false, last: false })).toBe(null);
+    expect(planClipWindows([0, 5], 6, 1.5, { first: false, last: false })).toBe(null);
+    // A last clip with a single GOP joins its transition whole
+    expect(planClipWindows([0], 10, 1, { first: false, last: true })).toEqual({ headEnd: 10, tailStart: 10 });
+  });
+
+  it('offsets each xfade by the joined length minus the transition', () => {
+    expect(xfadeOffsets([5, 4, 6], 1)).toEqual([4, 7]);
+  });
+
+  it('builds a single xfade and acrossfade graph over all clips', () => {
+    const filter = buildXfadeFilter({
+      durations: [5, 4, 6],
+      hasAudio: [true, false, true],
+      transition: 'wipe_left',
+      transitionDuration: 1,
+      target: { width: 1280, height: 720, fps: 30 }
+    });
+    expect(filter).toContain('[v0][v1]xfade=transition=wipeleft:duration=1.000000:offset=4.000000[vx1]');
+    expect(filter).toContain('[vx1][v2]xfade=transition=wipeleft:duration=1.000000:offset=7.000000[v]');
+    expect(filter).toContain('anullsrc=r=48000:cl=stereo,atrim=duration=4.000000');
+    expect(filter).toContain('[ax1][a2]acrossfade=d=1.000000[a]');
+  });
+});
+
+describe('prepareTransition', () => {
+  let root;
+  let scratch;
+  // Two 10 s clips in the same format but from encoders with different profiles
+  const clipOf = (name, profile) => ({
+    path: `/clips/${name}.mp4`,
+    metadata: {
+      format: { duration: '10' },
+      streams: [{ codec_type: 'video', codec_name: 'h264', profile, pix_fmt: 'yuv420p', width: 1280, height: 720, avg_frame_rate: '30/1' }]
+    }
+  });
+  const clips = [clipOf('high', 'High'), clipOf('main', 'Main')];
+  const prepare = (probeParameterSets, runFfmpeg) => prepareTransition({
+    clips,
+    transition: 'crossfade',
+    transitionDuration: 1,
+    runFfmpeg,
+    videoEncodeOptions: ['-preset', 'veryfast', '-crf', '18'],
+    findKeyframes: async () => [0, 2, 4, 6, 8],
+    probeParameterSets,
+    scratch
+  });
+
+  beforeEach(async () => {
+    root = await fs.mkdtemp(path.join(os.tmpdir(), 'finalcut-transition-test-'));
+    scratch = new ScratchArena({ dir: root });
+  });
+
+  afterEach(async () => {
+    await fs.rm(root, { recursive: true, force: true });
+  });
+
+  it('normalizes a clip whose copied body has other parameter sets than the windows', async () => {
+    let mainBodyProbes = 0;
+    // The Main-profile body only matches the x264 windows once the clip has been normalized
+    const probeParameterSets = async (segmentPath) => (segmentPath.endsWith('body-1.ts') && mainBodyProbes++ === 0 ? 'MD5:main' : 'MD5:x264');
+    const runFfmpeg = vi.fn(async () => {});
+    const { cleanup } = await prepare(probeParameterSets, runFfmpeg);
+
+    // body 0, window 0->1 and body 1; then the normalization of clip 1 and all three again
+    expect(runFfmpeg).toHaveBeenCalledTimes(7);
+    expect(scratch.stats().jobs).toBe(1);
+    await cleanup();
+    expect(scratch.stats().jobs).toBe(0);
+  });
+
+  it('looks for keyframes relative to each clip\'s start time', async () => {
+    const calls = [];
+    await prepareTransition({
+      clips: [
+        { ...clips[0], metadata: { ...clips[0].metadata, format: { duration: '10', start_time: '1.400000' } } },
+        { ...clips[1], metadata: { ...clips[1].metadata, streams: [{ ...clips[1].metadata.streams[0], width: 640, height: 360 }] } }
+      ],
+      transition: 'crossfade',
+      transitionDuration: 1,
+      runFfmpeg: async () => {},
+      videoEncodeOptions: [],
+      findKeyframes: async (videoPath, duration, transitionDuration, options) => {
+        calls.push([path.basename(videoPath), options]);
+        return [0, 2, 4, 6, 8];
+      },
+      probeParameterSets: async () => 'MD5:x264',
+      scratch
+    });
+
+    // The second clip is scaled to the first one's size, and its normalized copy starts at 0
+    expect(calls).toEqual([
+      ['high.mp4', { startTime: 1.4 }],
+      ['clip-1.mp4', { startTime: 0 }]
+    ]);
+  });
+
+  it('joins everything in one pass when the parts still disagree', async () => {
+    const probeParameterSets = async (segmentPath) => (segmentPath.endsWith('body-1.ts') ? 'MD5:main' : 'MD5:x264');
+    const runFfmpeg = vi.fn(async () => {});
+    await prepare(probeParameterSets, runFfmpeg);
+
+    expect(runFfmpeg).toHaveBeenCalledTimes(7);
+    // The single-pass command reads the clips themselves, so no intermediates are kept
+    expect(scratch.stats().jobs).toBe(0);
+  });
+});
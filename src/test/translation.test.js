@@ -0,0 +1,86 @@
+import { describe, it, expect, vi } from 'vitest';
+import { batchCues, parseTranslatedBatch, translateSrt, TranslationCache } from '../translation.js';
+
+const SRT = [
+  '1\n00:00:01,000 --> 00:00:02,500\nHello',
+  '2\n00:00:03,000 --> 00:00:04,000\nHow are you?',
+  '3\n00:00:05,000 --> 00:00:06,000\nGood\nbye'
+].join('\n\n');
+
+// Fake model: prefixes every line with the language
+const fakeTranslate = async (texts, language) => texts.map((text) => `[${language}] ${text}`);
+
+describe('translation', () => {
+  it('splits cues into batches', () => {
+    expect(batchCues([1, 2, 3, 4, 5], 2)).toEqual([[1, 2], [3, 4], [5]]);
+  });
+
+  it('reads the JSON array answer, rejecting a line count mismatch', () => {
+    expect(parseTranslatedBatch('```json\n["Hola", "Adiós"]\n```', 2)).toEqual(['Hola', 'Adiós']);
+    expect(() => parseTranslatedBatch('["Hola"]', 2)).toThrow(/1 lines for 2 cues/);
+    expect(() => parseTranslatedBatch('Hola', 1)).toThrow(/not a JSON array/);
+  });
+
+  it('keeps the original timings and translates every language', async () => {
+    const translateBatch = vi.fn(fakeTranslate);
+    const result = await translateSrt(SRT, ['es', 'fr'], { translateBatch, batchSize: 2, parallelism: 4 });
+    expect(translateBatch).toHaveBeenCalledTimes(4);
+    expect(result.es).toBe([
+      '1\n00:00:01,000 --> 00:00:02,500\n[es] Hello',
+      '2\n00:00:03,000 --> 00:00:04,000\n[es] How are you?',
+      '3\n00:00:05,000 --> 00:00:06,000\n[es] Good\nbye'
+    ].join('\n\n'));
+    expect(result.fr).toContain('00:00:05,000 --> 00:00:06,000\n[fr] Good\nbye');
+  });
+
+  it('runs batches of all languages concurrently up to the parallelism', async () => {
+    let active = 0;
+    let peak = 0;
+    const translateBatch = async (texts, language) => {
+      peak = Math.max(peak, ++active);
+      await new Promise((resolve) => setTimeout(resolve, 5));
+      active--;
+      return fakeTranslate(texts, language);
+    };
+    await translateSrt(SRT, ['es', 'fr', 'de'], { translateBatch, batchSize: 1, parallelism: 4 });
+    expect(peak).toBe(4);
+  });
+
+  it('caches per SRT and language and shares in-flight translations', async () => {
+    const cache = new TranslationCache();
+    const translate = vi.fn((srt, languages) => translateSrt(srt, languages, { translateBatch: fakeTranslate }));
+
+    const [first, second] = await Promise.all([
+      cache.get(SRT, ['es'], translate),
+      cache.get(SRT, ['es', 'fr'], translate)
+    ]);
+    expect(translate).toHaveBeenCalledTimes(2);
+    expect(translate.mock.calls[1][1]).toEqual(['fr']);
+    expect(second.es).toBe(first.es);
+
+    // Renumbered and CRLF content is the same captions
+    const again = await cache.get(SRT.replace(/\n/g, '\r\n').replace(/^1$/m, '7'), ['fr', 'es'], translate);
+    expect(translate).toHaveBeenCalledTimes(2);
+    expect(again.fr).toBe(second.fr);
+    expect(cache.stats()).toMatchObject({ entries: 2, misses: 2 });
+  });
+
+  it('does not cache failed translations', async () => {
+    const cache = new TranslationCache();
+    await expect(cache.get(SRT, ['es'], async () => { throw new Error('xAI API error'); })).rejects.toThrow('xAI API error');
+    const result = await cache.get(SRT, ['es'], (srt, languages) => translateSrt(srt, languages, { translateBatch: fakeTranslate }));
+    expect(result.es).toContain('[es] Hello');
+  });
+
+  it('evicts the least recently used translation', async () => {
+    const cache = new TranslationCache({ maxEntries: 2 });
+    const translate = vi.fn((srt, languages) => translateSrt(srt, languages, { translateBatch: fakeTranslate }));
+    await cache.get(SRT, ['es', 'fr'], translate);
+    await cache.get(SRT, ['es'], translate);
+    await cache.get(SRT, ['de'], translate);
+    await cache.get(SRT, ['es'], translate);
+    expect(translate).toHaveBeenCalledTimes(2);
+    await cache.get(SRT, ['fr'], translate);
+    expect(translate).toHaveBeenCalledTimes(3);
+  });
+});
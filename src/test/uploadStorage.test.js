@@ -0,0 +1,50 @@
+import { describe, it, expect, beforeEach, afterEach } from 'vitest';
+import { EventEmitter } from 'events';
+import { promises as fs } from 'fs';
+import os from 'os';
+import path from 'path';
+import { PassThrough, Readable } from 'stream';
+import { AssetStore } from '../assetStore.js';
+import { assetStoreStorage } from '../uploadStorage.js';
+
+describe('assetStoreStorage', () => {
+  let dir;
+  let store;
+  let storage;
+
+  const handleFile = (req, file) => new Promise((resolve, reject) => {
+    storage._handleFile(req, file, (err, info) => (err ? reject(err) : resolve(info)));
+  });
+
+  beforeEach(async () => {
+    dir = await fs.mkdtemp(path.join(os.tmpdir(), 'finalcut-upload-test-'));
+    store = new AssetStore({ dir });
+    await store.init();
+    storage = assetStoreStorage({ store, extForMimeType: () => 'mp4' });
+  });
+
+  afterEach(async () => {
+    await fs.rm(dir, { recursive: true, force: true });
+  });
+
+  it('streams a part into the store and holds it until the response closes', async () => {
+    const res = new EventEmitter();
+    const info = await handleFile({ res }, { mimetype: 'video/mp4', stream: Readable.from([Buffer.from('clip '), Buffer.from('bytes')]) });
+
+    expect(info.size).toBe(10);
+    expect(await fs.readFile(info.asset.path, 'utf8')).toBe('clip bytes');
+    expect(info.asset.refs).toBe(1);
+    res.emit('close');
+    expect(info.asset.refs).toBe(0);
+  });
+
+  it('does not store a part truncated by the size limit', async () => {
+    const stream = new PassThrough();
+    const stored = handleFile({ res: new EventEmitter() }, { mimetype: 'video/mp4', stream });
+    stream.write(Buffer.from('partial'));
+    stream.emit('limit');
+
+    await expect(stored).rejects.toThrow('File too large');
+    expect(store.assets.size).toBe(0);
+  });
+});
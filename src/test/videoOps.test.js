@@ -0,0 +1,103 @@
+import { describe, it, expect } from 'vitest';
+import { compileOperations, mergeEqFilters, isFilterOperation, expectedOutputDuration, parseTimeToSeconds, canEncodeInSegments, audioChunkSettleSeconds, normalizesInputLoudness } from '../videoOps.js';
+
+describe('videoOps', () => {
+  it('compiles a single operation into its filters', () => {
+    expect(compileOperations([{ operation: 'adjust_volume', args: { volume: 1.5 } }])).toEqual({
+      videoFilters: [],
+      audioFilters: ['volume=1.5']
+    });
+  });
+
+  it('compiles a batch into one chain per stream, preserving order', () => {
+    const compiled = compileOperations([
+      { operation: 'adjust_brightness', args: { brightness: 0.1 } },
+      { operation: 'bass_adjustment', args: { gain: 5 } },
+      { operation: 'adjust_saturation', args: { saturation: 1.5 } },
+      { operation: 'flip_video_horizontal', args: {} },
+      { operation: 'adjust_volume', args: { volume: 2 } }
+    ]);
+    expect(compiled.videoFilters).toEqual(['eq=brightness=0.1:saturation=1.5', 'hflip']);
+    expect(compiled.audioFilters).toEqual(['bass=g=5', 'volume=2']);
+  });
+
+  it('splits speed changes across both streams', () => {
+    const compiled = compileOperations([{ operation: 'speed_video', args: { speed: 4 } }]);
+    expect(compiled.videoFilters).toEqual(['setpts=PTS/4']);
+    expect(compiled.audioFilters).toEqual(['atempo=2.0', 'atempo=2']);
+  });
+
+  it('only merges eq filters with disjoint parameters', () => {
+    expect(mergeEqFilters(['eq=brightness=0.1', 'eq=brightness=0.2'])).toEqual(['eq=brightness=0.1', 'eq=brightness=0.2']);
+    expect(mergeEqFilters(['eq=brightness=0.1', 'hue=h=30', 'eq=saturation=2'])).toEqual(['eq=brightness=0.1', 'hue=h=30', 'eq=saturation=2']);
+    expect(mergeEqFilters(['eq=saturation=2', 'eq=brightness=0.1', 'eq=contrast=1.2'])).toEqual(['eq=saturation=2:brightness=0.1:contrast=1.2']);
+  });
+
+  it('rejects unknown, non-filter and empty batches', () => {
+    expect(isFilterOperation('trim_video')).toBe(false);
+    expect(isFilterOperation('__proto__')).toBe(false);
+    expect(() => compileOperations([{ operation: 'trim_video', args: {} }])).toThrow('trim_video');
+    expect(() => compileOperations([])).toThrow();
+    expect(() => compileOperations(undefined)).toThrow();
+  });
+
+  it('estimates output duration for progress reporting', () => {
+    expect(expectedOutputDuration(10, 'adjust_hue', { degrees: 30 })).toBe(10);
+    expect(expectedOutputDuration(10, 'trim_video', { start: 2, end: 5 })).toBe(3);
+    expect(expectedOutputDuration(10, 'trim_video', { start: '00:00:02', end: '7' })).toBe(5);
+    expect(expectedOutputDuration(10, 'apply_operations', {
+      operations: [{ operation: 'speed_video', args: { speed: 2 } }, { operation: 'adjust_hue', args: {} }]
+    })).toBe(5);
+    expect(expectedOutputDuration(null, 'adjust_hue', {})).toBeNull();
+  });
+
+  it('parses seconds and timestamps', () => {
+    expect(parseTimeToSeconds(12.5)).toBe(12.5);
+    expect(parseTimeToSeconds('10')).toBe(10);
+    expect(parseTimeToSeconds('01:02.5')).toBe(62.5);
+    expect(parseTimeToSeconds('01:00:10')).toBe(3610);
+    expect(parseTimeToSeconds('')).toBeNaN();
+    expect(parseTimeToSeconds('abc')).toBeNaN();
+  });
+
+  it('encodes only position-independent operations in segments', () => {
+    expect(canEncodeInSegments([
+      { operation: 'adjust_hue', args: { degrees: 90 } },
+      { operation: 'speed_video', args: { speed: 2 } },
+      { operation: 'audio_reverse' }
+    ])).toBe(true);
+    expect(canEncodeInSegments([{ operation: 'fade_transition', args: { duration: 1, totalDuration: 10 } }])).toBe(false);
+    expect(canEncodeInSegments([{ operation: 'trim_video' }])).toBe(false);
+  });
+
+  it('pre-rolls chunked audio long enough for every filter to settle', () => {
+    expect(audioChunkSettleSeconds([
+      { operation: 'audio_chorus', args: { delays: '40|120' } },
+      { operation: 'audio_compressor', args: { attack: '20', release: '380' } }
+    ])).toBeCloseTo(2, 5);
+    expect(audioChunkSettleSeconds([{ operation: 'equalizer', args: { frequency: 1000, gain: 3 } }])).toBe(0.1);
+    expect(audioChunkSettleSeconds([{ operation: 'normalize_audio', args: {} }])).toBe(null);
+    expect(audioChunkSettleSeconds([{ operation: 'adjust_hue', args: { degrees: 30 } }])).toBe(null);
+  });
+
+  it('normalizes audio in linear mode when loudness stats are measured', () => {
+    const operations = [{ operation: 'normalize_audio', args: { target: -14 } }];
+    expect(compileOperations(operations).audioFilters).toEqual(['loudnorm=I=-14:TP=-1.5:LRA=11']);
+    const loudness = { inputI: -20, inputTp: -3, inputLra: 7, inputThresh: -30 };
+    expect(compileOperations(operations, { loudness }).audioFilters[0]).toContain(':measured_I=-20:');
+  });
+
+  it('normalizes in single-pass mode when an earlier operation changed the audio', () => {
+    const loudness = { inputI: -20, inputTp: -3, inputLra: 7, inputThresh: -30 };
+    const operations = [
+      { operation: 'adjust_volume', args: { volume: 2 } },
+      { operation: 'normalize_audio', args: { target: -14 } }
+    ];
+    expect(compileOperations(operations, { loudness }).audioFilters).toEqual(['volume=2', 'loudnorm=I=-14:TP=-1.5:LRA=11']);
+    expect(normalizesInputLoudness(operations)).toBe(false);
+
+    const videoFirst = [{ operation: 'adjust_hue', args: { degrees: 30 } }, operations[1]];
+    expect(compileOperations(videoFirst, { loudness }).audioFilters[0]).toContain(':measured_I=-20:');
+    expect(normalizesInputLoudness(videoFirst)).toBe(true);
+  });
+});
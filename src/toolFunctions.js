@@ -1,5 +1,6 @@
 // Server-side video processing tool functions
 // These functions call the server API instead of using client-side FFmpeg
+import { parseServerTiming } from './serverTiming.js';
 
 // Aspect ratio presets for social media platforms
 const ASPECT_RATIO_PRESETS = {
@@ -27,6 +28,8 @@ const AUDIO_MIME_TYPES = {
 let sampleModeEnabled = false;
 let sampleModeAccessToken = null;
 let currentFileMimeType = 'video/mp4';
+let renderProgressListener = null;
+let serverTimingListener = null;
 
 export function setSampleModeEnabled(enabled) {
   sampleModeEnabled = Boolean(enabled);
@@ -40,6 +43,47 @@ export function setCurrentFileMimeType(mimeType) {
   currentFileMimeType = (typeof mimeType === 'string' && mimeType) ? mimeType : 'video/mp4';
 }
 
+// When a listener is set, renders run as background jobs and the listener receives their
+// progress ({ operation, percent, etaSeconds, ... }), then null once the render settles.
+export function setRenderProgressListener(listener) {
+  renderProgressListener = typeof listener === 'function' ? listener : null;
+}
+
+// The listener receives the Server-Timing breakdown of each media response once its body has
+// been read: { operation, metrics: [{ name, dur, desc }] }, ending with the total seen here
+export function setServerTimingListener(listener) {
+  serverTimingListener = typeof listener === 'function' ? listener : null;
+}
+
+function reportServerTiming(operation, header, startedAt, endedAt = performance.now()) {
+  const metrics = parseServerTiming(header);
+  if (!serverTimingListener || metrics.length === 0) return;
+  metrics.push({ name: 'total', dur: endedAt - startedAt });
+  serverTimingListener({ operation, metrics });
+}
+
+// Streamed outputs are still encoding when their headers arrive, so they carry no Server-Timing
+// header; their breakdown is fetched by output id once the body has been read
+async function reportResponseTiming(operation, response, startedAt) {
+  if (!serverTimingListener) return;
+  const endedAt = performance.now();
+  let header = getResponseHeader(response, 'server-timing');
+  const outputId = getResponseHeader(response, 'x-output-asset-id');
+  if (!header && outputId) {
+    try {
+      const timingResponse = await fetch(`/api/outputs/${encodeURIComponent(outputId)}/timing`, { headers: getSampleAuthHeaders() });
+      if (timingResponse.ok) header = (await timingResponse.json()).serverTiming;
+    } catch {
+      // The breakdown is informational; the output itself has arrived
+    }
+  }
+  reportServerTiming(operation, header, startedAt, endedAt);
+}
+
+function getSampleAuthHeaders() {
+  return sampleModeEnabled && sampleModeAccessToken ? { 'sample-access-token': sampleModeAccessToken } : {};
+}
+
 function normalizeAudioFileInput(audioFile) {
   if (typeof audioFile === 'string') {
     const trimmed = audioFile.trim();
@@ -84,29 +128,230 @@ async function collectStreamChunks(reader) {
   return result;
 }
 
+// Server asset ids of media buffers the server already holds. Chained edits reference
+// the previous result by id instead of uploading the same bytes again.
+const serverAssetIds = new WeakMap();
+
+function rememberServerAsset(data, assetId) {
+  if (data && typeof data === 'object' && typeof assetId === 'string' && assetId) {
+    serverAssetIds.set(data, assetId);
+  }
+}
+
+// POST /api/assets requests still in flight, by media buffer
+const assetRegistrations = new WeakMap();
+
+// Store newly loaded media on the server ahead of the first edit, so the server can start
+// rendering its proxy right away and the edit references it by id. Best effort: if it fails,
+// the first edit uploads the bytes as before.
+export function registerServerAsset(data, mimeType = currentFileMimeType) {
+  if (!data || typeof data !== 'object' || serverAssetIds.has(data)) return Promise.resolve();
+  if (!assetRegistrations.has(data)) {
+    const registration = fetch('/api/assets', {
+      method: 'POST',
+      headers: { 'Content-Type': mimeType, ...getSampleAuthHeaders() },
+      body: data
+    })
+      .then(async (response) => {
+        if (response.ok) rememberServerAsset(data, (await response.json()).assetId);
+      })
+      .catch((error) => console.warn('Asset upload failed:', error.message))
+      .finally(() => assetRegistrations.delete(data));
+    assetRegistrations.set(data, registration);
+  }
+  return assetRegistrations.get(data);
+}
+
+// Outputs rendered from a low-resolution proxy of a large video. Their edits are replayed
+// on the original by export_video.
+const proxyRenders = new WeakSet();
+
+export function isProxyRender(data) {
+  return Boolean(data && typeof data === 'object' && proxyRenders.has(data));
+}
+
+function getResponseHeader(response, name) {
+  return response.headers?.get?.(name) || null;
+}
+
+// POST media as the raw request body, or just its asset id when the server already has it.
+// Falls back to uploading the bytes if the server has since evicted the asset.
+async function postMedia(url, headers, videoFileData) {
+  await assetRegistrations.get(videoFileData);
+  const assetId = videoFileData ? serverAssetIds.get(videoFileData) : undefined;
+  if (assetId) {
+    const response = await fetch(url, { method: 'POST', headers: { ...headers, 'x-asset-id': assetId } });
+    if (response.status !== 404) return response;
+    serverAssetIds.delete(videoFileData);
+  }
+
+  const response = await fetch(url, { method: 'POST', headers, body: videoFileData });
+  rememberServerAsset(videoFileData, getResponseHeader(response, 'x-input-asset-id'));
+  return response;
+}
+
+// POST a multipart form whose 'video' part is replaced by an 'assetId' field when the
+// server already holds the video. buildForm(formData) appends the remaining fields.
+async function postMediaForm(url, headers, videoFileData, fileMimeType, buildForm) {
+  const send = (assetId) => {
+    const formData = new FormData();
+    if (assetId) {
+      formData.append('assetId', assetId);
+    } else {
+      formData.append('video', new Blob([videoFileData], { type: fileMimeType }), 'input.mp4');
+    }
+    buildForm(formData);
+    return fetch(url, { method: 'POST', headers, body: formData });
+  };
+
+  await assetRegistrations.get(videoFileData);
+  const assetId = videoFileData ? serverAssetIds.get(videoFileData) : undefined;
+  if (assetId) {
+    const response = await send(assetId);
+    if (response.status !== 404) return response;
+    serverAssetIds.delete(videoFileData);
+  }
+  return send(null);
+}
+
+// Read a Server-Sent Events response, calling onEvent(event, payload) for each JSON event.
+// Stops early and resolves with the first value onEvent returns other than undefined.
+async function readServerSentEvents(response, onEvent) {
+  const reader = response.body.getReader();
+  const decoder = new TextDecoder();
+  let buffer = '';
+  while (true) {
+    const { done, value } = await reader.read();
+    if (done) return undefined;
+    buffer += decoder.decode(value, { stream: true });
+
+    const events = buffer.split('\n\n');
+    buffer = events.pop() || '';
+    for (const rawEvent of events) {
+      let event = 'message';
+      let data = '';
+      for (const line of rawEvent.split('\n')) {
+        if (line.startsWith('event: ')) event = line.slice(7).trim();
+        else if (line.startsWith('data: ')) data += line.slice(6);
+      }
+      if (!data) continue;
+      const result = onEvent(event, JSON.parse(data));
+      if (result !== undefined) {
+        if (reader.cancel) reader.cancel().catch(() => {});
+        return result;
+      }
+    }
+  }
+}
+
+// Follow a render job's Server-Sent Events until it finishes. Resolves with the output
+// asset ({ assetId, size, mimeType }) and forwards progress events to the listener.
+async function waitForRenderJob(jobId, operation) {
+  const response = await fetch(`/api/jobs/${jobId}/events`, { headers: getSampleAuthHeaders() });
+  if (!response.ok) {
+    throw new Error(`Render job status unavailable (${response.status})`);
+  }
+
+  const result = await readServerSentEvents(response, (event, payload) => {
+    if (event === 'progress' && renderProgressListener) renderProgressListener({ operation, ...payload });
+    if (event === 'done') return payload;
+    if (event === 'failed') throw new Error(payload.error || 'Render job failed');
+    return undefined;
+  });
+  if (!result) throw new Error('Render job ended without a result');
+  return result;
+}
+
+// Read a caption response: streamed chunk events report progress (and the latest caption
+// text) to the listener as chunks are transcribed; plain JSON is returned as is.
+async function readCaptionResponse(response) {
+  if (!(getResponseHeader(response, 'content-type') || '').includes('text/event-stream')) {
+    return response.json();
+  }
+  let chunks = 0;
+  let transcribed = 0;
+  try {
+    const result = await readServerSentEvents(response, (event, payload) => {
+      if (event === 'status') chunks = payload.chunks;
+      if (event === 'cues') {
+        transcribed++;
+        const preview = payload.cues?.[0]?.text;
+        if (renderProgressListener && chunks > 0) {
+          renderProgressListener({ operation: 'generate_captions', percent: Math.round((transcribed / chunks) * 100), preview });
+        }
+      }
+      if (event === 'done') return payload;
+      if (event === 'failed') throw new Error(payload.error || 'Failed to generate captions');
+      return undefined;
+    });
+    if (!result) throw new Error('Caption generation ended without a result');
+    return result;
+  } finally {
+    if (renderProgressListener) renderProgressListener(null);
+  }
+}
+
+// Run an operation as a background render job and download its output asset
+async function processVideoAsJob(operation, args, videoFileData) {
+  const startedAt = performance.now();
+  const response = await postMedia('/api/jobs', {
+    'Content-Type': currentFileMimeType || 'video/mp4',
+    'x-operation': operation,
+    'x-args': JSON.stringify(args),
+    ...getSampleAuthHeaders()
+  }, videoFileData);
+
+  if (!response.ok) {
+    const errorData = await response.json();
+    throw new Error(errorData.error || 'Server processing failed');
+  }
+
+  const { jobId } = await response.json();
+  try {
+    const result = await waitForRenderJob(jobId, operation);
+    const assetResponse = await fetch(`/api/assets/${result.assetId}`, { headers: getSampleAuthHeaders() });
+    if (!assetResponse.ok) {
+      throw new Error('Rendered output is no longer available');
+    }
+    const data = await collectStreamChunks(assetResponse.body.getReader());
+    rememberServerAsset(data, result.assetId);
+    if (result.proxy) proxyRenders.add(data);
+    reportServerTiming(operation, result.serverTiming, startedAt);
+    return data;
+  } finally {
+    if (renderProgressListener) renderProgressListener(null);
+  }
+}
+
 // Helper function to call server API using streaming:
 // video data is sent as the raw request body; operation, args, and file type go in headers.
 // Response is streamed via ReadableStream and accumulated into a Uint8Array.
+// With a progress listener set, the render runs as a background job instead.
 async function processVideoOnServer(operation, args, videoFileData) {
+  if (renderProgressListener) {
+    return processVideoAsJob(operation, args, videoFileData);
+  }
+
   const fileMimeType = currentFileMimeType || 'video/mp4';
 
-  const response = await fetch('/api/process-video', {
-    method: 'POST',
-    headers: {
-      'Content-Type': fileMimeType,
-      'x-operation': operation,
-      'x-args': JSON.stringify(args),
-      ...(sampleModeEnabled && sampleModeAccessToken ? { 'sample-access-token': sampleModeAccessToken } : {})
-    },
-    body: videoFileData
-  });
+  const startedAt = performance.now();
+  const response = await postMedia('/api/process-video', {
+    'Content-Type': fileMimeType,
+    'x-operation': operation,
+    'x-args': JSON.stringify(args),
+    ...(sampleModeEnabled && sampleModeAccessToken ? { 'sample-access-token': sampleModeAccessToken } : {})
+  }, videoFileData);
 
   if (!response.ok) {
     const errorData = await response.json();
     throw new Error(errorData.error || 'Server processing failed');
   }
 
-  return collectStreamChunks(response.body.getReader());
+  const data = await collectStreamChunks(response.body.getReader());
+  rememberServerAsset(data, getResponseHeader(response, 'x-output-asset-id'));
+  if (getResponseHeader(response, 'x-proxy')) proxyRenders.add(data);
+  await reportResponseTiming(operation, response, startedAt);
+  return data;
 }
 
 export const toolFunctions = {
@@ -501,16 +746,12 @@ export const toolFunctions = {
   get_video_info: async (args, videoFileData, setVideoFileData, addMessage) => {
     try {
       const fileMimeType = currentFileMimeType || 'video/mp4';
-      const response = await fetch('/api/process-video', {
-        method: 'POST',
-        headers: {
-          'Content-Type': fileMimeType,
-          'x-operation': 'get_video_info',
-          'x-args': JSON.stringify({}),
-          ...(sampleModeEnabled && sampleModeAccessToken ? { 'sample-access-token': sampleModeAccessToken } : {})
-        },
-        body: videoFileData
-      });
+      const response = await postMedia('/api/process-video', {
+        'Content-Type': fileMimeType,
+        'x-operation': 'get_video_info',
+        'x-args': JSON.stringify({}),
+        ...(sampleModeEnabled && sampleModeAccessToken ? { 'sample-access-token': sampleModeAccessToken } : {})
+      }, videoFileData);
 
       if (!response.ok) {
         const errorData = await response.json();
@@ -558,19 +799,17 @@ export const toolFunctions = {
       const normalizedAudioFile = normalizeAudioFileInput(args.audioFile);
       // add_audio_track requires secondary binary audio input; use FormData so both files are sent together
       const fileMimeType = currentFileMimeType || 'video/mp4';
-      const formData = new FormData();
-      const videoBlob = new Blob([videoFileData], { type: fileMimeType });
-      formData.append('video', videoBlob, 'input.mp4');
-      formData.append('operation', 'add_audio_track');
-      formData.append('args', JSON.stringify({ audioFile: normalizedAudioFile, mode, volume }));
-
-      const response = await fetch('/api/process-video', {
-        method: 'POST',
-        headers: sampleModeEnabled && sampleModeAccessToken
+      const startedAt = performance.now();
+      const response = await postMediaForm('/api/process-video',
+        sampleModeEnabled && sampleModeAccessToken
           ? { 'sample-access-token': sampleModeAccessToken }
           : undefined,
-        body: formData
-      });
+        videoFileData,
+        fileMimeType,
+        (formData) => {
+          formData.append('operation', 'add_audio_track');
+          formData.append('args', JSON.stringify({ audioFile: normalizedAudioFile, mode, volume }));
+        });
 
       if (!response.ok) {
         const errorData = await response.json();
@@ -579,6 +818,8 @@ export const toolFunctions = {
 
       // Stream the response
       const data = await collectStreamChunks(response.body.getReader());
+      rememberServerAsset(data, getResponseHeader(response, 'x-output-asset-id'));
+      await reportResponseTiming('add_audio_track', response, startedAt);
 
       setVideoFileData(data);
       const videoUrl = URL.createObjectURL(new Blob([data.buffer], { type: 'video/mp4' }));
@@ -742,15 +983,20 @@ export const toolFunctions = {
 
       const formData = new FormData();
       
-      // Add all video files
-      videosToProcess.forEach((videoData, index) => {
+      // Add all video files, referencing clips the server already holds by asset id
+      const clipSources = videosToProcess.map((videoData, index) => {
+        const assetId = videoData && typeof videoData === 'object' ? serverAssetIds.get(videoData) : undefined;
+        if (assetId) return `asset:${assetId}`;
         const videoBlob = new Blob([videoData], { type: 'video/mp4' });
         formData.append('videos', videoBlob, `input-${index}.mp4`);
+        return 'file';
       });
       
+      formData.append('clipSources', JSON.stringify(clipSources));
       formData.append('transition', args.transition);
       formData.append('duration', args.duration || 1);
       
+      const startedAt = performance.now();
       const response = await fetch('/api/transition-videos', {
         method: 'POST',
         headers: sampleModeEnabled ? {
@@ -767,6 +1013,8 @@ export const toolFunctions = {
       // Get the processed video as array buffer
       const arrayBuffer = await response.arrayBuffer();
       const data = new Uint8Array(arrayBuffer);
+      rememberServerAsset(data, getResponseHeader(response, 'x-output-asset-id'));
+      await reportResponseTiming('transition_videos', response, startedAt);
       
       setVideoFileData(data); // Update video data for subsequent edits
       const videoUrl = URL.createObjectURL(new Blob([data.buffer], { type: 'video/mp4' }));
@@ -820,33 +1068,62 @@ export const toolFunctions = {
   get_video_dimensions: async (args, videoFileData, setVideoFileData, addMessage) => 
     toolFunctions.get_video_info(args, videoFileData, setVideoFileData, addMessage),
 
+  // Render the current edit at full quality. Editing continues on the preview, so the
+  // current video data is left unchanged.
+  export_video: async (args, videoFileData, setVideoFileData, addMessage) => {
+    try {
+      if (!videoFileData) {
+        throw new Error('There is no video to export');
+      }
+
+      const response = await postMedia('/api/export', {
+        'Content-Type': currentFileMimeType || 'video/mp4',
+        ...getSampleAuthHeaders()
+      }, videoFileData);
+      if (!response.ok) {
+        const errorData = await response.json();
+        throw new Error(errorData.error || 'Export failed');
+      }
+
+      const data = await collectStreamChunks(response.body.getReader());
+      rememberServerAsset(data, getResponseHeader(response, 'x-output-asset-id'));
+      const mimeType = getResponseHeader(response, 'content-type') || 'video/mp4';
+      const videoUrl = URL.createObjectURL(new Blob([data.buffer], { type: mimeType }));
+      addMessage('Exported video (full quality):', false, videoUrl, 'exported', mimeType);
+      return 'Video exported at full quality.';
+    } catch (error) {
+      addMessage('Error exporting video: ' + error.message, false);
+      return 'Failed to export video: ' + error.message;
+    }
+  },
+
   generate_captions: async (args, videoFileData, setVideoFileData, addMessage) => {
     try {
       const language = args.language || 'auto';
       const translateLanguage = args.translate_language || null;
       const style = args.style || 'default';
       const position = args.position || 'bottom';
-      const burnIn = args.burn_in !== false; // default true
+      const soft = args.soft_subtitles === true;
+      const burnIn = !soft && args.burn_in !== false; // default true unless muxing soft tracks
 
       const fileMimeType = currentFileMimeType || 'video/mp4';
 
       // Step 1: Generate captions via xAI speech-to-text
-      const captionResponse = await fetch('/api/generate-captions', {
-        method: 'POST',
-        headers: {
-          'Content-Type': fileMimeType,
-          'x-args': JSON.stringify({ language }),
-          ...(sampleModeEnabled && sampleModeAccessToken ? { 'sample-access-token': sampleModeAccessToken } : {})
-        },
-        body: videoFileData
-      });
+      const captionStartedAt = performance.now();
+      const captionResponse = await postMedia('/api/generate-captions', {
+        'Content-Type': fileMimeType,
+        'Accept': 'text/event-stream, application/json',
+        'x-args': JSON.stringify({ language }),
+        ...(sampleModeEnabled && sampleModeAccessToken ? { 'sample-access-token': sampleModeAccessToken } : {})
+      }, videoFileData);
 
       if (!captionResponse.ok) {
         const errorData = await captionResponse.json();
         throw new Error(errorData.error || 'Failed to generate captions');
       }
 
-      const { srt, vtt } = await captionResponse.json();
+      const { srt, vtt, serverTiming } = await readCaptionResponse(captionResponse);
+      reportServerTiming('generate_captions', serverTiming || getResponseHeader(captionResponse, 'server-timing'), captionStartedAt);
 
       if (!srt) {
         throw new Error('No captions were generated from the audio');
@@ -867,6 +1144,7 @@ export const toolFunctions = {
 
       // Step 3: Optionally translate captions using Grok chat
       let translatedSrt = null;
+      let translatedVttUrl = null;
       if (translateLanguage) {
         const translateResponse = await fetch('/api/translate-captions', {
           method: 'POST',
@@ -888,30 +1166,72 @@ export const toolFunctions = {
         // Offer translated subtitle files for download too
         const translatedSrtBlob = new Blob([translatedSrt], { type: 'text/plain' });
         const translatedVttBlob = new Blob([translationResult.vtt], { type: 'text/vtt' });
+        translatedVttUrl = URL.createObjectURL(translatedVttBlob);
         addMessage(`Translated subtitles (${translateLanguage}):`, false, URL.createObjectURL(translatedSrtBlob), 'subtitle-srt', 'text/plain');
-        addMessage(`Translated VTT file (${translateLanguage}):`, false, URL.createObjectURL(translatedVttBlob), 'subtitle-vtt', 'text/vtt');
+        addMessage(`Translated VTT file (${translateLanguage}):`, false, translatedVttUrl, 'subtitle-vtt', 'text/vtt');
       }
 
-      // Step 4: Optionally burn subtitles into the video
+      // Step 4a: Optionally mux the subtitles as selectable tracks (a remux, no re-encode)
+      if (soft) {
+        const muxStartedAt = performance.now();
+        const muxResponse = await postMediaForm('/api/process-video',
+          sampleModeEnabled && sampleModeAccessToken
+            ? { 'sample-access-token': sampleModeAccessToken }
+            : {},
+          videoFileData,
+          fileMimeType,
+          (formData) => {
+            formData.append('operation', 'mux_subtitles');
+            formData.append('args', JSON.stringify({
+              srtContent: srt,
+              language,
+              translatedSrtContent: translatedSrt,
+              translatedLanguage: translateLanguage
+            }));
+          });
+
+        if (!muxResponse.ok) {
+          const errorData = await muxResponse.json();
+          throw new Error(errorData.error || 'Failed to add subtitle tracks to video');
+        }
+
+        const data = new Uint8Array(await muxResponse.arrayBuffer());
+        rememberServerAsset(data, getResponseHeader(muxResponse, 'x-output-asset-id'));
+        await reportResponseTiming('mux_subtitles', muxResponse, muxStartedAt);
+        if (getResponseHeader(muxResponse, 'x-proxy')) proxyRenders.add(data);
+        setVideoFileData(data);
+        const videoUrl = URL.createObjectURL(new Blob([data.buffer], { type: 'video/mp4' }));
+        // The preview shows the cues through <track> elements, since browsers do not render mov_text
+        const textTracks = [{
+          src: vttUrl,
+          srcLang: language === 'auto' ? 'und' : language,
+          label: language === 'auto' ? 'Original' : language,
+          default: true
+        }];
+        if (translatedVttUrl) textTracks.push({ src: translatedVttUrl, srcLang: translateLanguage, label: translateLanguage });
+        addMessage(`Video with subtitle tracks (${textTracks.map((track) => track.label).join(', ')}):`, false, videoUrl, 'processed', 'video/mp4', false, null, textTracks);
+        return `Captions generated${translatedSrt ? ` and translated to ${translateLanguage}` : ''} (language: ${language === 'auto' ? 'auto-detected' : language}). Subtitles were added as selectable tracks without re-encoding the video. SRT and VTT files are also available for download.`;
+      }
+
+      // Step 4b: Optionally burn subtitles into the video
+      // (the video was stored by the caption request, so it is referenced by asset id here)
       if (burnIn) {
-        const formData = new FormData();
-        const videoBlob = new Blob([videoFileData], { type: fileMimeType });
-        formData.append('video', videoBlob, 'input.mp4');
-        formData.append('operation', 'burn_subtitles');
-        formData.append('args', JSON.stringify({
-          srtContent: srt,
-          translatedSrtContent: translatedSrt,
-          style,
-          position
-        }));
-
-        const burnResponse = await fetch('/api/process-video', {
-          method: 'POST',
-          headers: sampleModeEnabled && sampleModeAccessToken
+        const burnStartedAt = performance.now();
+        const burnResponse = await postMediaForm('/api/process-video',
+          sampleModeEnabled && sampleModeAccessToken
             ? { 'sample-access-token': sampleModeAccessToken }
             : {},
-          body: formData
-        });
+          videoFileData,
+          fileMimeType,
+          (formData) => {
+            formData.append('operation', 'burn_subtitles');
+            formData.append('args', JSON.stringify({
+              srtContent: srt,
+              translatedSrtContent: translatedSrt,
+              style,
+              position
+            }));
+          });
 
         if (!burnResponse.ok) {
           const errorData = await burnResponse.json();
@@ -920,6 +1240,8 @@ export const toolFunctions = {
 
         const arrayBuffer = await burnResponse.arrayBuffer();
         const data = new Uint8Array(arrayBuffer);
+        rememberServerAsset(data, getResponseHeader(burnResponse, 'x-output-asset-id'));
+        await reportResponseTiming('burn_subtitles', burnResponse, burnStartedAt);
         setVideoFileData(data);
         const videoUrl = URL.createObjectURL(new Blob([data.buffer], { type: 'video/mp4' }));
         const trackDesc = translatedSrt
@@ -936,3 +1258,81 @@ export const toolFunctions = {
     }
   },
 };
+
+const isSet = (value) => value !== null && value !== undefined;
+
+// Tools that map onto one server filter operation. Consecutive calls to these within a
+// single model turn are sent as one apply_operations request and share a single encode.
+// valid() mirrors the tool's own checks; a call that fails it is never fused so the tool
+// can report its usual error.
+const FUSABLE_TOOLS = {
+  resize_video: { operation: 'resize_video', label: 'resized', result: 'Video resized successfully.',
+    valid: (a) => isSet(a.width) && isSet(a.height) && a.width > 0 && a.height > 0 },
+  crop_video: { operation: 'crop_video', label: 'cropped', result: 'Video cropped successfully.',
+    valid: (a) => [a.x, a.y, a.width, a.height].every(isSet) && a.x >= 0 && a.y >= 0 && a.width > 0 && a.height > 0 },
+  rotate_video: { operation: 'rotate_video', label: 'rotated', result: 'Video rotated successfully.',
+    valid: (a) => isSet(a.angle) },
+  flip_video_horizontal: { operation: 'flip_video_horizontal', label: 'flipped horizontally', result: 'Video flipped horizontally successfully.',
+    valid: () => true },
+  add_text: { operation: 'add_text', label: 'text added', result: 'Text added to video successfully.',
+    valid: (a) => typeof a.text === 'string' && a.text !== '' },
+  adjust_speed: { operation: 'speed_video', label: 'speed adjusted', result: 'Video speed adjusted successfully.',
+    valid: (a) => isSet(a.speed) && a.speed > 0 },
+  adjust_volume: { operation: 'adjust_volume', label: 'volume adjusted', result: 'Audio volume adjusted successfully.',
+    valid: (a) => isSet(a.volume) && a.volume >= 0 },
+  audio_fade: { operation: 'audio_fade', label: 'audio fade applied', result: (a) => `Audio fade ${a.type} applied successfully.`,
+    valid: (a) => (a.type === 'in' || a.type === 'out') && isSet(a.duration) && a.duration > 0 },
+  highpass_filter: { operation: 'highpass_filter', label: 'highpass filter applied', result: 'Highpass filter applied successfully.',
+    valid: (a) => isSet(a.frequency) && a.frequency > 0 },
+  lowpass_filter: { operation: 'lowpass_filter', label: 'lowpass filter applied', result: 'Lowpass filter applied successfully.',
+    valid: (a) => isSet(a.frequency) && a.frequency > 0 },
+  echo_effect: { operation: 'echo_effect', label: 'echo effect applied', result: 'Echo effect applied successfully.',
+    valid: (a) => isSet(a.delay) && isSet(a.decay) && a.decay > 0 && a.decay < 1 },
+  bass_adjustment: { operation: 'bass_adjustment', label: 'bass adjusted', result: 'Bass adjusted successfully.',
+    valid: (a) => isSet(a.gain) && a.gain >= -20 && a.gain <= 20 },
+  treble_adjustment: { operation: 'treble_adjustment', label: 'treble adjusted', result: 'Treble adjusted successfully.',
+    valid: (a) => isSet(a.gain) },
+  equalizer: { operation: 'equalizer', label: 'equalizer applied', result: 'Equalizer applied successfully.',
+    valid: (a) => isSet(a.frequency) && isSet(a.gain) },
+  normalize_audio: { operation: 'normalize_audio', label: 'audio normalized', result: 'Audio normalized successfully.',
+    valid: (a) => isSet(a.target) && a.target <= 0 },
+  delay_audio: { operation: 'delay_audio', label: 'audio delayed', result: 'Audio delayed successfully.',
+    valid: (a) => isSet(a.delay) && a.delay >= 0 },
+  adjust_brightness: { operation: 'adjust_brightness', label: 'brightness adjusted', result: 'Brightness adjusted successfully.',
+    valid: (a) => isSet(a.brightness) && a.brightness >= -1 && a.brightness <= 1 },
+  adjust_hue: { operation: 'adjust_hue', label: 'hue adjusted', result: 'Hue adjusted successfully.',
+    valid: (a) => isSet(a.degrees) && a.degrees >= -360 && a.degrees <= 360 },
+  adjust_saturation: { operation: 'adjust_saturation', label: 'saturation adjusted', result: 'Saturation adjusted successfully.',
+    valid: (a) => isSet(a.saturation) && a.saturation >= 0 && a.saturation <= 3 }
+};
+FUSABLE_TOOLS.adjust_audio_volume = FUSABLE_TOOLS.adjust_volume;
+FUSABLE_TOOLS.audio_highpass = FUSABLE_TOOLS.highpass_filter;
+FUSABLE_TOOLS.audio_lowpass = FUSABLE_TOOLS.lowpass_filter;
+FUSABLE_TOOLS.audio_echo = FUSABLE_TOOLS.echo_effect;
+FUSABLE_TOOLS.adjust_bass = FUSABLE_TOOLS.bass_adjustment;
+FUSABLE_TOOLS.adjust_treble = FUSABLE_TOOLS.treble_adjustment;
+FUSABLE_TOOLS.audio_equalizer = FUSABLE_TOOLS.equalizer;
+FUSABLE_TOOLS.audio_delay = FUSABLE_TOOLS.delay_audio;
+
+export function isFusableToolCall(name, args) {
+  const tool = Object.hasOwn(FUSABLE_TOOLS, name) ? FUSABLE_TOOLS[name] : null;
+  return Boolean(tool && args && typeof args === 'object' && tool.valid(args));
+}
+
+// Apply several fusable tool calls in one server encode. Returns one result string per call,
+// or null if the batch could not be applied (the caller then runs the calls one by one).
+export async function runFusedToolCalls(calls, videoFileData, setVideoFileData, addMessage) {
+  const tools = calls.map(({ name }) => FUSABLE_TOOLS[name]);
+  try {
+    const data = await processVideoOnServer('apply_operations', {
+      operations: calls.map(({ args }, i) => ({ operation: tools[i].operation, args }))
+    }, videoFileData);
+    setVideoFileData(data);
+    const videoUrl = URL.createObjectURL(new Blob([data.buffer], { type: 'video/mp4' }));
+    addMessage(`Processed video (${tools.map(tool => tool.label).join(', ')}):`, false, videoUrl, 'processed', 'video/mp4');
+    return calls.map(({ args }, i) => (typeof tools[i].result === 'function' ? tools[i].result(args) : tools[i].result));
+  } catch (error) {
+    console.warn('Fused edit failed, applying edits individually:', error.message);
+    return null;
+  }
+}
@@ -84,7 +84,8 @@ export const tools = [
         type: 'object',
         properties: {
           start: { type: 'string', description: 'The start time (e.g., 00:00:10 or 10).' },
-          end: { type: 'string', description: 'The end time (e.g., 00:00:30 or 30).' }
+          end: { type: 'string', description: 'The end time (e.g., 00:00:30 or 30).' },
+          mode: { type: 'string', enum: ['smart', 'fast'], description: 'smart (default) cuts at the exact frames; fast snaps to the nearest keyframes without re-encoding.' }
         },
         required: ['start', 'end']
       }
@@ -758,6 +759,18 @@ export const tools = [
       }
     }
   },
+  {
+    type: 'function',
+    function: {
+      name: 'export_video',
+      description: 'Export the edited video at full quality. Edits of large videos are previewed at reduced resolution; call this when the user wants the final file or asks to download or export it.',
+      parameters: {
+        type: 'object',
+        properties: {},
+        required: []
+      }
+    }
+  },
   {
     type: 'function',
     function: {
@@ -873,6 +886,11 @@ export const tools = [
             type: 'boolean',
             description: 'Whether to burn the subtitles permanently into the video frames. If true (default), returns a video with embedded subtitles. If false, only returns the SRT/VTT files without modifying the video.',
             default: true
+          },
+          soft_subtitles: {
+            type: 'boolean',
+            description: 'Add the subtitles (and the translation, if any) as selectable subtitle tracks instead of burning them in. This copies the video without re-encoding, so it is much faster; style and position do not apply. Prefer this unless the user wants subtitles permanently visible (e.g. for social media).',
+            default: false
           }
         },
         required: []
@@ -0,0 +1,69 @@
+// Chunked caption transcription. Long audio is cut at silences (found with silencedetect)
+// into chunks that are transcribed concurrently; each chunk's cues are shifted to its
+// position in the media and the merged cues form the full SRT.
+import ffmpeg from 'fluent-ffmpeg';
+import { runWithConcurrency } from './segmentedEncode.js';
+import { parseSrt, offsetCues } from './srt.js';
+
+const SILENCE_START = /silence_start:\s*(-?[\d.]+)/;
+const SILENCE_END = /silence_end:\s*([\d.]+)/;
+
+// Silent intervals [{ start, end }] from silencedetect's stderr log
+export function parseSilences(stderr) {
+  const silences = [];
+  let start = null;
+  for (const line of String(stderr).split('\n')) {
+    const startMatch = line.match(SILENCE_START);
+    if (startMatch) start = Math.max(0, Number(startMatch[1]));
+    const endMatch = line.match(SILENCE_END);
+    if (endMatch && start !== null) {
+      silences.push({ start, end: Number(endMatch[1]) });
+      start = null;
+    }
+  }
+  return silences;
+}
+
+// Chunks [{ start, end }] of about targetSeconds, cut in the middle of the silence nearest to
+// the target and never longer than maxSeconds (cut mid-speech only when there is no silence)
+export function planTranscriptionChunks(silences, duration, { targetSeconds, maxSeconds = 2 * targetSeconds }) {
+  const midpoints = silences.map((silence) => (silence.start + silence.end) / 2);
+  const chunks = [];
+  let start = 0;
+  while (duration - start > maxSeconds) {
+    const candidates = midpoints.filter((t) => t >= start + targetSeconds / 2 && t <= start + maxSeconds);
+    const cut = candidates.length > 0
+      ? candidates.reduce((best, t) => (Math.abs(t - start - targetSeconds) < Math.abs(best - start - targetSeconds) ? t : best))
+      : start + targetSeconds;
+    chunks.push({ start, end: cut });
+    start = cut;
+  }
+  chunks.push({ start, end: duration });
+  return chunks;
+}
+
+// Silent intervals of the input's audio. runFfmpeg(command) runs a fluent-ffmpeg command to
+// completion (under the job scheduler).
+export async function detectSilences(inputPath, { runFfmpeg, noiseDb = -35, minSeconds = 0.4 }) {
+  const stderr = [];
+  await runFfmpeg(ffmpeg(inputPath)
+    .noVideo()
+    .audioFilters(`silencedetect=n=${noiseDb}dB:d=${minSeconds}`)
+    .format('null')
+    .output('-')
+    .on('stderr', (line) => stderr.push(line)));
+  return parseSilences(stderr.join('\n'));
+}
+
+// Transcribe chunks with at most parallelism in flight. transcribe(chunk) resolves to the
+// chunk's SRT text (timed from the chunk start); onChunk(index, cues) receives each chunk's
+// cues in media time as soon as it is done. Resolves to all cues in order.
+export async function transcribeChunks(chunks, { parallelism, transcribe, onChunk }) {
+  const cuesByChunk = new Array(chunks.length);
+  await runWithConcurrency(chunks, parallelism, async (chunk, index) => {
+    const cues = offsetCues(parseSrt(await transcribe(chunk, index)), chunk.start, chunk.end - chunk.start);
+    cuesByChunk[index] = cues;
+    if (onChunk) onChunk(index, cues);
+  });
+  return cuesByChunk.flat();
+}
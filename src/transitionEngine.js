@@ -0,0 +1,330 @@
+// xfade transitions between clips without re-encoding whole clips.
+// Every clip is probed; clips that do not match the target format (the first clip's size
+// and frame rate, yuv420p H.264) are normalized in parallel, one scheduler job each. Each
+// clip is then split at keyframes into a stream-copied body and the short windows around
+// its transitions, and only those windows are re-encoded with xfade. Audio is rendered
+// separately in one acrossfade pass (it is cheap) and muxed with the concatenated video.
+// MP4 stores a single set of H.264 parameter sets (SPS/PPS), so copied bodies must carry the
+// windows' ones: clips whose bodies do not are normalized too, and if the parts still
+// disagree everything is joined in a single re-encoding pass.
+import ffmpeg from 'fluent-ffmpeg';
+import { promises as fs } from 'fs';
+import path from 'path';
+import { probeKeyframes, probeExtradataHash, startTimeOf } from './smartCut.js';
+import { videoStreamOf, hasAudioStream, durationOf } from './probeCache.js';
+import { tmpScratch } from './scratch.js';
+
+const EPSILON = 0.001;
+const DEFAULT_FPS = 30;
+const AUDIO_FORMAT = 'sample_fmts=fltp:sample_rates=48000:channel_layouts=stereo';
+// How far past each transition window keyframes are looked for
+const KEYFRAME_SEARCH_WINDOW_SECONDS = 30;
+
+// Transition type (as in the add_video_transition tool) -> xfade transition name
+export const XFADE_TRANSITIONS = {
+  crossfade: 'fade',
+  dissolve: 'dissolve',
+  fade: 'fadeblack',
+  wipe_left: 'wipeleft',
+  wipe_right: 'wiperight',
+  wipe_up: 'wipeup',
+  wipe_down: 'wipedown',
+  slide_left: 'slideleft',
+  slide_right: 'slideright',
+  slide_up: 'slideup',
+  slide_down: 'slidedown'
+};
+
+export function isTransitionType(name) {
+  return typeof name === 'string' && Object.hasOwn(XFADE_TRANSITIONS, name);
+}
+
+// "30000/1001" -> 29.97; null when unknown
+export function parseFrameRate(rate) {
+  const [num, den = 1] = String(rate || '').split('/').map(Number);
+  const fps = num / den;
+  return Number.isFinite(fps) && fps > 0 ? fps : null;
+}
+
+const frameRateOf = (stream) => parseFrameRate(stream?.avg_frame_rate) || parseFrameRate(stream?.r_frame_rate);
+const even = (value) => Math.max(2, Math.round(value / 2) * 2);
+
+// Output format for the transition: the first clip's size and frame rate
+export function targetFormat(videoStreams) {
+  const first = videoStreams.find(Boolean);
+  if (!first?.width || !first?.height) throw new Error('The first clip has no readable video stream');
+  return {
+    width: even(first.width),
+    height: even(first.height),
+    fps: Math.round((frameRateOf(first) || DEFAULT_FPS) * 1000) / 1000
+  };
+}
+
+// Whether a clip's video can be stream-copied next to windows encoded in the target format
+export function conformsToTarget(stream, target) {
+  const fps = frameRateOf(stream);
+  return Boolean(stream) &&
+    stream.codec_name === 'h264' &&
+    stream.pix_fmt === 'yuv420p' &&
+    stream.width === target.width &&
+    stream.height === target.height &&
+    fps !== null && Math.abs(fps - target.fps) < EPSILON;
+}
+
+// Video filter that letterboxes a clip into the target format
+export function normalizeFilter({ width, height, fps }) {
+  return `scale=${width}:${height}:force_original_aspect_ratio=decrease,` +
+    `pad=${width}:${height}:(ow-iw)/2:(oh-ih)/2,setsar=1,fps=${fps},format=yuv420p`;
+}
+
+// Cut points of clip i of n: [0, headEnd) joins the previous transition, [tailStart, end)
+// the next one, and the keyframe-aligned [headEnd, tailStart) between them is copied.
+// Returns null when the clip has no keyframes that leave both windows at least
+// transitionDuration long.
+export function planClipWindows(keyframes, duration, transitionDuration, { first, last }) {
+  const sorted = [...keyframes].sort((a, b) => a - b);
+  // Without a later keyframe the whole last clip joins its transition
+  const headEnd = first
+    ? 0
+    : sorted.find((t) => t >= transitionDuration - EPSILON && t < duration - EPSILON) ?? duration;
+  const tailStart = last
+    ? duration
+    : [...sorted].reverse().find((t) => t <= duration - transitionDuration + EPSILON);
+  if (tailStart === undefined || headEnd > tailStart + EPSILON) return null;
+  return { headEnd, tailStart: Math.max(headEnd, tailStart) };
+}
+
+// xfade offsets of a single-graph chain: transition k starts transitionDuration before
+// the end of everything joined so far
+export function xfadeOffsets(durations, transitionDuration) {
+  const offsets = [];
+  let joined = durations[0];
+  for (let i = 1; i < durations.length; i++) {
+    offsets.push(joined - transitionDuration);
+    joined += durations[i] - transitionDuration;
+  }
+  return offsets;
+}
+
+const seconds = (value) => value.toFixed(6);
+
+// Audio labels per clip, padded or trimmed to the clip length; clips without audio get silence
+function audioInputs(durations, hasAudio) {
+  return durations.map((duration, i) => (hasAudio[i]
+    ? `[${i}:a]aformat=${AUDIO_FORMAT},apad,atrim=duration=${seconds(duration)},asetpts=PTS-STARTPTS[a${i}]`
+    : `anullsrc=r=48000:cl=stereo,atrim=duration=${seconds(duration)},aformat=${AUDIO_FORMAT}[a${i}]`));
+}
+
+function acrossfadeChain(count, transitionDuration) {
+  const filters = [];
+  let previous = 'a0';
+  for (let i = 1; i < count; i++) {
+    const label = i === count - 1 ? 'a' : `ax${i}`;
+    filters.push(`[${previous}][a${i}]acrossfade=d=${seconds(transitionDuration)}[${label}]`);
+    previous = label;
+  }
+  return filters;
+}
+
+// Audio filtergraph over all clips (as inputs 0..n-1) producing [a]
+export function buildAudioCrossfadeFilter(durations, hasAudio, transitionDuration) {
+  return [...audioInputs(durations, hasAudio), ...acrossfadeChain(durations.length, transitionDuration)].join(';');
+}
+
+// Single filtergraph that normalizes and joins every clip (as inputs 0..n-1) with xfade,
+// producing [v] (and [a] when any clip has audio). Used when a middle clip is too short to
+// be split around its two transitions.
+export function buildXfadeFilter({ durations, hasAudio, transition, transitionDuration, target }) {
+  const filters = durations.map((_, i) => `[${i}:v]${normalizeFilter(target)},settb=AVTB,setpts=PTS-STARTPTS[v${i}]`);
+  let previous = 'v0';
+  xfadeOffsets(durations, transitionDuration).forEach((offset, k) => {
+    const label = k === durations.length - 2 ? 'v' : `vx${k + 1}`;
+    filters.push(`[${previous}][v${k + 1}]xfade=transition=${XFADE_TRANSITIONS[transition]}:duration=${seconds(transitionDuration)}:offset=${seconds(offset)}[${label}]`);
+    previous = label;
+  });
+  if (hasAudio.some(Boolean)) filters.push(buildAudioCrossfadeFilter(durations, hasAudio, transitionDuration));
+  return filters.join(';');
+}
+
+// Clip indices of copied bodies whose parameter sets differ from the windows', or null when
+// the windows themselves do not agree. segments are { path, clip }, clip null for windows.
+async function mismatchedBodies(segments, probeParameterSets) {
+  const hashes = await Promise.all(segments.map((segment) => probeParameterSets(segment.path)));
+  const windowHashes = new Set(hashes.filter((_, k) => segments[k].clip === null));
+  if (windowHashes.size !== 1 || windowHashes.has(null)) return null;
+  const [reference] = windowHashes;
+  return segments.filter((segment, k) => segment.clip !== null && hashes[k] !== reference).map((segment) => segment.clip);
+}
+
+async function windowKeyframes(inputPath, duration, transitionDuration, options) {
+  const window = KEYFRAME_SEARCH_WINDOW_SECONDS + transitionDuration;
+  if (duration <= 2 * window) return probeKeyframes(inputPath, [[0, duration]], options);
+  return probeKeyframes(inputPath, [[0, window], [duration - window, duration]], options);
+}
+
+// Build the command that produces the joined video. Clips are { path, metadata } in order;
+// runFfmpeg(command) runs a fluent-ffmpeg command to completion under the job scheduler and
+// videoEncodeOptions are the x264 options for re-encoded parts; probeParameterSets(path)
+// resolves to a segment's SPS/PPS hash.
+// Resolves to { command, cleanup }: command has inputs, maps and codecs set but no output,
+// and cleanup() removes intermediate files once command has finished.
+export async function prepareTransition({ clips, transition, transitionDuration, runFfmpeg, videoEncodeOptions, findKeyframes = windowKeyframes, probeParameterSets = probeExtradataHash, scratch = tmpScratch }) {
+  const durations = clips.map(({ metadata }) => durationOf(metadata));
+  if (durations.some((duration) => !(duration > transitionDuration))) {
+    const error = new Error('Every clip must be longer than the transition duration');
+    error.code = 'clip_too_short';
+    throw error;
+  }
+  const hasAudio = clips.map(({ metadata }) => hasAudioStream(metadata));
+  const anyAudio = hasAudio.some(Boolean);
+  const target = targetFormat(clips.map(({ metadata }) => videoStreamOf(metadata)));
+  const encodeVideo = ['-c:v', 'libx264', ...videoEncodeOptions, '-pix_fmt', 'yuv420p'];
+  const last = clips.length - 1;
+
+  const singlePass = () => {
+    const command = ffmpeg();
+    clips.forEach((clip) => command.input(clip.path));
+    command
+      .complexFilter(buildXfadeFilter({ durations, hasAudio, transition, transitionDuration, target }))
+      .outputOptions(['-map', '[v]', ...(anyAudio ? ['-map', '[a]', '-c:a', 'aac'] : []), ...encodeVideo]);
+    return { command, cleanup: async () => {} };
+  };
+
+  // Short middle clips cannot be split around two transitions: join everything in one pass
+  if (durations.some((duration, i) => i > 0 && i < last && duration < 2 * transitionDuration)) {
+    return singlePass();
+  }
+
+  const scratchDir = await scratch.createDir('transition', {
+    reserveBytes: clips.reduce((total, { metadata }) => total + (Number(metadata.format?.size) || 0), 0)
+  });
+  const workDir = scratchDir.path;
+  const cleanup = () => scratchDir.release();
+  try {
+    const settle = async (jobs) => {
+      // Let every job settle before the work dir can be removed, even if one of them failed
+      const failed = (await Promise.allSettled(jobs)).find((result) => result.status === 'rejected');
+      if (failed) throw failed.reason;
+    };
+
+    // Keyframes count from the clip's start time, like the -ss its parts are cut with;
+    // normalized clips are written starting at 0
+    const plan = async (i, videoPath, startTime = 0) => planClipWindows(
+      await findKeyframes(videoPath, durations[i], transitionDuration, { startTime }),
+      durations[i], transitionDuration, { first: i === 0, last: i === last }
+    );
+
+    // Clips already in the target format are copied as they are if their keyframes allow
+    const sources = await Promise.all(clips.map(async (clip, i) => {
+      if (conformsToTarget(videoStreamOf(clip.metadata), target)) {
+        const windows = await plan(i, clip.path, startTimeOf(clip.metadata));
+        if (windows) return { path: clip.path, windows };
+      }
+      return null;
+    }));
+
+    // Forced keyframes at the window edges guarantee every normalized clip can be split.
+    // x264 places a forced keyframe on the first frame at or after the requested time, so
+    // the tail one is requested a frame early.
+    const normalized = new Set();
+    const normalize = async (i) => {
+      normalized.add(i);
+      const normalizedPath = path.join(workDir, `clip-${i}.mp4`);
+      const forcedKeyframes = [transitionDuration, durations[i] - transitionDuration - 1 / target.fps]
+        .filter((t) => t > 0 && t < durations[i]).map(seconds);
+      await runFfmpeg(ffmpeg(clips[i].path)
+        .noAudio()
+        .videoFilters(normalizeFilter(target))
+        .outputOptions(['-map', '0:v:0', ...encodeVideo, ...(forcedKeyframes.length ? ['-force_key_frames', forcedKeyframes.join(',')] : [])])
+        .output(normalizedPath));
+      const windows = await plan(i, normalizedPath);
+      if (!windows) throw new Error(`Could not split clip ${i + 1} around its transitions`);
+      sources[i] = { path: normalizedPath, windows };
+    };
+
+    // Audio and the normalization of non-conforming clips run in parallel
+    const audioPath = path.join(workDir, 'audio.m4a');
+    const jobs = sources.flatMap((source, i) => (source ? [] : [normalize(i)]));
+    if (anyAudio) {
+      const command = ffmpeg();
+      clips.forEach((clip) => command.input(clip.path));
+      jobs.push(runFfmpeg(command
+        .complexFilter(buildAudioCrossfadeFilter(durations, hasAudio, transitionDuration))
+        .outputOptions(['-map', '[a]', '-c:a', 'aac', '-b:a', '192k'])
+        .output(audioPath)));
+    }
+    await settle(jobs);
+
+    // Segments in timeline order: body of clip 0, window 0->1, body of clip 1, ...
+    // MPEG-TS segments carry SPS/PPS in-band, so copied bodies and re-encoded windows can
+    // be joined with the concat demuxer.
+    const cutSegments = async () => {
+      const segments = [];
+      const segmentJobs = [];
+      sources.forEach((source, i) => {
+        const { headEnd, tailStart } = source.windows;
+        if (tailStart - headEnd > EPSILON) {
+          const bodyPath = path.join(workDir, `body-${i}.ts`);
+          segments.push({ path: bodyPath, clip: i });
+          segmentJobs.push(runFfmpeg(ffmpeg(source.path)
+            .seekInput(seconds(headEnd))
+            .duration(seconds(tailStart - headEnd))
+            .noAudio()
+            .outputOptions(['-map', '0:v:0', '-c:v', 'copy', '-bsf:v', 'h264_mp4toannexb'])
+            .format('mpegts')
+            .output(bodyPath)));
+        }
+        if (i === last) return;
+
+        const next = sources[i + 1];
+        const tailLength = durations[i] - tailStart;
+        const windowPath = path.join(workDir, `window-${i}.ts`);
+        segments.push({ path: windowPath, clip: null });
+        segmentJobs.push(runFfmpeg(ffmpeg()
+          .input(source.path).seekInput(seconds(tailStart)).inputOptions(['-t', seconds(tailLength)])
+          .input(next.path).inputOptions(['-t', seconds(next.windows.headEnd)])
+          .complexFilter([
+            `[0:v]settb=AVTB,setpts=PTS-STARTPTS[tail]`,
+            `[1:v]settb=AVTB,setpts=PTS-STARTPTS[head]`,
+            `[tail][head]xfade=transition=${XFADE_TRANSITIONS[transition]}:duration=${seconds(transitionDuration)}:offset=${seconds(tailLength - transitionDuration)},format=yuv420p[v]`
+          ].join(';'))
+          .outputOptions(['-map', '[v]', ...encodeVideo, '-r', String(target.fps)])
+          .format('mpegts')
+          .output(windowPath)));
+      });
+      await settle(segmentJobs);
+      return segments;
+    };
+
+    // Bodies copied from clips with other parameter sets (a different profile or encoder) are
+    // normalized like non-conforming clips, which leaves them with the windows' ones
+    let segments = await cutSegments();
+    let mismatched = await mismatchedBodies(segments, probeParameterSets);
+    if (mismatched?.length && !mismatched.some((i) => normalized.has(i))) {
+      await settle(mismatched.map(normalize));
+      segments = await cutSegments();
+      mismatched = await mismatchedBodies(segments, probeParameterSets);
+    }
+    if (mismatched === null || mismatched.length > 0) {
+      await cleanup();
+      return singlePass();
+    }
+
+    const listPath = path.join(workDir, 'segments.txt');
+    await fs.writeFile(listPath, segments.map((segment) => `file '${segment.path}'`).join('\n'));
+
+    const command = ffmpeg()
+      .input(listPath)
+      .inputOptions(['-f', 'concat', '-safe', '0']);
+    const maps = ['-map', '0:v:0'];
+    if (anyAudio) {
+      command.input(audioPath);
+      maps.push('-map', '1:a:0');
+    }
+    command.outputOptions([...maps, '-c', 'copy']);
+    return { command, cleanup };
+  } catch (error) {
+    await cleanup();
+    throw error;
+  }
+}
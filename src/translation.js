@@ -0,0 +1,115 @@
+// Caption translation in parallel cue batches. Only cue texts go to the model (as a JSON
+// array per batch); timings are kept locally, so a translation can never shift or drop a
+// cue. Results are cached by (SRT content hash, language).
+import { createHash } from 'crypto';
+import { runWithConcurrency } from './segmentedEncode.js';
+import { parseSrt, formatSrt } from './srt.js';
+
+// Split cues into batches of at most batchSize
+export function batchCues(cues, batchSize) {
+  const batches = [];
+  for (let i = 0; i < cues.length; i += batchSize) batches.push(cues.slice(i, i + batchSize));
+  return batches;
+}
+
+// The model's JSON array of translated strings, which must match the batch length
+export function parseTranslatedBatch(content, expectedLength) {
+  const json = String(content || '').trim().replace(/^```\w*\s*|```$/g, '').trim();
+  let texts;
+  try {
+    texts = JSON.parse(json);
+  } catch {
+    throw new Error('Translation was not a JSON array');
+  }
+  if (!Array.isArray(texts) || texts.length !== expectedLength || !texts.every((text) => typeof text === 'string')) {
+    throw new Error(`Translation returned ${Array.isArray(texts) ? texts.length : 'no'} lines for ${expectedLength} cues`);
+  }
+  return texts;
+}
+
+// Translate SRT text into every language. translateBatch(texts, language) resolves to the
+// translated texts in order; at most parallelism batches (across all languages) are in
+// flight. Resolves to { [language]: srt }.
+export async function translateSrt(srt, languages, { translateBatch, batchSize = 40, parallelism = 8 }) {
+  const cues = parseSrt(srt);
+  if (cues.length === 0) throw new Error('srtContent has no subtitle cues');
+
+  const batches = batchCues(cues, batchSize);
+  const tasks = languages.flatMap((language) => batches.map((batch, index) => ({ language, batch, index })));
+  const translated = Object.fromEntries(languages.map((language) => [language, new Array(batches.length)]));
+  await runWithConcurrency(tasks, parallelism, async ({ language, batch, index }) => {
+    const texts = await translateBatch(batch.map((cue) => cue.text), language);
+    // An empty translation would drop the cue from the SRT, so keep the source text instead
+    translated[language][index] = batch.map((cue, i) => ({ ...cue, text: texts[i].trim() || cue.text }));
+  });
+  return Object.fromEntries(languages.map((language) => [language, formatSrt(translated[language].flat())]));
+}
+
+// Translated SRT per (SRT hash, language), least recently used first, with concurrent
+// requests for the same translation sharing one in-flight result
+export class TranslationCache {
+  constructor({ maxEntries = 500 } = {}) {
+    this.maxEntries = maxEntries;
+    this.entries = new Map(); // key -> srt
+    this.pending = new Map(); // key -> Promise<srt>
+    this.hits = 0;
+    this.misses = 0;
+  }
+
+  static key(srt, language) {
+    // Hash the parsed cues so formatting differences (numbering, CRLF) share an entry
+    const hash = createHash('sha256').update(JSON.stringify(parseSrt(srt))).digest('hex');
+    return `${hash}:${language.toLowerCase()}`;
+  }
+
+  // Translations of srt into languages; translate(srt, missingLanguages) resolves to
+  // { [language]: srt } for the languages that are neither cached nor in flight
+  async get(srt, languages, translate) {
+    const keys = new Map(languages.map((language) => [language, TranslationCache.key(srt, language)]));
+    const results = {};
+    const waiting = [];
+    const missing = [];
+    for (const [language, key] of keys) {
+      if (this.entries.has(key)) {
+        const cached = this.entries.get(key);
+        this.entries.delete(key);
+        this.entries.set(key, cached);
+        this.hits++;
+        results[language] = cached;
+      } else if (this.pending.has(key)) {
+        this.hits++;
+        waiting.push(this.pending.get(key).then((translation) => { results[language] = translation; }));
+      } else {
+        this.misses++;
+        missing.push(language);
+      }
+    }
+
+    if (missing.length > 0) {
+      const translating = translate(srt, missing);
+      for (const language of missing) {
+        const key = keys.get(language);
+        const entry = translating.then((translations) => translations[language]);
+        this.pending.set(key, entry);
+        entry
+          .then((translation) => this.store(key, translation), () => {})
+          .finally(() => this.pending.delete(key));
+        waiting.push(entry.then((translation) => { results[language] = translation; }));
+      }
+    }
+    await Promise.all(waiting);
+    return results;
+  }
+
+  store(key, translation) {
+    this.entries.set(key, translation);
+    for (const oldestKey of this.entries.keys()) {
+      if (this.entries.size <= this.maxEntries) break;
+      this.entries.delete(oldestKey);
+    }
+  }
+
+  stats() {
+    return { hits: this.hits, misses: this.misses, entries: this.entries.size, maxEntries: this.maxEntries };
+  }
+}
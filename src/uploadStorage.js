@@ -0,0 +1,32 @@
+// multer storage engine that streams each uploaded file part into the AssetStore.
+// Parts are hashed and written to disk as they arrive (with backpressure), so uploads are
+// never buffered in memory. Each stored file is kept acquired until the response closes;
+// routes read it from req.file.asset / req.files[i].asset.
+
+export function assetStoreStorage({ store, extForMimeType }) {
+  return {
+    _handleFile(req, file, cb) {
+      // multer stops feeding a part that exceeds its fileSize limit; abort the write
+      // instead of committing the truncated file
+      file.stream.once('limit', () => file.stream.destroy(new Error('File too large')));
+
+      store.ingestStream(file.stream, {
+        mimeType: file.mimetype || 'application/octet-stream',
+        ext: extForMimeType(file.mimetype)
+      })
+        .then((stored) => store.acquire(stored.id))
+        .then((asset) => {
+          if (!asset) throw new Error('Uploaded file could not be stored');
+          if (req.res) req.res.once('close', () => store.release(asset));
+          else store.release(asset);
+          cb(null, { asset, size: asset.size });
+        })
+        .catch(cb);
+    },
+
+    // Stored content is shared by hash, so aborted uploads are left to store eviction
+    _removeFile(req, file, cb) {
+      cb(null);
+    }
+  };
+}
@@ -0,0 +1,256 @@
+// Registry of single-input filter operations for /api/process-video.
+// Each op builds its -vf / -af filter strings; a batch of ops is compiled into one
+// filter chain per stream so several edits cost a single decode/encode.
+import { loudnormFilter } from './loudness.js';
+
+const MAX_BATCH_OPERATIONS = 20;
+
+function atempoChain(speed) {
+  if (speed >= 0.5 && speed <= 2.0) return [`atempo=${speed}`];
+  const filters = [];
+  let remainingSpeed = speed;
+  if (speed < 0.5) {
+    while (remainingSpeed < 0.5) { filters.push('atempo=0.5'); remainingSpeed *= 2; }
+  } else {
+    while (remainingSpeed > 2.0) { filters.push('atempo=2.0'); remainingSpeed /= 2; }
+  }
+  if (remainingSpeed !== 1.0) filters.push(`atempo=${remainingSpeed}`);
+  return filters;
+}
+
+function escapeDrawtext(text) {
+  return String(text)
+    .replace(/\\/g, '\\\\')
+    .replace(/'/g, "\\'")
+    .replace(/:/g, '\\:')
+    .replace(/\n/g, '\\n')
+    .replace(/\r/g, '')
+    .replace(/\t/g, '\\t');
+}
+
+function panGains(pan) {
+  if (pan < 0) return [1.0, 1.0 + pan];
+  if (pan > 0) return [1.0 - pan, 1.0];
+  return [1.0, 1.0];
+}
+
+// operation -> build(args, context) returning { video: [...filters], audio: [...filters] }.
+// context carries measurements of the input: { loudness } (see loudness.js); compileOperations
+// hands loudness only to a normalize_audio that still sees the input's own audio.
+export const VIDEO_OPS = {
+  resize_video: (a) => ({ video: [`scale=${a.width}:${a.height}`] }),
+  crop_video: (a) => ({ video: [`crop=${a.width}:${a.height}:${a.x}:${a.y}`] }),
+  rotate_video: (a) => ({ video: [`rotate=${a.angle}*PI/180`] }),
+  flip_video_horizontal: () => ({ video: ['hflip'] }),
+  add_text: (a) => ({
+    video: [`drawtext=text='${escapeDrawtext(a.text)}':x=${a.x || 10}:y=${a.y || 10}:fontsize=${a.fontsize || 24}:fontcolor=${a.color || 'white'}`]
+  }),
+  speed_video: (a) => ({ video: [`setpts=PTS/${a.speed}`], audio: atempoChain(a.speed) }),
+  adjust_brightness: (a) => ({ video: [`eq=brightness=${a.brightness}`] }),
+  adjust_hue: (a) => ({ video: [`hue=h=${a.degrees}`] }),
+  adjust_saturation: (a) => ({ video: [`eq=saturation=${a.saturation}`] }),
+  fade_transition: (a) => {
+    const fadeDuration = a.duration || 1;
+    return { video: [`fade=t=in:st=0:d=${fadeDuration}`, `fade=t=out:st=${a.totalDuration - fadeDuration}:d=${fadeDuration}`] };
+  },
+
+  adjust_volume: (a) => ({ audio: [`volume=${a.volume}`] }),
+  audio_fade: (a) => ({ audio: [`afade=t=${a.type === 'in' ? 'in' : 'out'}:st=${a.start}:d=${a.duration}`] }),
+  highpass_filter: (a) => ({ audio: [`highpass=f=${a.frequency}`] }),
+  lowpass_filter: (a) => ({ audio: [`lowpass=f=${a.frequency}`] }),
+  echo_effect: (a) => ({ audio: [`aecho=1.0:0.7:${a.delay}:${a.decay}`] }),
+  bass_adjustment: (a) => ({ audio: [`bass=g=${a.gain}`] }),
+  treble_adjustment: (a) => ({ audio: [`treble=g=${a.gain}`] }),
+  equalizer: (a) => ({ audio: [`equalizer=f=${a.frequency}:width_type=h:width=${a.width || 200}:g=${a.gain}`] }),
+  normalize_audio: (a, { loudness } = {}) => ({ audio: [loudnormFilter(a.target || -16, loudness)] }),
+  delay_audio: (a) => ({ audio: [`adelay=${a.delay}|${a.delay}`] }),
+  audio_chorus: (a) => ({
+    audio: [`chorus=${a.in_gain ?? 0.5}:${a.out_gain ?? 0.9}:${a.delays ?? '40|60|80'}:${a.decays ?? '0.4|0.5|0.6'}:${a.speeds ?? '0.5|0.6|0.7'}:${a.depths ?? '0.25|0.4|0.35'}:t`]
+  }),
+  audio_flanger: (a) => ({
+    audio: [`flanger=delay=${a.delay ?? 0}:depth=${a.depth ?? 2}:regen=${a.regen ?? 0}:width=${a.width ?? 71}:speed=${a.speed ?? 0.5}`]
+  }),
+  audio_phaser: (a) => ({
+    audio: [`aphaser=in_gain=${a.in_gain ?? 0.4}:out_gain=${a.out_gain ?? 0.74}:delay=${a.delay ?? 3}:decay=${a.decay ?? 0.4}:speed=${a.speed ?? 0.5}`]
+  }),
+  audio_vibrato: (a) => ({ audio: [`vibrato=f=${a.frequency ?? 5}:d=${a.depth ?? 0.5}`] }),
+  audio_tremolo: (a) => ({ audio: [`tremolo=f=${a.frequency ?? 5}:d=${a.depth ?? 0.5}`] }),
+  audio_compressor: (a) => ({
+    audio: [`acompressor=threshold=${a.threshold ?? 0}dB:ratio=${a.ratio ?? 4}:attack=${a.attack ?? 20}:release=${a.release ?? 250}`]
+  }),
+  audio_gate: (a) => ({
+    audio: [`agate=threshold=${a.threshold ?? -50}dB:ratio=${a.ratio ?? 2}:attack=${a.attack ?? 20}:release=${a.release ?? 250}`]
+  }),
+  audio_stereo_widen: (a) => ({
+    audio: [`stereowiden=delay=${a.delay ?? 20}:feedback=${a.feedback ?? 0.3}:crossfeed=${a.crossfeed ?? 0.3}`]
+  }),
+  audio_reverse: () => ({ audio: ['areverse'] }),
+  audio_limiter: (a) => ({
+    audio: [`alimiter=level_in=1:level_out=1:limit=${a.level ?? 1.0}:attack=${a.attack ?? 5}:release=${a.release ?? 50}`]
+  }),
+  audio_silence_remove: (a) => ({
+    audio: [`silenceremove=start_periods=1:start_threshold=${a.start_threshold ?? -50}dB:start_duration=${a.start_duration ?? 0.5}:stop_periods=-1:stop_threshold=${a.stop_threshold ?? -50}dB:stop_duration=${a.stop_duration ?? 0.5}`]
+  }),
+  audio_pan: (a) => {
+    const [leftGain, rightGain] = panGains(a.pan);
+    return { audio: [`pan=stereo|c0=${leftGain}*c0|c1=${rightGain}*c1`] };
+  }
+};
+
+// Accept seconds (10, "10.5") or timestamps ("00:01:02.5", "01:02")
+export function parseTimeToSeconds(value) {
+  if (typeof value === 'number') return value;
+  if (typeof value !== 'string' || !value.trim()) return NaN;
+  return value.trim().split(':').reduce((total, part) => total * 60 + Number(part), 0);
+}
+
+export function isFilterOperation(operation) {
+  return typeof operation === 'string' && Object.hasOwn(VIDEO_OPS, operation);
+}
+
+// Filter operations that change the audio (speed changes included)
+const AUDIO_OPS = new Set(Object.keys(VIDEO_OPS).filter((operation) => VIDEO_OPS[operation]({}, {}).audio));
+
+// Whether normalize_audio is the first operation to touch the audio, so loudness measured on
+// the input applies to it
+export function normalizesInputLoudness(operations) {
+  const first = operations.find((entry) => AUDIO_OPS.has(entry?.operation));
+  return first?.operation === 'normalize_audio';
+}
+
+// Filter operations that only change the audio, so the video is stream-copied
+const AUDIO_ONLY_OPS = new Set(Object.keys(VIDEO_OPS).filter((operation) => !VIDEO_OPS[operation]({}, {}).video));
+
+export function isAudioOnlyOperation(operation) {
+  return AUDIO_ONLY_OPS.has(operation);
+}
+
+// Video filters that depend on the position in the whole video rather than on each frame,
+// so they cannot be applied to independently encoded segments
+const TIME_DEPENDENT_VIDEO_OPS = new Set(['fade_transition']);
+
+// Audio ops whose filter state depends only on the recent past, and how many seconds of
+// input it takes to settle (pre-roll before an independently processed chunk). Ops that
+// change the length, depend on the position in the file or on whole-file statistics
+// (loudnorm, silenceremove, areverse, afade, adelay, atempo) are not listed.
+// Modulation effects restart their LFO phase per chunk; the chunk crossfade hides the seam.
+const ms = (value, fallback) => Number(value ?? fallback) / 1000;
+const maxDelaySeconds = (delays, fallback) => Math.max(0, ...String(delays ?? fallback).split('|').map(Number).filter(Number.isFinite)) / 1000;
+const AUDIO_SETTLE_SECONDS = {
+  adjust_volume: () => 0,
+  audio_pan: () => 0,
+  highpass_filter: () => 0.1,
+  lowpass_filter: () => 0.1,
+  bass_adjustment: () => 0.1,
+  treble_adjustment: () => 0.1,
+  equalizer: () => 0.1,
+  echo_effect: (a) => ms(a.delay, 0),
+  audio_chorus: (a) => maxDelaySeconds(a.delays, '40|60|80'),
+  audio_flanger: (a) => ms(a.delay, 0) + ms(a.depth, 2),
+  audio_phaser: (a) => ms(a.delay, 3),
+  audio_vibrato: () => 0.1,
+  audio_tremolo: () => 0,
+  // Envelope followers settle within a few time constants
+  audio_compressor: (a) => 5 * (ms(a.attack, 20) + ms(a.release, 250)),
+  audio_gate: (a) => 5 * (ms(a.attack, 20) + ms(a.release, 250)),
+  audio_limiter: (a) => 5 * (ms(a.attack, 5) + ms(a.release, 50)),
+  audio_stereo_widen: (a) => 10 * ms(a.delay, 20)
+};
+
+// Seconds of pre-roll a batch of audio-only operations needs to be processed in independent
+// chunks, or null when some operation cannot be chunked
+export function audioChunkSettleSeconds(operations) {
+  if (!Array.isArray(operations) || operations.length === 0) return null;
+  let settle = 0;
+  for (const entry of operations) {
+    const estimate = Object.hasOwn(AUDIO_SETTLE_SECONDS, entry?.operation ?? '')
+      ? AUDIO_SETTLE_SECONDS[entry.operation](entry.args || {})
+      : NaN;
+    if (!Number.isFinite(estimate) || estimate < 0) return null;
+    settle = Math.max(settle, estimate);
+  }
+  return settle;
+}
+
+// Whether a batch of filter operations can be encoded in parallel segments
+export function canEncodeInSegments(operations) {
+  return Array.isArray(operations) && operations.every((entry) => (
+    isFilterOperation(entry?.operation) && !TIME_DEPENDENT_VIDEO_OPS.has(entry.operation)
+  ));
+}
+
+function parseEq(filter) {
+  if (!filter.startsWith('eq=')) return null;
+  const params = {};
+  for (const pair of filter.slice(3).split(':')) {
+    const [key, value] = pair.split('=');
+    if (!key || value === undefined) return null;
+    params[key] = value;
+  }
+  return params;
+}
+
+// Merge runs of eq filters into one instance. Only disjoint parameters are merged, since
+// e.g. two brightness offsets applied in sequence clip differently than their sum.
+export function mergeEqFilters(filters) {
+  const merged = [];
+  for (const filter of filters) {
+    const params = parseEq(filter);
+    const previous = merged.length > 0 ? parseEq(merged[merged.length - 1]) : null;
+    if (params && previous && Object.keys(params).every((key) => !(key in previous))) {
+      const combined = { ...previous, ...params };
+      merged[merged.length - 1] = 'eq=' + Object.entries(combined).map(([key, value]) => `${key}=${value}`).join(':');
+    } else {
+      merged.push(filter);
+    }
+  }
+  return merged;
+}
+
+// Compile [{ operation, args }, ...] into one filter chain per stream, preserving order.
+// Throws on unknown operations so the route can answer 400.
+export function compileOperations(operations, context = {}) {
+  if (!Array.isArray(operations) || operations.length === 0) {
+    throw new Error('operations must be a non-empty array');
+  }
+  if (operations.length > MAX_BATCH_OPERATIONS) {
+    throw new Error(`At most ${MAX_BATCH_OPERATIONS} operations can be applied at once`);
+  }
+
+  const videoFilters = [];
+  const audioFilters = [];
+  for (const entry of operations) {
+    const operation = entry?.operation;
+    if (!isFilterOperation(operation)) {
+      throw new Error(`Unknown or non-fusable operation: ${operation}`);
+    }
+    // Stats measured on the input are stale once an earlier filter has changed the audio;
+    // normalize_audio then falls back to single-pass loudnorm
+    const built = VIDEO_OPS[operation](entry.args || {}, audioFilters.length > 0 ? { ...context, loudness: null } : context);
+    videoFilters.push(...(built.video || []));
+    audioFilters.push(...(built.audio || []));
+  }
+
+  return { videoFilters: mergeEqFilters(videoFilters), audioFilters };
+}
+
+// Apply a compiled chain to a fluent-ffmpeg command; streams without filters are copied.
+export function applyCompiledFilters(command, { videoFilters, audioFilters }) {
+  command = videoFilters.length > 0 ? command.videoFilters(videoFilters.join(',')) : command.videoCodec('copy');
+  command = audioFilters.length > 0 ? command.audioFilters(audioFilters.join(',')) : command.audioCodec('copy');
+  return command;
+}
+
+// Expected output duration of an operation, for progress estimates. Speed changes scale it,
+// trims cut it; every other operation keeps the input duration.
+export function expectedOutputDuration(inputDuration, operation, args = {}) {
+  if (!(inputDuration > 0)) return null;
+  if (operation === 'trim_video') {
+    const trimmed = Math.min(parseTimeToSeconds(args.end), inputDuration) - parseTimeToSeconds(args.start);
+    return trimmed > 0 ? trimmed : null;
+  }
+  const operations = operation === 'apply_operations' ? (args.operations || []) : [{ operation, args }];
+  return operations.reduce((duration, entry) => (
+    entry?.operation === 'speed_video' && entry.args?.speed > 0 ? duration / entry.args.speed : duration
+  ), inputDuration);
+}